@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <gpc/gui/color.hpp>
+
+using std::cout;
+using gpc::gui::rgba_norm;
+using gpc::gui::rgba32;
+
+/* Compares the batch color conversion functions against the per-element scalar path
+   (one from_float() call per color, as used for uploading generated images so far).
+ */
+
+static const std::size_t COUNT = 1200 * 675;
+
+template <typename Fn>
+static auto
+measure(Fn fn) -> double
+{
+    using clock = std::chrono::steady_clock;
+
+    long runs = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 0.2);
+
+    return elapsed.count() / runs;
+}
+
+static void
+report(const char *name, double seconds)
+{
+    printf("%-28s %10.3f ms %10.2f Mpixels/s\n", name, seconds * 1e3, COUNT / seconds / 1e6);
+}
+
+int main()
+{
+    try {
+
+        std::vector<rgba_norm> colors(COUNT), colors_back(COUNT);
+        std::vector<rgba32> pixels(COUNT), pixels_ref(COUNT);
+
+        for (std::size_t i = 0; i < COUNT; i++) {
+            colors[i] = { float(i % 1201) / 1200, float(i % 677) / 676, float(i % 256) / 255, float(i % 97) / 96 };
+        }
+
+        // Legacy path: truncating conversion, one call per color
+        report("scalar, truncating (old)", measure([&]() {
+            for (std::size_t i = 0; i < COUNT; i++) {
+                const auto &c = colors[i];
+                pixels_ref[i] = { { uint8_t(c.r() * 255), uint8_t(c.g() * 255), uint8_t(c.b() * 255), uint8_t(c.a() * 255) } };
+            }
+        }));
+
+        report("scalar, rounding", measure([&]() {
+            for (std::size_t i = 0; i < COUNT; i++) pixels_ref[i] = from_float(colors[i]);
+        }));
+
+        report("batch from_float", measure([&]() { from_float(&colors[0], COUNT, &pixels[0]); }));
+
+        report("batch to_float", measure([&]() { to_float(&pixels[0], COUNT, &colors_back[0]); }));
+
+        report("batch from_float_srgb", measure([&]() { from_float_srgb(&colors[0], COUNT, &pixels[0]); }));
+
+        report("batch to_float_srgb", measure([&]() { to_float_srgb(&pixels[0], COUNT, &colors_back[0]); }));
+
+        // Sanity check: batch and per-element conversion must agree
+        from_float(&colors[0], COUNT, &pixels[0]);
+        for (std::size_t i = 0; i < COUNT; i++) {
+            for (int j = 0; j < 4; j++) {
+                if (pixels[i].components[j] != pixels_ref[i].components[j]) {
+                    std::cerr << "Mismatch between batch and scalar conversion at index " << i << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        // Same for sRGB: the vectorized paths must give the exact per-element codes
+        const auto &tables = gpc::gui::detail::get_srgb_tables();
+        from_float_srgb(&colors[0], COUNT, &pixels[0]);
+        for (std::size_t i = 0; i < COUNT; i++) {
+            const auto &c = colors[i];
+            rgba32 ref = { { tables.encode(c.r()), tables.encode(c.g()), tables.encode(c.b()), gpc::gui::unorm8_from_float(c.a()) } };
+            for (int j = 0; j < 4; j++) {
+                if (pixels[i].components[j] != ref.components[j]) {
+                    std::cerr << "Mismatch between batch and per-element sRGB conversion at index " << i << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
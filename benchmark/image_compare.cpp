@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <gpc/gui/image_compare.hpp>
+
+using gpc::gui::rgba32;
+using gpc::gui::image_compare_options;
+using gpc::gui::image_diff;
+
+/* Throughput of the image comparator on 1200x675 rgba32 images (the size of the test
+   image), for identical images (full scan) and with tolerance, diff image and region
+   reporting, compared against a plain per-pixel loop.
+ */
+
+static const int WIDTH = 1200, HEIGHT = 675;
+static const std::size_t COUNT = std::size_t(WIDTH) * HEIGHT;
+
+template <typename Fn>
+static auto
+measure(Fn fn) -> double
+{
+    using clock = std::chrono::steady_clock;
+
+    long runs = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 0.2);
+
+    return elapsed.count() / runs;
+}
+
+static void
+report(const char *name, double seconds)
+{
+    printf("%-28s %10.3f ms %10.2f GB/s\n", name, seconds * 1e3, 2 * COUNT * sizeof(rgba32) / seconds / 1e9);
+}
+
+int main()
+{
+    try {
+
+        std::vector<rgba32> a(COUNT), b;
+        for (std::size_t i = 0; i < COUNT; i++) {
+            a[i] = { { uint8_t(i % 251), uint8_t(i % 241), uint8_t(i % 239), 255 } };
+        }
+        b = a;
+
+        std::size_t sink = 0;
+
+        report("per-pixel loop", measure([&]() {
+            for (std::size_t i = 0; i < COUNT; i++) {
+                for (int c = 0; c < 4; c++) {
+                    if (a[i].components[c] != b[i].components[c]) { sink++; return; }
+                }
+            }
+        }));
+
+        report("identical, exact", measure([&]() { sink += compare_images(&a[0], &b[0], WIDTH, HEIGHT).mismatched_pixels; }));
+
+        image_compare_options tolerant;
+        tolerant.tolerance = 2;
+        report("identical, tolerance 2", measure([&]() { sink += compare_images(&a[0], &b[0], WIDTH, HEIGHT, tolerant).mismatched_pixels; }));
+
+        // A few mismatches scattered over the image, full report
+        for (std::size_t i = 0; i < COUNT; i += COUNT / 16) b[i].components[1] ^= 0x10;
+
+        image_compare_options full;
+        full.early_out = false, full.diff_image = true, full.regions = true;
+        image_diff diff;
+        report("16 mismatches, full report", measure([&]() { compare_images(&a[0], &b[0], WIDTH, HEIGHT, full, diff); }));
+
+        if (diff.mismatched_pixels != 16 || diff.regions.empty() || sink != 0) {
+            std::cerr << "Unexpected comparison result" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <gpc/gui/cpu/renderer.hpp>
+
+using gpc::gui::rgba32;
+
+/* Registering and unregistering thumbnails of assorted sizes (a rolling window of
+   live images, as in a scrolling gallery) with the CPU renderer, reporting the cost per
+   register / unregister pair and the memory held by the image store.
+ */
+
+using renderer_t = gpc::gui::cpu::Renderer<>;
+
+static const int LIVE = 256;                // images alive at any time
+static const int SIZES[][2] = { { 64, 64 }, { 96, 72 }, { 128, 96 }, { 160, 120 }, { 48, 48 }, { 200, 150 } };
+
+template <typename Fn>
+static auto
+measure(Fn fn) -> double
+{
+    using clock = std::chrono::steady_clock;
+
+    long runs = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 0.2);
+
+    return elapsed.count() / runs;
+}
+
+int main()
+{
+    try {
+
+        renderer_t renderer(16, 16);
+
+        std::vector<rgba32> pixels(200 * 150, rgba32 { { 10, 20, 30, 255 } });
+        std::vector<renderer_t::image_handle> live(LIVE);
+
+        std::size_t n = 0;
+        auto next = [&]() {
+            const auto &size = SIZES[n % (sizeof(SIZES) / sizeof(SIZES[0]))];
+            return renderer.register_rgba32_image(size[0], size[1], &pixels[0]);
+        };
+
+        for (auto &handle: live) handle = next(), n++;
+
+        auto seconds = measure([&]() {
+            for (int i = 0; i < 1000; i++, n++) {
+                auto &handle = live[n % LIVE];
+                renderer.unregister_image(handle);
+                handle = next();
+            }
+        });
+
+        auto stats = renderer.image_stats();
+        printf("register + unregister:  %8.3f us\n", seconds / 1000 * 1e6);
+        printf("live images:            %8zu (%zu KiB of pixels)\n", stats.images, stats.pixel_bytes / 1024);
+        printf("slabs:                  %8zu (%zu KiB), %zu free blocks\n", stats.slabs, stats.slab_bytes / 1024, stats.free_blocks);
+
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
@@ -0,0 +1,354 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/tiled_renderer.hpp>
+#include <gpc/gui/test_image_gen.hpp>
+
+/* Renderer benchmark suite: drives a Renderer through the TestImageGenerator scene and
+   through microbenchmarks of the individual primitives (fill_rect sizes, draw_image
+   tiling and offsets, text lengths, each with and without clipping), and reports the
+   results as JSON.
+
+   Usage: RendererBenchmark [backend=cpu|cpu-premul|tiled] [threads=<n>] [min_time=<seconds>]
+                            [filter=<substring of benchmark names>] [output=<file.json>]
+
+   Every benchmark draws a fixed, deterministic sequence of primitives per frame; the
+   checksum of the framebuffer after the first frame identifies the output, so that runs
+   on different machines can be checked for identical results. Only the CPU backends
+   are built in, which need no display: the suite runs as is on headless Linux.
+
+   Reported per benchmark: frames (iterations) per second, ns per primitive, pixels
+   (destination pixels actually covered, i.e. after clipping) per second, and heap allocations per
+   frame (counted by replacing the global operator new).
+ */
+
+static std::atomic<std::size_t> allocations(0);
+
+// GCC does not see that the replacement operator new below allocates with malloc()
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new (std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete (void *p) noexcept { std::free(p); }
+void operator delete (void *p, std::size_t) noexcept { ::operator delete(p); }
+
+namespace {
+
+    using namespace gpc::gui;
+
+    struct options {
+        double          min_time = 0.2;
+        std::string     filter;
+    };
+
+    struct result {
+        std::string     name;
+        long            frames;
+        double          seconds;
+        long            primitives_per_frame;
+        double          pixels_per_frame;
+        double          allocations_per_frame;
+        uint64_t        checksum;
+    };
+
+    // Executes what has been drawn, for renderers that defer drawing (e.g. TiledRenderer)
+    template <class R>
+    auto finish_frame(R &renderer, int) -> decltype(renderer.flush(), void()) { renderer.flush(); }
+
+    template <class R>
+    void finish_frame(R &, long) {}
+
+    // FNV-1a over the screenshot (RGB24, top row first)
+    template <class R>
+    auto checksum(R &renderer) -> uint64_t
+    {
+        auto image = renderer._getRGB24Screenshot();
+
+        uint64_t h = 14695981039346656037ULL;
+        for (const auto &pixel: image) {
+            for (auto c: pixel.rgb) h = (h ^ c) * 1099511628211ULL;
+        }
+        return h;
+    }
+
+    /** Runs the benchmarks on one renderer. Frames are drawn back to back until the
+        minimum time has elapsed (after one warm-up frame, which also fills caches).
+     */
+    template <class Renderer>
+    class suite {
+    public:
+
+        using coord_t       = typename Renderer::coord_t;
+        using length_t      = typename Renderer::length_t;
+        using native_color  = typename Renderer::native_color;
+
+        static const int WIDTH  = TestImageGenerator<Renderer>::WIDTH;
+        static const int HEIGHT = TestImageGenerator<Renderer>::HEIGHT;
+
+        suite(Renderer &renderer_, const options &opts_): renderer(renderer_), opts(opts_)
+        {
+            generator.init(&renderer);
+        }
+
+        ~suite() { generator.cleanup(); }
+
+        auto run() -> const std::vector<result> &
+        {
+            bench("scene/test_image", 1, double(WIDTH) * HEIGHT, [&]() { generator.generate(); });
+
+            constexpr auto opaque      = native_color_of<Renderer>({ 0.2f, 0.4f, 0.8f, 1 });
+            constexpr auto translucent = native_color_of<Renderer>({ 0.8f, 0.2f, 0.1f, 0.5f });
+
+            static const int rect_sizes[] = { 1, 8, 32, 128, 512 };
+
+            for (bool clipped: { false, true }) {
+
+                auto suffix = std::string(clipped ? "/clipped" : "");
+
+                for (int size: rect_sizes) {
+                    for (bool blend: { false, true }) {
+                        auto name = "fill_rect/" + std::to_string(size) + "x" + std::to_string(size) + (blend ? "/blend" : "/opaque") + suffix;
+                        auto color = blend ? translucent : opaque;
+                        repeat(name, PRIMITIVES, size, size, clipped, [&](coord_t x, coord_t y) {
+                            renderer.fill_rect(x, y, length_t(size), length_t(size), color);
+                        });
+                    }
+                }
+                repeat("fill_rect/full_frame" + suffix, 1, WIDTH, HEIGHT, clipped, [&](coord_t, coord_t) {
+                    renderer.fill_rect(0, 0, WIDTH, HEIGHT, opaque);
+                });
+
+                // The test pattern is 50x50 pixels
+                static const int image_sizes[][2] = { { 50, 50 }, { 200, 200 }, { WIDTH, HEIGHT } };
+                for (const auto &size: image_sizes) {
+                    for (int offset: { 0, 17 }) {
+                        auto name = "draw_image/" + std::to_string(size[0]) + "x" + std::to_string(size[1])
+                            + "/offset_" + std::to_string(offset) + suffix;
+                        int count = size[0] == WIDTH ? 1 : PRIMITIVES;
+                        repeat(name, count, size[0], size[1], clipped, [&](coord_t x, coord_t y) {
+                            if (size[0] == WIDTH) x = y = 0;
+                            renderer.draw_image(x, y, length_t(size[0]), length_t(size[1]), generator.test_pattern(), offset, offset);
+                        });
+                    }
+                }
+
+                static const char32_t text[] = U"The quick brown fox jumps over the lazy dog. 0123456789 The quick brown fox jumps.";
+                for (int length: { 4, 16, 64 }) {
+                    auto name = "render_text/" + std::to_string(length) + "_chars" + suffix;
+                    renderer.set_text_color(opaque);
+                    // Pixels are not reported for text (they depend on the glyphs)
+                    repeat(name, PRIMITIVES, 0, 0, clipped, [&](coord_t x, coord_t y) {
+                        renderer.render_text(generator.text_font(), x, y + 16, text, std::size_t(length));
+                    });
+                }
+            }
+
+            // A grid of 16x16 cells in two alternating colors, over the whole frame,
+            // drawn with one fill_rect() per cell and with a single fill_rects() call
+            std::vector<fill_record_t<Renderer>> cells;
+            for (int y = 0; y + 16 <= HEIGHT; y += 17) {
+                for (int x = 0; x + 16 <= WIDTH; x += 17) cells.push_back({ x, y, 16, 16, (x ^ y) & 1 ? opaque : translucent });
+            }
+            auto cell_count = int(cells.size());
+            bench("grid/16x16_cells/per_call", cell_count, cell_count * 256.0, [&]() {
+                for (const auto &c: cells) renderer.fill_rect(c.x, c.y, c.w, c.h, c.color);
+            });
+            bench("grid/16x16_cells/bulk", cell_count, cell_count * 256.0, [&]() {
+                fill_rects(renderer, cells.data(), cells.size());
+            });
+
+            return results;
+        }
+
+    private:
+
+        static const int PRIMITIVES = 64;      // per frame, for the microbenchmarks
+
+        /** A frame of count primitives of size w x h, at positions spread over the
+            framebuffer by a fixed pseudo-random sequence. With clipping, a clipping
+            rectangle covering the middle quarter of the framebuffer is in effect.
+         */
+        template <typename Fn>
+        void repeat(const std::string &name, int count, int w, int h, bool clipped, Fn &&draw)
+        {
+            // Pixels covered: the part of each primitive inside the clipping rectangle
+            int cx1 = clipped ? WIDTH / 4 : 0, cy1 = clipped ? HEIGHT / 4 : 0;
+            int cx2 = clipped ? cx1 + WIDTH / 2 : WIDTH, cy2 = clipped ? cy1 + HEIGHT / 2 : HEIGHT;
+            double pixels = 0;
+            uint32_t seed = 12345;
+            for (int i = 0; i < count; i++) {
+                int x, y;
+                next_position(seed, w, h, x, y);
+                pixels += double(std::max(0, std::min(x + w, cx2) - std::max(x, cx1))) * std::max(0, std::min(y + h, cy2) - std::max(y, cy1));
+            }
+
+            bench(name, count, pixels, [&]() {
+                if (clipped) renderer.set_clipping_rect(cx1, cy1, cx2 - cx1, cy2 - cy1);
+
+                uint32_t seed = 12345;
+                for (int i = 0; i < count; i++) {
+                    int x, y;
+                    next_position(seed, w, h, x, y);
+                    draw(coord_t(x), coord_t(y));
+                }
+
+                if (clipped) renderer.cancel_clipping();
+            });
+        }
+
+        static void next_position(uint32_t &seed, int w, int h, int &x, int &y)
+        {
+            seed = seed * 1664525 + 1013904223;
+            x = int((seed >> 8) % uint32_t(std::max(1, WIDTH - w)));
+            seed = seed * 1664525 + 1013904223;
+            y = int((seed >> 8) % uint32_t(std::max(1, HEIGHT - h)));
+        }
+
+        template <typename Fn>
+        void bench(const std::string &name, int primitives, double pixels, Fn &&frame)
+        {
+            using clock = std::chrono::steady_clock;
+
+            if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos) return;
+
+            // The output of a single frame drawn over a cleared framebuffer identifies the results
+            // (blending frames over each other would make it depend on the frame count)
+            renderer.clear(native_color_of<Renderer>({ 1, 1, 1, 1 }));
+            frame(); finish_frame(renderer, 0);
+            auto output = checksum(renderer);
+
+            long frames = 0;
+            auto allocs = allocations.load();
+            auto start = clock::now();
+            std::chrono::duration<double> elapsed;
+            do {
+                frame(); finish_frame(renderer, 0);
+                frames++;
+                elapsed = clock::now() - start;
+            } while (elapsed.count() < opts.min_time);
+            allocs = allocations.load() - allocs;
+
+            results.push_back({ name, frames, elapsed.count(), primitives, pixels, double(allocs) / frames, output });
+        }
+
+        Renderer                       &renderer;
+        const options                  &opts;
+        TestImageGenerator<Renderer>    generator;
+        std::vector<result>             results;
+    };
+
+    void write_json(std::FILE *out, const std::string &backend, unsigned threads, const options &opts, const std::vector<result> &results)
+    {
+        std::fprintf(out, "{\n");
+        std::fprintf(out, "  \"suite\": \"renderer\",\n");
+        std::fprintf(out, "  \"backend\": \"%s\",\n", backend.c_str());
+        std::fprintf(out, "  \"threads\": %u,\n", threads);
+        std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", TestImageGenerator<cpu::Renderer<>>::WIDTH, TestImageGenerator<cpu::Renderer<>>::HEIGHT);
+        std::fprintf(out, "  \"min_time\": %g,\n", opts.min_time);
+        std::fprintf(out, "  \"results\": [\n");
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const auto &r = results[i];
+            double per_frame = r.seconds / r.frames;
+            std::fprintf(out, "    { \"name\": \"%s\", \"frames\": %ld, \"seconds\": %.6f, \"frames_per_second\": %.3f, "
+                "\"primitives_per_frame\": %ld, \"ns_per_primitive\": %.3f, ",
+                r.name.c_str(), r.frames, r.seconds, 1 / per_frame, r.primitives_per_frame, per_frame * 1e9 / r.primitives_per_frame);
+            if (r.pixels_per_frame > 0) std::fprintf(out, "\"pixels_per_second\": %.0f, ", r.pixels_per_frame / per_frame);
+            else                        std::fprintf(out, "\"pixels_per_second\": null, ");
+            std::fprintf(out, "\"allocations_per_frame\": %.3f, \"checksum\": \"%016llx\" }%s\n",
+                r.allocations_per_frame, static_cast<unsigned long long>(r.checksum), i + 1 < results.size() ? "," : "");
+        }
+
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+    auto argument(int argc, char *argv[], const std::string &name, const std::string &default_value = std::string()) -> std::string
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg.compare(0, name.size() + 1, name + "=") == 0) return arg.substr(name.size() + 1);
+        }
+        return default_value;
+    }
+
+    template <class Renderer>
+    auto run_suite(Renderer &renderer, const options &opts) -> std::vector<result>
+    {
+        suite<Renderer> s(renderer, opts);
+        return s.run();
+    }
+
+} // anonymous ns
+
+int main(int argc, char *argv[])
+{
+    using namespace gpc::gui;
+
+    try {
+
+        options opts;
+        opts.min_time = std::atof(argument(argc, argv, "min_time", "0.2").c_str());
+        opts.filter   = argument(argc, argv, "filter");
+
+        auto backend = argument(argc, argv, "backend", "cpu");
+        auto output  = argument(argc, argv, "output");
+        unsigned threads = unsigned(std::atoi(argument(argc, argv, "threads", "0").c_str()));
+        if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+
+        static const int WIDTH = TestImageGenerator<cpu::Renderer<>>::WIDTH, HEIGHT = TestImageGenerator<cpu::Renderer<>>::HEIGHT;
+
+        std::vector<result> results;
+        if (backend == "cpu") {
+            cpu::Renderer<> renderer(WIDTH, HEIGHT);
+            results = run_suite(renderer, opts);
+            threads = 1;
+        }
+        else if (backend == "cpu-premul") {
+            cpu::Renderer<vertical_direction::down, int, alpha_mode::premultiplied> renderer(WIDTH, HEIGHT);
+            results = run_suite(renderer, opts);
+            threads = 1;
+        }
+        else if (backend == "tiled") {
+            using backend_t = cpu::Renderer<>;
+            backend_t target(WIDTH, HEIGHT);
+            cpu::TiledRenderer<backend_t> renderer(&target, threads);
+            results = run_suite(renderer, opts);
+        }
+        else {
+            std::cerr << "Unknown backend \"" << backend << "\" (use cpu, cpu-premul or tiled)" << std::endl;
+            return 2;
+        }
+
+        auto out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+        if (!out) {
+            std::cerr << "Cannot write \"" << output << "\"" << std::endl;
+            return 1;
+        }
+        write_json(out, backend, threads, opts, results);
+        if (out != stdout && std::fclose(out) != 0) return 1;
+
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <gpc/gui/cpu/span_kernels.hpp>
+
+using std::cout;
+using gpc::gui::rgba32;
+using gpc::gui::simd_level;
+using gpc::gui::cpu::span_kernels;
+using gpc::gui::cpu::span_kernels_for;
+
+/* Measures the span kernels of every instruction set level supported by the host,
+   applied row by row to rectangles of various sizes inside a 1200x675 framebuffer
+   (the size of the test image).
+   Throughput is reported as GB/s of destination pixel data processed.
+ */
+
+static const int FB_WIDTH = 1200, FB_HEIGHT = 675;
+
+enum class kernel { fill, blend_color, blend_premul, blend_color_premul };
+
+static const char *kernel_names[] = { "fill", "blend_color", "blend_premul", "blend_color_premul" };
+
+static void
+run_kernel(const span_kernels &k, kernel which, rgba32 *fb, const rgba32 *src, int w, int h)
+{
+    static const rgba32 color        = { { 255, 0, 0, 128 } };
+    static const rgba32 premul_color = { { 128, 0, 0, 128 } };     // same color, premultiplied
+
+    for (int y = 0; y < h; y++) {
+        auto dst = fb + y * FB_WIDTH;
+        switch (which) {
+        case kernel::fill              : k.fill              (dst, std::size_t(w), color); break;
+        case kernel::blend_color       : k.blend_color       (dst, std::size_t(w), color); break;
+        case kernel::blend_premul      : k.blend_premul      (dst, src + y * FB_WIDTH, std::size_t(w)); break;
+        case kernel::blend_color_premul: k.blend_color_premul(dst, std::size_t(w), premul_color); break;
+        }
+    }
+}
+
+static auto
+make_source() -> std::vector<rgba32>
+{
+    std::vector<rgba32> pixels(FB_WIDTH * FB_HEIGHT);
+
+    // Premultiplied, with varying alpha
+    for (std::size_t i = 0; i < pixels.size(); i++) {
+        uint8_t a = uint8_t(i * 7);
+        pixels[i] = { { uint8_t(a / 2), uint8_t(a / 3), uint8_t(a / 5), a } };
+    }
+
+    return pixels;
+}
+
+// All kernel sets must produce the same bits as the scalar reference
+static bool
+verify(const span_kernels &k, const std::vector<rgba32> &src)
+{
+    const auto &ref = *span_kernels_for(simd_level::scalar);
+
+    for (auto which: { kernel::fill, kernel::blend_color, kernel::blend_premul, kernel::blend_color_premul }) {
+        std::vector<rgba32> expected(src.rbegin(), src.rend()), actual(expected);
+        // Odd width to exercise the tail handling
+        run_kernel(ref, which, &expected[3], &src[0], 1000 + 7, 50);
+        run_kernel(k  , which, &actual  [3], &src[0], 1000 + 7, 50);
+        if (std::memcmp(&expected[0], &actual[0], expected.size() * sizeof(rgba32)) != 0) {
+            std::cerr << k.name << ": " << kernel_names[int(which)] << " differs from scalar reference" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    using clock = std::chrono::steady_clock;
+
+    static const int sizes[][2] = { { 1, 1 }, { 8, 8 }, { 50, 50 }, { 256, 256 }, { 1200, 1 }, { 1, 675 }, { FB_WIDTH, FB_HEIGHT } };
+
+    try {
+
+        auto source = make_source();
+        std::vector<rgba32> framebuffer(FB_WIDTH * FB_HEIGHT);
+
+        bool ok = true;
+
+        printf("%-8s %-18s %12s %12s %10s\n", "isa", "kernel", "rect", "ns/call", "GB/s");
+
+        for (auto level: { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::neon }) {
+
+            auto k = span_kernels_for(level);
+            if (!k) continue;
+
+            ok = verify(*k, source) && ok;
+
+            for (auto which: { kernel::fill, kernel::blend_color, kernel::blend_premul, kernel::blend_color_premul }) {
+                for (const auto &size: sizes) {
+
+                    int w = size[0], h = size[1];
+                    double bytes_per_call = double(w) * double(h) * sizeof(rgba32);
+
+                    // Run for at least 100 ms
+                    long calls = 0;
+                    auto start = clock::now();
+                    std::chrono::duration<double> elapsed;
+                    do {
+                        for (int i = 0; i < 16; i++) run_kernel(*k, which, &framebuffer[0], &source[0], w, h);
+                        calls += 16;
+                        elapsed = clock::now() - start;
+                    } while (elapsed.count() < 0.1);
+
+                    char rect[32];
+                    snprintf(rect, sizeof(rect), "%dx%d", w, h);
+                    printf("%-8s %-18s %12s %12.1f %10.2f\n", k->name, kernel_names[int(which)], rect,
+                        1e9 * elapsed.count() / calls, bytes_per_call * calls / elapsed.count() / 1e9);
+                }
+            }
+        }
+
+        return ok ? 0 : 1;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/tiled_renderer.hpp>
+#include <gpc/gui/test_image_gen.hpp>
+
+using std::cout;
+
+/* Renders the TestImageGenerator scene with the tiled, multi-threaded CPU renderer
+   at 1 to N threads (N = number of hardware threads, or the first command line
+   argument), and checks that every result is bit-identical to the output of the
+   single-threaded renderer.
+ */
+
+using backend_t = gpc::gui::cpu::Renderer<>;
+using tiled_t   = gpc::gui::cpu::TiledRenderer<backend_t>;
+
+static const int WIDTH  = gpc::gui::TestImageGenerator<backend_t>::WIDTH;
+static const int HEIGHT = gpc::gui::TestImageGenerator<backend_t>::HEIGHT;
+
+template <typename Fn>
+static auto
+measure(Fn fn) -> double
+{
+    using clock = std::chrono::steady_clock;
+
+    long runs = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 0.5);
+
+    return elapsed.count() / runs;
+}
+
+static auto
+same_pixels(const backend_t &a, const backend_t &b) -> bool
+{
+    return std::memcmp(a.pixels(), b.pixels(), sizeof(gpc::gui::rgba32) * WIDTH * HEIGHT) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    try {
+
+        unsigned max_threads = argc > 1 ? unsigned(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+        if (max_threads == 0) max_threads = 1;
+
+        // Reference: single-threaded, direct rendering
+        backend_t reference(WIDTH, HEIGHT);
+        gpc::gui::TestImageGenerator<backend_t> reference_gen;
+        reference_gen.init(&reference);
+
+        double base = measure([&]() { reference_gen.generate(); });
+        printf("%-12s %10.3f ms\n", "direct", base * 1e3);
+
+        for (unsigned threads = 1; threads <= max_threads; threads++) {
+
+            backend_t backend(WIDTH, HEIGHT);
+            tiled_t renderer(&backend, threads);
+            gpc::gui::TestImageGenerator<tiled_t> gen;
+            gen.init(&renderer);
+
+            double t = measure([&]() { gen.generate(); renderer.flush(); });
+            printf("%2u thread(s) %10.3f ms %8.2fx\n", threads, t * 1e3, base / t);
+
+            if (!same_pixels(backend, reference)) {
+                std::cerr << "Tiled output with " << threads << " thread(s) differs from direct rendering" << std::endl;
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}
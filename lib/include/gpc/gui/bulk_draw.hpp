@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Bulk drawing: many rectangles or images in one call, for widgets that draw
+            thousands of cells per frame (grid backgrounds, grid lines, icon sheets).
+
+            The records are plain structs, laid out back to back by the caller. They
+            only depend on the coordinate, length, color and image handle types, so a
+            renderer and the adaptors built on it (TiledRenderer, RecordingRenderer,
+            ...) take the same records.
+
+            Renderers may implement fill_rects(records, count) and draw_images(records,
+            count) natively (the CPU renderer does, sharing the clipping and color
+            setup between the records); the free functions below call those if they
+            exist, and otherwise fall back to fill_rect() / draw_image() per record,
+            so that every renderer can be used through them.
+         */
+        template <typename Coord, typename Length, typename Color>
+        struct rect_fill {
+            Coord       x, y;
+            Length      w, h;
+            Color       color;
+        };
+
+        template <typename Coord, typename Length, typename ImageHandle>
+        struct image_blit {
+            Coord       x, y;
+            Length      w, h;
+            ImageHandle image;
+            Coord       offset_x, offset_y;
+        };
+
+        template <class Renderer>
+        using fill_record_t = rect_fill<typename Renderer::coord_t, typename Renderer::length_t, typename Renderer::native_color>;
+
+        template <class Renderer>
+        using image_record_t = image_blit<typename Renderer::coord_t, typename Renderer::length_t, typename Renderer::image_handle>;
+
+        namespace detail {
+
+            template <class Renderer, class Record>
+            auto fill_rects(Renderer &renderer, const Record *records, std::size_t count, int) -> decltype(renderer.fill_rects(records, count), void())
+            {
+                renderer.fill_rects(records, count);
+            }
+
+            template <class Renderer, class Record>
+            void fill_rects(Renderer &renderer, const Record *records, std::size_t count, long)
+            {
+                for (auto r = records, end = records + count; r < end; r++) renderer.fill_rect(r->x, r->y, r->w, r->h, r->color);
+            }
+
+            template <class Renderer, class Record>
+            auto draw_images(Renderer &renderer, const Record *records, std::size_t count, int) -> decltype(renderer.draw_images(records, count), void())
+            {
+                renderer.draw_images(records, count);
+            }
+
+            template <class Renderer, class Record>
+            void draw_images(Renderer &renderer, const Record *records, std::size_t count, long)
+            {
+                for (auto r = records, end = records + count; r < end; r++) renderer.draw_image(r->x, r->y, r->w, r->h, r->image, r->offset_x, r->offset_y);
+            }
+
+        } // ns detail
+
+        /** Fills count rectangles, in order (as many fill_rect() calls would).
+         */
+        template <class Renderer>
+        void fill_rects(Renderer &renderer, const fill_record_t<Renderer> *records, std::size_t count)
+        {
+            detail::fill_rects(renderer, records, count, 0);
+        }
+
+        /** Draws count (repeated, offset) images, in order (as many draw_image() calls
+            would).
+         */
+        template <class Renderer>
+        void draw_images(Renderer &renderer, const image_record_t<Renderer> *records, std::size_t count)
+        {
+            detail::draw_images(renderer, records, count, 0);
+        }
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,522 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <array>
+
+#include "cpu_features.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Normalized RGBA (red, green, blue, alpha) color.
+         */
+        struct rgba_norm {
+
+            // Predefined colors
+            static constexpr const rgba_norm black() { return { 0, 0, 0, 1 }; }
+            static constexpr const rgba_norm white() { return { 1, 1, 1, 1 }; }
+
+            // Constructors
+            constexpr rgba_norm(): rgba_norm { 0, 0, 0, 1 } {}
+            constexpr rgba_norm(float r, float g, float b, float a = 1): components { r, g, b, a } {}
+
+            // Accessors
+            constexpr float r() const { return components[0]; }
+            constexpr float g() const { return components[1]; }
+            constexpr float b() const { return components[2]; }
+            constexpr float a() const { return components[3]; }
+            float& r() { return components[0]; }
+            float& g() { return components[1];  }
+            float& b() { return components[2]; }
+            float& a() { return components[3]; }
+            // Not really an accessor, but allows usage in calls to OpenGL
+            constexpr operator const float * () const { return &components[0]; }
+
+            // Operations
+            auto operator /= (float dsor) -> rgba_norm & {
+                components[0] /= dsor, components[1] /= dsor, components[2] /= dsor, components[3] /= dsor;
+                return *this;
+            }
+
+            // Data
+            std::array<float, 4> components;
+        };
+
+        inline auto
+        operator + (const rgba_norm &color1, const rgba_norm &color2) -> rgba_norm
+        {
+            return { color1.r() + color2.r(), color1.g() + color2.g(), color1.b() + color2.b(), color1.a() + color2.a() };
+        }
+
+        inline auto
+        interpolate(const rgba_norm &color1, const rgba_norm &color2, float a) -> rgba_norm
+        {
+            rgba_norm result;
+            result.r() = color1.r() + a * (color2.r() - color1.r());
+            result.g() = color1.g() + a * (color2.g() - color1.g());
+            result.b() = color1.b() + a * (color2.b() - color1.b());
+            result.a() = color1.a() + a * (color2.a() - color1.a());
+            return result;
+        }
+
+        struct rgba32 {
+            uint8_t components[4];
+        };
+
+        /** How colors and pixels represent transparency: with straight alpha, the color
+            components are independent of alpha; with premultiplied alpha, they have
+            been multiplied by it (so they never exceed it), which makes blending
+            cheaper (see premultiply()).
+         */
+        enum class alpha_mode { straight, premultiplied };
+
+        /** Normalized RGBA color with premultiplied alpha. A type of its own, so that
+            premultiplied and straight colors cannot be mixed up.
+         */
+        struct rgba_norm_premul: rgba_norm {
+            using rgba_norm::rgba_norm;
+        };
+
+        /** 8-bit RGBA color with premultiplied alpha; same layout as rgba32.
+         */
+        struct rgba32_premul {
+            uint8_t components[4];
+        };
+
+        /** Converts a normalized component to 8 bits: clamped to [0, 1], then rounded
+            to the nearest integer (halfway cases rounding up).
+
+            v * 255 is computed as v * 256 - v: the multiplication is exact, so the
+            result is the same whether or not the compiler fuses it with the subtraction
+            (FMA contraction, e.g. with -march=native), and the same as that of the
+            vectorized batch conversions.
+         */
+        inline constexpr auto
+        unorm8_from_float(float v) -> uint8_t
+        {
+            return !(v > 0) ? uint8_t(0) : v >= 1 ? uint8_t(255) : uint8_t(v * 256 - v + 0.5f);
+        }
+
+        inline constexpr auto
+        unorm8_to_float(uint8_t v) -> float
+        {
+            return float(v) / 255;
+        }
+
+        inline constexpr auto
+        from_float(const rgba_norm &from) -> rgba32
+        {
+            return { { unorm8_from_float(from.r()), unorm8_from_float(from.g()), unorm8_from_float(from.b()), unorm8_from_float(from.a()) } };
+        }
+
+        inline constexpr auto
+        to_float(const rgba32 &from) -> rgba_norm
+        {
+            return { unorm8_to_float(from.components[0]), unorm8_to_float(from.components[1]),
+                unorm8_to_float(from.components[2]), unorm8_to_float(from.components[3]) };
+        }
+
+        inline constexpr auto
+        premultiply(const rgba_norm &from) -> rgba_norm_premul
+        {
+            return { from.r() * from.a(), from.g() * from.a(), from.b() * from.a(), from.a() };
+        }
+
+        /** Fully transparent colors become transparent black.
+         */
+        inline constexpr auto
+        unpremultiply(const rgba_norm_premul &from) -> rgba_norm
+        {
+            return from.a() > 0 ? rgba_norm { from.r() / from.a(), from.g() / from.a(), from.b() / from.a(), from.a() } : rgba_norm { 0, 0, 0, 0 };
+        }
+
+        namespace detail {
+
+            // a * b / 255, rounded
+            inline constexpr auto mul_unorm8(unsigned a, unsigned b) -> uint8_t
+            {
+                return uint8_t((a * b + 128 + ((a * b + 128) >> 8)) >> 8);
+            }
+
+            // c * 255 / a, rounded and clamped
+            inline constexpr auto div_unorm8(unsigned c, unsigned a) -> uint8_t
+            {
+                return c >= a ? uint8_t(255) : uint8_t((c * 255 + a / 2) / a);
+            }
+
+        } // ns detail
+
+        inline constexpr auto
+        premultiply(const rgba32 &from) -> rgba32_premul
+        {
+            return { { detail::mul_unorm8(from.components[0], from.components[3]), detail::mul_unorm8(from.components[1], from.components[3]),
+                detail::mul_unorm8(from.components[2], from.components[3]), from.components[3] } };
+        }
+
+        /** Fully transparent colors become transparent black.
+         */
+        inline constexpr auto
+        unpremultiply(const rgba32_premul &from) -> rgba32
+        {
+            return from.components[3] == 0 ? rgba32 { { 0, 0, 0, 0 } } : rgba32 { { detail::div_unorm8(from.components[0], from.components[3]),
+                detail::div_unorm8(from.components[1], from.components[3]), detail::div_unorm8(from.components[2], from.components[3]), from.components[3] } };
+        }
+
+        inline constexpr auto
+        from_float_premul(const rgba_norm_premul &from) -> rgba32_premul
+        {
+            return { { unorm8_from_float(from.r()), unorm8_from_float(from.g()), unorm8_from_float(from.b()), unorm8_from_float(from.a()) } };
+        }
+
+        inline constexpr auto
+        to_float_premul(const rgba32_premul &from) -> rgba_norm_premul
+        {
+            return { unorm8_to_float(from.components[0]), unorm8_to_float(from.components[1]),
+                unorm8_to_float(from.components[2]), unorm8_to_float(from.components[3]) };
+        }
+
+        namespace detail {
+
+            inline void from_float_scalar(const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                for (auto end = src + count; src < end; src++, dst++) *dst = from_float(*src);
+            }
+
+            inline void to_float_scalar(const rgba32 *src, std::size_t count, rgba_norm *dst)
+            {
+                for (auto end = src + count; src < end; src++, dst++) *dst = to_float(*src);
+            }
+
+            #if defined(GPC_GUI_X86)
+
+            // Components already clamped to [0, 1], scaled and rounded as by unorm8_from_float()
+            GPC_GUI_TARGET("sse2") inline auto unorm8_sse2(__m128 v) -> __m128i
+            {
+                auto scaled = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(256)), v);
+                return _mm_cvttps_epi32(_mm_add_ps(scaled, _mm_set1_ps(0.5f)));
+            }
+
+            GPC_GUI_TARGET("sse2") inline auto from_float_sse2_pixel(const rgba_norm *src) -> __m128i
+            {
+                auto v = _mm_loadu_ps(&src->components[0]);
+                return unorm8_sse2(_mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1)));
+            }
+
+            GPC_GUI_TARGET("sse2") inline void from_float_sse2(const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto lo = _mm_packs_epi32(from_float_sse2_pixel(src + 0), from_float_sse2_pixel(src + 1));
+                    auto hi = _mm_packs_epi32(from_float_sse2_pixel(src + 2), from_float_sse2_pixel(src + 3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+                }
+                from_float_scalar(src, std::size_t(end - src), dst);
+            }
+
+            GPC_GUI_TARGET("sse2") inline void to_float_sse2(const rgba32 *src, std::size_t count, rgba_norm *dst)
+            {
+                auto zero = _mm_setzero_si128();
+                auto scale = _mm_set1_ps(255);
+
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                    auto lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+                    _mm_storeu_ps(&dst[0].components[0], _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+                    _mm_storeu_ps(&dst[1].components[0], _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+                    _mm_storeu_ps(&dst[2].components[0], _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+                    _mm_storeu_ps(&dst[3].components[0], _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+                }
+                to_float_scalar(src, std::size_t(end - src), dst);
+            }
+
+            #endif // GPC_GUI_X86
+
+            #if defined(GPC_GUI_NEON)
+
+            // Components already clamped to [0, 1], scaled and rounded as by unorm8_from_float()
+            inline auto unorm8_neon(float32x4_t v) -> uint32x4_t
+            {
+                auto scaled = vsubq_f32(vmulq_n_f32(v, 256), v);
+                return vcvtq_u32_f32(vaddq_f32(scaled, vdupq_n_f32(0.5f)));
+            }
+
+            inline auto from_float_neon_pixel(const rgba_norm *src) -> uint16x4_t
+            {
+                auto v = vminq_f32(vmaxq_f32(vld1q_f32(&src->components[0]), vdupq_n_f32(0)), vdupq_n_f32(1));
+                return vmovn_u32(unorm8_neon(v));
+            }
+
+            inline void from_float_neon(const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto lo = vcombine_u16(from_float_neon_pixel(src + 0), from_float_neon_pixel(src + 1));
+                    auto hi = vcombine_u16(from_float_neon_pixel(src + 2), from_float_neon_pixel(src + 3));
+                    vst1q_u8(reinterpret_cast<uint8_t*>(dst), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+                }
+                from_float_scalar(src, std::size_t(end - src), dst);
+            }
+
+            inline void to_float_neon(const rgba32 *src, std::size_t count, rgba_norm *dst)
+            {
+                auto scale = vdupq_n_f32(255);
+
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto v  = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+                    auto lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+                    vst1q_f32(&dst[0].components[0], vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16 (lo))), scale));
+                    vst1q_f32(&dst[1].components[0], vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+                    vst1q_f32(&dst[2].components[0], vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16 (hi))), scale));
+                    vst1q_f32(&dst[3].components[0], vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+                }
+                to_float_scalar(src, std::size_t(end - src), dst);
+            }
+
+            #endif // GPC_GUI_NEON
+
+            /** Lookup tables for sRGB encoding and decoding, computed once in double
+                precision.
+
+                Encoding looks up the code at the low end of one of 4096 equal intervals
+                of linear values, then compares the value with the threshold above that
+                code. Since the encoding is steepest at 0, where an interval spans 0.8
+                codes, no interval (even widened by the rounding of v * 4095) contains
+                more than one threshold: one comparison settles the code exactly. This
+                is what makes the encoding vectorizable.
+             */
+            struct srgb_tables {
+
+                static const int ESTIMATES = 4096;
+
+                float   decode[256];                // sRGB code -> linear value
+                float   threshold[256];             // linear value halfway between two consecutive codes (and a sentinel)
+                uint8_t estimate[ESTIMATES + 3];    // code at the low end of each interval; padded for 32-bit gathers
+
+                srgb_tables()
+                {
+                    auto to_linear = [](double v) { return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4); };
+
+                    for (int i = 0; i < 256; i++) decode[i] = float(to_linear(i / 255.0));
+                    // Decision points lie where the sRGB-encoded value is exactly halfway between two codes
+                    for (int i = 0; i < 255; i++) threshold[i] = float(to_linear((i + 0.5) / 255.0));
+                    threshold[255] = 2;
+                    // Slightly below the interval, to cover values that v * 4095 rounds up into it
+                    for (int i = 0; i < ESTIMATES; i++) {
+                        auto low = float(double(i) / (ESTIMATES - 1) - 1e-6);
+                        estimate[i] = uint8_t(std::upper_bound(threshold, threshold + 255, low) - threshold);
+                    }
+                    estimate[ESTIMATES] = estimate[ESTIMATES + 1] = estimate[ESTIMATES + 2] = 0;
+                }
+
+                // Values of v outside of [0, 1] (or NaN) must have been clamped
+                auto encode_clamped(float v) const -> uint8_t
+                {
+                    unsigned code = estimate[unsigned(v * (ESTIMATES - 1))];
+                    return uint8_t(code + (v >= threshold[code]));
+                }
+
+                auto encode(float v) const -> uint8_t
+                {
+                    return encode_clamped(!(v > 0) ? 0.f : std::min(v, 1.f));
+                }
+            };
+
+            inline auto get_srgb_tables() -> const srgb_tables &
+            {
+                static const srgb_tables tables;
+                return tables;
+            }
+
+            inline void from_float_srgb_scalar(const srgb_tables &tables, const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                for (auto end = src + count; src < end; src++, dst++) {
+                    *dst = { { tables.encode(src->r()), tables.encode(src->g()), tables.encode(src->b()), unorm8_from_float(src->a()) } };
+                }
+            }
+
+            #if defined(GPC_GUI_X86)
+
+            // One pixel: the codes of the color components, and the (linear) alpha in the last lane
+            GPC_GUI_TARGET("sse2") inline auto from_float_srgb_sse2_pixel(const srgb_tables &tables, const rgba_norm *src) -> __m128i
+            {
+                auto v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src->components[0]), _mm_setzero_ps()), _mm_set1_ps(1));
+
+                alignas(16) int32_t index[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(srgb_tables::ESTIMATES - 1))));
+                int c0 = tables.estimate[index[0]], c1 = tables.estimate[index[1]], c2 = tables.estimate[index[2]];
+
+                auto code = _mm_setr_epi32(c0, c1, c2, 0);
+                auto above = _mm_castps_si128(_mm_cmpge_ps(v, _mm_setr_ps(tables.threshold[c0], tables.threshold[c1], tables.threshold[c2], 2)));
+                code = _mm_sub_epi32(code, above);      // the mask is -1 where the value reaches the threshold
+
+                auto alpha_lane = _mm_setr_epi32(0, 0, 0, -1);
+                return _mm_or_si128(_mm_andnot_si128(alpha_lane, code), _mm_and_si128(alpha_lane, unorm8_sse2(v)));
+            }
+
+            GPC_GUI_TARGET("sse2") inline void from_float_srgb_sse2(const srgb_tables &tables, const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto lo = _mm_packs_epi32(from_float_srgb_sse2_pixel(tables, src + 0), from_float_srgb_sse2_pixel(tables, src + 1));
+                    auto hi = _mm_packs_epi32(from_float_srgb_sse2_pixel(tables, src + 2), from_float_srgb_sse2_pixel(tables, src + 3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+                }
+                from_float_srgb_scalar(tables, src, std::size_t(end - src), dst);
+            }
+
+            // Two pixels, with gathers from the tables
+            GPC_GUI_TARGET("avx2") inline auto from_float_srgb_avx2_pixels(const srgb_tables &tables, const rgba_norm *src) -> __m256i
+            {
+                auto v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&src->components[0]), _mm256_setzero_ps()), _mm256_set1_ps(1));
+
+                auto index = _mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(srgb_tables::ESTIMATES - 1)));
+                auto code = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(tables.estimate), index, 1), _mm256_set1_epi32(0xFF));
+                auto above = _mm256_castps_si256(_mm256_cmp_ps(v, _mm256_i32gather_ps(tables.threshold, code, 4), _CMP_GE_OQ));
+                code = _mm256_sub_epi32(code, above);
+
+                auto alpha = _mm256_set_m128i(unorm8_sse2(_mm256_extractf128_ps(v, 1)), unorm8_sse2(_mm256_castps256_ps128(v)));
+                return _mm256_blend_epi32(code, alpha, 0x88);
+            }
+
+            GPC_GUI_TARGET("avx2") inline void from_float_srgb_avx2(const srgb_tables &tables, const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    // 16-bit lanes hold pixels 0, 2 | 1, 3: put them in order before packing to bytes
+                    auto packed = _mm256_packs_epi32(from_float_srgb_avx2_pixels(tables, src), from_float_srgb_avx2_pixels(tables, src + 2));
+                    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+                    auto bytes = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), bytes);
+                }
+                from_float_srgb_scalar(tables, src, std::size_t(end - src), dst);
+            }
+
+            #endif // GPC_GUI_X86
+
+            #if defined(GPC_GUI_NEON)
+
+            inline auto from_float_srgb_neon_pixel(const srgb_tables &tables, const rgba_norm *src) -> uint16x4_t
+            {
+                auto v = vminq_f32(vmaxq_f32(vld1q_f32(&src->components[0]), vdupq_n_f32(0)), vdupq_n_f32(1));
+
+                uint32_t index[4];
+                vst1q_u32(index, vcvtq_u32_f32(vmulq_f32(v, vdupq_n_f32(srgb_tables::ESTIMATES - 1))));
+                uint32_t codes[4] = { tables.estimate[index[0]], tables.estimate[index[1]], tables.estimate[index[2]], 0 };
+                float thresholds[4] = { tables.threshold[codes[0]], tables.threshold[codes[1]], tables.threshold[codes[2]], 2 };
+
+                auto code = vsubq_u32(vld1q_u32(codes), vcgeq_f32(v, vld1q_f32(thresholds)));   // the mask is -1 where the value reaches the threshold
+                return vmovn_u32(vsetq_lane_u32(vgetq_lane_u32(unorm8_neon(v), 3), code, 3));
+            }
+
+            inline void from_float_srgb_neon(const srgb_tables &tables, const rgba_norm *src, std::size_t count, rgba32 *dst)
+            {
+                auto end = src + count;
+                for (; src + 4 <= end; src += 4, dst += 4) {
+                    auto lo = vcombine_u16(from_float_srgb_neon_pixel(tables, src + 0), from_float_srgb_neon_pixel(tables, src + 1));
+                    auto hi = vcombine_u16(from_float_srgb_neon_pixel(tables, src + 2), from_float_srgb_neon_pixel(tables, src + 3));
+                    vst1q_u8(reinterpret_cast<uint8_t*>(dst), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+                }
+                from_float_srgb_scalar(tables, src, std::size_t(end - src), dst);
+            }
+
+            #endif // GPC_GUI_NEON
+
+        } // ns detail
+
+        /** Batch conversion of normalized colors to rgba32, with correct rounding.
+            Gives the same result as calling from_float() on each element, but is vectorized
+            where the CPU allows it.
+         */
+        inline void
+        from_float(const rgba_norm *src, std::size_t count, rgba32 *dst)
+        {
+            #if defined(GPC_GUI_X86)
+            if (host_cpu_features().sse2) return detail::from_float_sse2(src, count, dst);
+            #elif defined(GPC_GUI_NEON)
+            return detail::from_float_neon(src, count, dst);
+            #endif
+            detail::from_float_scalar(src, count, dst);
+        }
+
+        /** Batch conversion of rgba32 colors to normalized colors; same result as calling
+            to_float() on each element.
+         */
+        inline void
+        to_float(const rgba32 *src, std::size_t count, rgba_norm *dst)
+        {
+            #if defined(GPC_GUI_X86)
+            if (host_cpu_features().sse2) return detail::to_float_sse2(src, count, dst);
+            #elif defined(GPC_GUI_NEON)
+            return detail::to_float_neon(src, count, dst);
+            #endif
+            detail::to_float_scalar(src, count, dst);
+        }
+
+        /** Batch premultiplication of rgba32 colors; same result as calling premultiply()
+            on each element.
+         */
+        inline void
+        premultiply(const rgba32 *src, std::size_t count, rgba32_premul *dst)
+        {
+            for (auto end = src + count; src < end; src++, dst++) {
+                if (src->components[3] == 255) *dst = { { src->components[0], src->components[1], src->components[2], 255 } };
+                else *dst = premultiply(*src);
+            }
+        }
+
+        /** Batch conversion of premultiplied rgba32 colors back to straight alpha; same
+            result as calling unpremultiply() on each element.
+         */
+        inline void
+        unpremultiply(const rgba32_premul *src, std::size_t count, rgba32 *dst)
+        {
+            for (auto end = src + count; src < end; src++, dst++) *dst = unpremultiply(*src);
+        }
+
+        /** Batch conversion of linear normalized colors to sRGB-encoded rgba32.
+            Alpha is not affected by the transfer function. Codes are exact (i.e. the
+            nearest sRGB code to the linear value), and the same on every code path;
+            vectorized where the CPU allows it (with gathers on AVX2).
+         */
+        inline void
+        from_float_srgb(const rgba_norm *src, std::size_t count, rgba32 *dst)
+        {
+            const auto &tables = detail::get_srgb_tables();
+
+            #if defined(GPC_GUI_X86)
+            if (host_cpu_features().avx2) return detail::from_float_srgb_avx2(tables, src, count, dst);
+            if (host_cpu_features().sse2) return detail::from_float_srgb_sse2(tables, src, count, dst);
+            #elif defined(GPC_GUI_NEON)
+            return detail::from_float_srgb_neon(tables, src, count, dst);
+            #endif
+            detail::from_float_srgb_scalar(tables, src, count, dst);
+        }
+
+        /** Batch conversion of sRGB-encoded rgba32 colors to linear normalized colors.
+         */
+        inline void
+        to_float_srgb(const rgba32 *src, std::size_t count, rgba_norm *dst)
+        {
+            const auto &tables = detail::get_srgb_tables();
+
+            for (auto end = src + count; src < end; src++, dst++) {
+                *dst = { tables.decode[src->components[0]], tables.decode[src->components[1]],
+                    tables.decode[src->components[2]], unorm8_to_float(src->components[3]) };
+            }
+        }
+
+        /* Normalized mono (greyscale) value.
+         */
+        using mono_norm = float;
+
+        using mono8 = uint8_t;
+
+    } // ns gui
+
+} // ns gpc
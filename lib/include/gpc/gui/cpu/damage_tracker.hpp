@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** Keeps track of which parts of a framebuffer are "damaged" (or, depending on
+                usage, need to be redrawn), at the granularity of square tiles.
+
+                The tiles are kept in a bitmap with one row of 64-bit words per row of
+                tiles, so that marking and querying rectangles costs a few word operations
+                per tile row. All coordinates are framebuffer pixel coordinates (rows counted
+                in memory order), given as boxes with exclusive ends.
+             */
+            class damage_tracker {
+            public:
+
+                static const int TILE_SHIFT = 5;
+                static const int TILE_SIZE  = 1 << TILE_SHIFT;
+
+                struct rect {
+                    int x, y, w, h;
+                };
+
+                damage_tracker(): width(0), height(0), tiles_x(0), tiles_y(0), words_per_row(0), count(0) {}
+
+                void resize(int width_, int height_)
+                {
+                    width = width_, height = height_;
+                    tiles_x = (width  + TILE_SIZE - 1) >> TILE_SHIFT;
+                    tiles_y = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+                    words_per_row = (tiles_x + 63) / 64;
+                    bits.assign(std::size_t(words_per_row) * std::size_t(tiles_y), 0);
+                    count = 0;
+                }
+
+                void clear()
+                {
+                    if (count > 0) std::fill(bits.begin(), bits.end(), 0);
+                    count = 0;
+                }
+
+                auto empty() const -> bool { return count == 0; }
+
+                void add_all() { add(0, 0, width, height); }
+
+                void add(int x1, int y1, int x2, int y2)
+                {
+                    if (!to_tiles(x1, y1, x2, y2)) return;
+
+                    for (int ty = y1; ty <= y2; ty++) {
+                        auto row = &bits[std::size_t(ty) * std::size_t(words_per_row)];
+                        for (int w = x1 >> 6; w <= x2 >> 6; w++) row[w] |= range_mask(w, x1, x2);
+                    }
+                    count++;
+                }
+
+                /** True if any tile touched by the box is marked.
+                 */
+                auto intersects(int x1, int y1, int x2, int y2) const -> bool
+                {
+                    if (count == 0 || !to_tiles(x1, y1, x2, y2)) return false;
+
+                    for (int ty = y1; ty <= y2; ty++) {
+                        auto row = &bits[std::size_t(ty) * std::size_t(words_per_row)];
+                        for (int w = x1 >> 6; w <= x2 >> 6; w++) if (row[w] & range_mask(w, x1, x2)) return true;
+                    }
+                    return false;
+                }
+
+                /** Splits the box into the parts that lie within marked tiles, calling
+                    fn(x1, y1, x2, y2) once for every horizontal run of marked tiles in every
+                    tile row the box touches.
+                 */
+                template <typename Fn>
+                void for_each_part(int x1, int y1, int x2, int y2, Fn &&fn) const
+                {
+                    int tx1 = x1, ty1 = y1, tx2 = x2, ty2 = y2;
+                    if (count == 0 || !to_tiles(tx1, ty1, tx2, ty2)) return;
+
+                    for (int ty = ty1; ty <= ty2; ty++) {
+                        int py1 = std::max(y1, ty << TILE_SHIFT), py2 = std::min(y2, (ty + 1) << TILE_SHIFT);
+                        for_each_run(ty, tx1, tx2, [&](int run_start, int run_end) {
+                            fn(std::max(x1, run_start << TILE_SHIFT), py1, std::min(x2, run_end << TILE_SHIFT), py2);
+                        });
+                    }
+                }
+
+                /** Converts the marked tiles into a list of rectangles, clipped to the
+                    framebuffer: runs of tiles within a tile row are merged horizontally,
+                    identical runs in consecutive tile rows vertically.
+                    The output vector is cleared first; its capacity is reused.
+                 */
+                void get_regions(std::vector<rect> &regions) const
+                {
+                    regions.clear();
+                    if (count == 0) return;
+
+                    for (int ty = 0; ty < tiles_y; ty++) {
+                        int y = ty << TILE_SHIFT;
+
+                        for_each_run(ty, 0, tiles_x - 1, [&](int run_start, int run_end) {
+                            int x = run_start << TILE_SHIFT, w = (run_end - run_start) << TILE_SHIFT;
+                            // Extend a rect from the row above if it has the same horizontal extent
+                            for (auto &r: regions) {
+                                if (r.x == x && r.w == w && r.y + r.h == y) { r.h += TILE_SIZE; return; }
+                            }
+                            regions.push_back({ x, y, w, TILE_SIZE });
+                        });
+                    }
+
+                    for (auto &r: regions) {
+                        r.w = std::min(r.w, width  - r.x);
+                        r.h = std::min(r.h, height - r.y);
+                    }
+                }
+
+            private:
+
+                // Converts a pixel box to an inclusive range of tiles, clipped to the bitmap
+                auto to_tiles(int &x1, int &y1, int &x2, int &y2) const -> bool
+                {
+                    x1 = std::max(x1, 0), y1 = std::max(y1, 0);
+                    x2 = std::min(x2, width), y2 = std::min(y2, height);
+                    if (x1 >= x2 || y1 >= y2) return false;
+
+                    x1 >>= TILE_SHIFT, y1 >>= TILE_SHIFT;
+                    x2 = (x2 - 1) >> TILE_SHIFT, y2 = (y2 - 1) >> TILE_SHIFT;
+                    return true;
+                }
+
+                // Bits of word w that fall within the inclusive tile range [tx1, tx2]
+                static auto range_mask(int w, int tx1, int tx2) -> uint64_t
+                {
+                    int lo = std::max(tx1 - (w << 6), 0), hi = std::min(tx2 - (w << 6), 63);
+                    uint64_t upto_hi = hi == 63 ? ~uint64_t(0) : (uint64_t(1) << (hi + 1)) - 1;
+                    return upto_hi & ~((uint64_t(1) << lo) - 1);
+                }
+
+                // Calls fn(start, end) for each run of marked tiles within [tx1, tx2] of a tile row (end exclusive)
+                template <typename Fn>
+                void for_each_run(int ty, int tx1, int tx2, Fn &&fn) const
+                {
+                    auto row = &bits[std::size_t(ty) * std::size_t(words_per_row)];
+                    auto is_set = [row](int tx) { return (row[tx >> 6] >> (tx & 63)) & 1; };
+
+                    for (int tx = tx1; tx <= tx2; ) {
+                        // Skip entirely clear words quickly
+                        if ((tx & 63) == 0 && row[tx >> 6] == 0) { tx += 64; continue; }
+                        if (!is_set(tx)) { tx++; continue; }
+                        int start = tx;
+                        while (tx <= tx2 && is_set(tx)) tx++;
+                        fn(start, tx);
+                    }
+                }
+
+                int                     width, height;
+                int                     tiles_x, tiles_y;
+                int                     words_per_row;
+                std::vector<uint64_t>   bits;
+                std::size_t             count;      // number of add() calls since last clear
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include <gpc/fonts/rasterized_font.hpp>
+
+#include "glyph_atlas.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** The fonts registered with the CPU renderer, i.e. their glyph atlases.
+
+                Handles are generation-checked like those of image_store: once a font has
+                been freed, its handle is rejected by find(), even if the slot has been
+                reused. Handle 0 is never valid.
+
+                Fonts shared through a font_library can be added by pointer, and packed
+                fonts by their data: adding the same font again returns the existing
+                handle, with one more reference. release() drops a reference and frees
+                the atlas with the last one.
+             */
+            class font_store {
+            public:
+
+                using handle        = std::size_t;
+                using shared_font   = std::shared_ptr<const gpc::fonts::rasterized_font>;
+
+                font_store() = default;
+
+                font_store(const font_store &) = delete;
+                font_store & operator = (const font_store &) = delete;
+                font_store(font_store &&) = default;
+                font_store & operator = (font_store &&) = default;
+
+                auto add(const gpc::fonts::rasterized_font &rfont, glyph_atlas::mode mode) -> handle
+                {
+                    auto index = allocate_slot();
+                    auto &s = slots[index];
+                    s.atlas.reset(new glyph_atlas(rfont, mode));
+                    s.refs = 1;
+                    return make_handle(index, s.generation);
+                }
+
+                auto add(const shared_font &font, glyph_atlas::mode mode) -> handle
+                {
+                    for (uint32_t i = 0; i < slots.size(); i++) {
+                        auto &s = slots[i];
+                        if (s.refs > 0 && s.source == font) { s.refs++; return make_handle(i, s.generation); }
+                    }
+
+                    auto index = allocate_slot();
+                    auto &s = slots[index];
+                    s.atlas.reset(new glyph_atlas(font, mode));
+                    s.source = font;
+                    s.refs = 1;
+                    return make_handle(index, s.generation);
+                }
+
+                /** Adds a packed font, used in place. Adding the same data again returns
+                    the existing handle, with one more reference.
+                 */
+                auto add(const packed_font &font) -> handle
+                {
+                    for (uint32_t i = 0; i < slots.size(); i++) {
+                        auto &s = slots[i];
+                        if (s.refs > 0 && s.packed_data == font.data()) { s.refs++; return make_handle(i, s.generation); }
+                    }
+
+                    auto index = allocate_slot();
+                    auto &s = slots[index];
+                    s.atlas.reset(new glyph_atlas(font));
+                    s.packed_data = font.data();
+                    s.refs = 1;
+                    return make_handle(index, s.generation);
+                }
+
+                /** The glyph atlas of the font, or nullptr if the handle is stale or
+                    invalid.
+                 */
+                auto find(handle h) -> glyph_atlas *
+                {
+                    auto s = lookup(h);
+                    return s ? s->atlas.get() : nullptr;
+                }
+
+                auto find(handle h) const -> const glyph_atlas *
+                {
+                    auto s = lookup(h);
+                    return s ? s->atlas.get() : nullptr;
+                }
+
+                auto valid(handle h) const -> bool { return lookup(h) != nullptr; }
+
+                /** Drops a reference; returns true if that freed the font.
+                 */
+                auto release(handle h) -> bool
+                {
+                    auto s = const_cast<slot *>(lookup(h));
+                    if (!s || --s->refs > 0) return false;
+
+                    s->atlas.reset();
+                    s->source.reset();
+                    s->packed_data = nullptr;
+                    s->generation++;
+                    if (make_handle(0, s->generation) == 0) s->generation = 1;     // wrapped around
+                    free_slots.push_back(index_of(h));
+                    return true;
+                }
+
+            private:
+
+                static const int            INDEX_BITS = 24;
+                static const std::size_t    INDEX_MASK = (std::size_t(1) << INDEX_BITS) - 1;
+
+                struct slot {
+                    std::unique_ptr<glyph_atlas>    atlas;
+                    shared_font                     source;     // if added by pointer
+                    const uint8_t                  *packed_data = nullptr;     // if added as a packed font
+                    std::size_t                     generation = 1;
+                    unsigned                        refs = 0;
+                };
+
+                static auto make_handle(uint32_t index, std::size_t generation) -> handle
+                {
+                    return (generation << INDEX_BITS) | index;
+                }
+
+                static auto index_of(handle h) -> uint32_t { return uint32_t(h & INDEX_MASK); }
+
+                auto lookup(handle h) const -> const slot *
+                {
+                    auto index = index_of(h);
+                    if (index >= slots.size()) return nullptr;
+
+                    const auto &s = slots[index];
+                    return s.refs > 0 && make_handle(index, s.generation) == h ? &s : nullptr;
+                }
+
+                auto allocate_slot() -> uint32_t
+                {
+                    if (!free_slots.empty()) {
+                        auto index = free_slots.back();
+                        free_slots.pop_back();
+                        return index;
+                    }
+
+                    assert(slots.size() < INDEX_MASK);
+                    slots.emplace_back();
+                    return uint32_t(slots.size() - 1);
+                }
+
+                std::vector<slot>       slots;
+                std::vector<uint32_t>   free_slots;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
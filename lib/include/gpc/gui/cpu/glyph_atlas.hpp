@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <gpc/fonts/rasterized_font.hpp>
+
+#include "../packed_font.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** Per-font glyph cache used by the CPU renderer.
+
+                The coverage bitmaps of the glyphs are trimmed to their non-empty
+                pixels and packed back to back into a single contiguous coverage buffer
+                (the "atlas"); each glyph occupies one unbroken block of width * height
+                bytes. Glyph metrics live in a flat table addressed by glyph index, and
+                codepoints below 256 map to their glyph index through a direct lookup
+                table, so that the common case needs no search at all.
+
+                In lazy mode (meant for fonts with thousands of glyphs, e.g. CJK), only
+                the metrics table is built up front; a glyph's coverage is packed into
+                the atlas the first time the glyph is acquired. Until then, the glyph is
+                served straight from the source bitmaps, in the font itself when the
+                atlas shares ownership of it (otherwise in a copy).
+
+                Packed fonts (see packed_font) already have this layout: their tables and
+                coverage are used in place, so that nothing needs to be built or copied.
+
+                acquire() counts hits (glyph already packed) and misses (glyph packed on
+                demand); find() is side-effect free and may be used concurrently.
+             */
+            class glyph_atlas {
+            public:
+
+                enum class mode { eager, lazy };
+
+                /** Metrics and coverage location of a glyph: offset is into the atlas, or
+                    into the source bitmaps if the glyph is not packed yet. Same layout as
+                    in packed fonts, so that their glyph tables can be used in place.
+                 */
+                using glyph = packed_font::glyph;
+
+                struct statistics {
+                    std::size_t hits, misses;       // acquire() calls for packed / not yet packed glyphs
+                    std::size_t glyphs, packed;     // glyphs in the font / packed into the atlas
+                    std::size_t atlas_bytes;
+                };
+
+                /** Builds the atlas of a font that the caller keeps ownership of; in lazy
+                    mode, the source bitmaps must then be copied.
+                 */
+                glyph_atlas(const gpc::fonts::rasterized_font &rfont, mode mode_):
+                    glyph_atlas(rfont, mode_, nullptr) {}
+
+                /** Same, for a shared font: in lazy mode, the atlas keeps the font alive
+                    and reads the unpacked glyphs from it.
+                 */
+                glyph_atlas(const std::shared_ptr<const gpc::fonts::rasterized_font> &font, mode mode_):
+                    glyph_atlas(*font, mode_, font) {}
+
+                /** Uses the tables and coverage of a packed font in place, without copying
+                    anything; keeps the font's data owner (if any) alive.
+                 */
+                explicit glyph_atlas(const packed_font &font):
+                    source(nullptr), hits(0), misses(0), packed_count(font.glyph_count()), owner(font.data_owner())
+                {
+                    use_tables(font.codepoints(), font.glyphs(), font.glyph_count(), font.pixels(), font.pixels_size());
+                }
+
+                // The tables may point into the atlas' own vectors
+                glyph_atlas(const glyph_atlas &) = delete;
+                glyph_atlas & operator = (const glyph_atlas &) = delete;
+                glyph_atlas(glyph_atlas &&) = default;
+                glyph_atlas & operator = (glyph_atlas &&) = default;
+
+                /** Glyph index of a codepoint, or -1 if the font does not contain it.
+                 */
+                auto index_of(char32_t cp) const -> int
+                {
+                    if (cp < direct.size()) return direct[cp];
+
+                    auto end = index_table + glyph_count;
+                    auto it = std::lower_bound(index_table, end, cp);
+                    return it == end || *it != cp ? -1 : int(it - index_table);
+                }
+
+                /** Looks up a glyph, packing it into the atlas first if necessary, and
+                    updates the hit/miss counters. Returns nullptr for unknown codepoints.
+                 */
+                auto acquire(char32_t cp) -> const glyph *
+                {
+                    int index = index_of(cp);
+                    if (index < 0) return nullptr;
+
+                    auto &g = glyph_table[index];
+                    if (g.packed) hits++;
+                    else {
+                        // Only fonts of our own (not packed ones) have glyphs to pack
+                        misses++;
+                        pack(glyphs[std::size_t(index)]);
+                        atlas_base = atlas.data(), atlas_size = atlas.size();
+                    }
+                    return &g;
+                }
+
+                /** Looks up a glyph without side effects (the glyph may not be packed).
+                 */
+                auto find(char32_t cp) const -> const glyph *
+                {
+                    int index = index_of(cp);
+                    return index < 0 ? nullptr : &glyph_table[index];
+                }
+
+                auto coverage(const glyph &g) const -> const uint8_t *
+                {
+                    return (g.packed ? atlas_base : source) + g.offset;
+                }
+
+                /** Start of the packed coverage; glyph offsets remain valid when the atlas
+                    grows, pointers do not.
+                 */
+                auto atlas_data() const -> const uint8_t * { return atlas_base; }
+
+                auto stats() const -> statistics
+                {
+                    return { hits, misses, glyph_count, packed_count, atlas_size };
+                }
+
+                void reset_stats() { hits = misses = 0; }
+
+            private:
+
+                glyph_atlas(const gpc::fonts::rasterized_font &rfont, mode mode_, std::shared_ptr<const void> font_owner):
+                    codepoints(rfont.index), source(rfont.variants[0].pixels.data()), hits(0), misses(0), packed_count(0)
+                {
+                    const auto &variant = rfont.variants[0];
+
+                    glyphs.reserve(variant.glyphs.size());
+                    for (const auto &rec: variant.glyphs) {
+                        const auto &bounds = rec.cbox.bounds;
+                        glyphs.push_back({ bounds.x_min, bounds.y_min, bounds.x_max - bounds.x_min, bounds.y_max - bounds.y_min,
+                            rec.cbox.adv_x, uint32_t(rec.pixel_base), 0 });
+                    }
+
+                    if (mode_ == mode::eager) {
+                        atlas.reserve(variant.pixels.size());
+                        for (auto &g: glyphs) pack(g);
+                        // The source bitmaps are no longer needed
+                        source = nullptr;
+                    }
+                    else if (font_owner) owner = std::move(font_owner);
+                    else {
+                        auto copy = std::make_shared<const std::vector<uint8_t>>(variant.pixels);
+                        source = copy->data();
+                        owner = std::move(copy);
+                    }
+                    atlas.shrink_to_fit();
+
+                    use_tables(codepoints.data(), glyphs.data(), glyphs.size(), atlas.data(), atlas.size());
+                }
+
+                void use_tables(const char32_t *index, const glyph *table, std::size_t count, const uint8_t *coverage, std::size_t coverage_size)
+                {
+                    index_table = index, glyph_table = table, glyph_count = count;
+                    atlas_base = coverage, atlas_size = coverage_size;
+
+                    direct.fill(-1);
+                    for (std::size_t i = 0; i < glyph_count && index_table[i] < direct.size(); i++) {
+                        direct[index_table[i]] = int32_t(i);
+                    }
+                }
+
+                void pack(glyph &g)
+                {
+                    if (g.packed) return;
+
+                    packed_font::pack_glyph(source + g.offset, g, atlas);
+                    packed_count++;
+                }
+
+                // The tables in use: either the vectors below, or those of a packed font
+                const char32_t             *index_table;    // sorted, parallel to glyph_table
+                const glyph                *glyph_table;
+                std::size_t                 glyph_count;
+                const uint8_t              *atlas_base;
+                std::size_t                 atlas_size;
+                std::array<int32_t, 256>    direct;         // glyph index for codepoints < 256
+
+                std::vector<char32_t>       codepoints;
+                std::vector<glyph>          glyphs;
+                std::vector<uint8_t>        atlas;
+                const uint8_t              *source;         // unpacked glyphs (lazy mode only)
+                std::size_t                 hits, misses;
+                std::size_t                 packed_count;
+                std::shared_ptr<const void> owner;          // of the packed font data, or of the source bitmaps
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
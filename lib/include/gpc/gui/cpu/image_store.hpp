@@ -0,0 +1,329 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../color.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** Storage for the images registered with the CPU renderer.
+
+                Pixel data lives in slabs: large blocks of memory divided into blocks of
+                one size class each (powers of two, from 64 pixels to 64K pixels).
+                Freeing an image puts its block on the free list of its class, where the
+                next image of similar size picks it up, so that registering and
+                unregistering images at a high rate neither fragments the heap nor calls
+                the allocator once the slabs exist. Images too big for the largest class
+                get a dedicated allocation. trim() gives slabs that are entirely unused
+                back to the system.
+
+                Handles combine a slot index with the generation of the slot, which is
+                incremented whenever an image is freed: stale handles (of images that
+                have been unregistered, even if the slot has been reused since) are
+                recognized and rejected by find(). Handle 0 is never valid.
+
+                Images are reference-counted: registration counts as one reference,
+                retain() adds one, and release() drops one, freeing the image when the
+                count reaches zero.
+
+                Images are checked for transparency when they are stored: the renderer
+                copies opaque images instead of blending them.
+             */
+            class image_store {
+            public:
+
+                using handle = std::size_t;
+
+                static const int            MIN_CLASS_SHIFT = 6;            // 64 pixels
+                static const int            MAX_CLASS_SHIFT = 16;           // 64K pixels (256 KiB)
+                static const int            CLASS_COUNT     = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+                static const std::size_t    SLAB_PIXELS     = std::size_t(1) << 18;     // 1 MiB
+
+                struct image {
+                    int             width, height;
+                    const rgba32   *pixels;
+                    bool            opaque;         // all pixels have an alpha of 255
+                };
+
+                struct statistics {
+                    std::size_t images;             // live images
+                    std::size_t pixel_bytes;        // size of the pixel data of the live images
+                    std::size_t slabs, slab_bytes;  // memory reserved in slabs
+                    std::size_t free_blocks;        // slab blocks available for reuse
+                    std::size_t large_images, large_bytes;
+                };
+
+                image_store(): pixel_bytes(0), slab_bytes(0), large_bytes(0), live(0), large_count(0) {}
+
+                image_store(const image_store &) = delete;
+                image_store & operator = (const image_store &) = delete;
+                image_store(image_store &&) = default;
+                image_store & operator = (image_store &&) = default;
+
+                /** Copies the pixels (rows top to bottom, without padding) into the store.
+                    Throws std::invalid_argument for empty images (which could not be
+                    drawn: tiling them would divide by zero).
+                 */
+                auto add(int width, int height, const rgba32 *pixels) -> handle
+                {
+                    return emplace(width, height, [&](rgba32 *dst, std::size_t count) {
+                        std::memcpy(dst, pixels, count * sizeof(rgba32));
+                    });
+                }
+
+                /** Same as add(), but lets fill(dst, count) produce the pixels, e.g. to
+                    convert them on the way into the store.
+                 */
+                template <typename Fill>
+                auto emplace(int width, int height, Fill &&fill) -> handle
+                {
+                    if (width <= 0 || height <= 0) throw std::invalid_argument("image_store: image is empty");
+
+                    auto count = std::size_t(width) * std::size_t(height);
+                    int cls = size_class(count);
+
+                    uint32_t index;
+                    if (!free_slots.empty()) {
+                        index = free_slots.back();
+                        free_slots.pop_back();
+                    }
+                    else {
+                        assert(slots.size() < INDEX_MASK);
+                        index = uint32_t(slots.size());
+                        slots.push_back(slot());
+                    }
+
+                    auto &s = slots[index];
+                    s.refs = 1;
+                    s.size_class = cls;
+                    if (cls >= 0) {
+                        auto block = allocate_block(cls);
+                        s.pixels = block.pixels, s.slab = block.slab;
+                    }
+                    else {
+                        s.large.reset(new rgba32[count]);
+                        s.pixels = s.large.get();
+                        large_bytes += count * sizeof(rgba32);
+                        large_count++;
+                    }
+                    fill(s.pixels, count);
+                    s.view = { width, height, s.pixels, is_opaque(s.pixels, count) };
+
+                    pixel_bytes += count * sizeof(rgba32);
+                    live++;
+
+                    return make_handle(index, s.generation);
+                }
+
+                /** The image designated by the handle, or nullptr if the handle is stale
+                    or invalid.
+                 */
+                auto find(handle h) const -> const image *
+                {
+                    auto s = lookup(h);
+                    return s ? &s->view : nullptr;
+                }
+
+                auto valid(handle h) const -> bool { return lookup(h) != nullptr; }
+
+                /** Adds a reference to a shared image. Returns false if the handle is stale.
+                 */
+                auto retain(handle h) -> bool
+                {
+                    auto s = lookup(h);
+                    if (!s) return false;
+
+                    s->refs++;
+                    return true;
+                }
+
+                /** Drops a reference, freeing the image when it was the last one. Returns
+                    false if the handle is stale (so releasing twice is harmless).
+                 */
+                auto release(handle h) -> bool
+                {
+                    auto s = lookup(h);
+                    if (!s) return false;
+
+                    if (--s->refs == 0) free(index_of(h));
+                    return true;
+                }
+
+                auto ref_count(handle h) const -> unsigned
+                {
+                    auto s = lookup(h);
+                    return s ? s->refs : 0;
+                }
+
+                /** Frees the slabs that hold no image.
+                 */
+                void trim()
+                {
+                    for (auto &list: free_blocks) {
+                        std::size_t kept = 0;
+                        for (const auto &block: list) {
+                            if (slabs[block.slab].used > 0) list[kept++] = block;
+                        }
+                        list.resize(kept);
+                    }
+                    for (uint32_t i = 0; i < slabs.size(); i++) {
+                        auto &sl = slabs[i];
+                        if (sl.memory && sl.used == 0) {
+                            slab_bytes -= SLAB_PIXELS * sizeof(rgba32);
+                            sl.memory.reset();
+                            free_slabs.push_back(i);
+                        }
+                    }
+                }
+
+                auto stats() const -> statistics
+                {
+                    statistics st = { live, pixel_bytes, slabs.size() - free_slabs.size(), slab_bytes, 0, large_count, large_bytes };
+                    for (const auto &list: free_blocks) st.free_blocks += list.size();
+                    return st;
+                }
+
+            private:
+
+                static const int            INDEX_BITS = 24;
+                static const std::size_t    INDEX_MASK = (std::size_t(1) << INDEX_BITS) - 1;
+
+                struct slot {
+                    image                       view = { 0, 0, nullptr, false };
+                    rgba32                     *pixels = nullptr;           // same as view.pixels, writable
+                    std::size_t                 generation = 1;
+                    unsigned                    refs = 0;
+                    int                         size_class = -1;
+                    uint32_t                    slab = 0;
+                    std::unique_ptr<rgba32[]>   large;
+                };
+
+                struct block {
+                    rgba32     *pixels;
+                    uint32_t    slab;
+                };
+
+                struct slab {
+                    std::unique_ptr<rgba32[]>   memory;
+                    uint32_t                    used;       // blocks in use
+                };
+
+                static auto size_class(std::size_t count) -> int
+                {
+                    int shift = MIN_CLASS_SHIFT;
+                    while ((std::size_t(1) << shift) < count) shift++;
+                    return shift <= MAX_CLASS_SHIFT ? shift - MIN_CLASS_SHIFT : -1;
+                }
+
+                static auto is_opaque(const rgba32 *pixels, std::size_t count) -> bool
+                {
+                    for (auto end = pixels + count; pixels < end; pixels++) if (pixels->components[3] != 255) return false;
+                    return true;
+                }
+
+                static auto make_handle(uint32_t index, std::size_t generation) -> handle
+                {
+                    return (generation << INDEX_BITS) | index;
+                }
+
+                static auto index_of(handle h) -> uint32_t { return uint32_t(h & INDEX_MASK); }
+
+                auto lookup(handle h) const -> const slot *
+                {
+                    auto index = index_of(h);
+                    if (index >= slots.size()) return nullptr;
+
+                    const auto &s = slots[index];
+                    return s.refs > 0 && make_handle(index, s.generation) == h ? &s : nullptr;
+                }
+
+                auto lookup(handle h) -> slot *
+                {
+                    return const_cast<slot *>(static_cast<const image_store *>(this)->lookup(h));
+                }
+
+                auto allocate_block(int cls) -> block
+                {
+                    auto &list = free_blocks[cls];
+                    if (list.empty()) add_slab(cls);
+
+                    auto b = list.back();
+                    list.pop_back();
+                    slabs[b.slab].used++;
+                    return b;
+                }
+
+                void add_slab(int cls)
+                {
+                    auto block_pixels = std::size_t(1) << (cls + MIN_CLASS_SHIFT);
+                    auto count = SLAB_PIXELS / block_pixels;
+
+                    uint32_t index;
+                    if (!free_slabs.empty()) {
+                        index = free_slabs.back();
+                        free_slabs.pop_back();
+                    }
+                    else {
+                        index = uint32_t(slabs.size());
+                        slabs.push_back(slab());
+                    }
+
+                    auto &sl = slabs[index];
+                    sl.memory.reset(new rgba32[SLAB_PIXELS]);
+                    sl.used = 0;
+                    slab_bytes += SLAB_PIXELS * sizeof(rgba32);
+
+                    // In reverse, so that blocks are handed out in address order
+                    auto &list = free_blocks[cls];
+                    for (auto i = count; i-- > 0; ) list.push_back({ sl.memory.get() + i * block_pixels, index });
+                }
+
+                void free(uint32_t index)
+                {
+                    auto &s = slots[index];
+                    auto count = std::size_t(s.view.width) * std::size_t(s.view.height);
+
+                    if (s.size_class >= 0) {
+                        free_blocks[s.size_class].push_back({ s.pixels, s.slab });
+                        slabs[s.slab].used--;
+                    }
+                    else {
+                        s.large.reset();
+                        large_bytes -= count * sizeof(rgba32);
+                        large_count--;
+                    }
+
+                    pixel_bytes -= count * sizeof(rgba32);
+                    live--;
+
+                    s.view = { 0, 0, nullptr, false };
+                    s.pixels = nullptr;
+                    s.generation++;
+                    if (make_handle(0, s.generation) == 0) s.generation = 1;   // wrapped around
+                    free_slots.push_back(index);
+                }
+
+                std::vector<slot>           slots;
+                std::vector<uint32_t>       free_slots;
+                std::vector<slab>           slabs;
+                std::vector<uint32_t>       free_slabs;
+                std::vector<block>          free_blocks[CLASS_COUNT];
+                std::size_t                 pixel_bytes, slab_bytes, large_bytes;
+                std::size_t                 live, large_count;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
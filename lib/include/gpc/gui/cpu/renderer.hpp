@@ -0,0 +1,1005 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include <gpc/fonts/rasterized_font.hpp>
+
+#include "../renderer.hpp"
+#include "../native_color.hpp"
+#include "../utf8.hpp"
+#include "../framebuffer_view.hpp"
+#include "../bulk_draw.hpp"
+#include "span_kernels.hpp"
+#include "damage_tracker.hpp"
+#include "glyph_atlas.hpp"
+#include "font_store.hpp"
+#include "text_run_cache.hpp"
+#include "image_store.hpp"
+#include "scaled_image_cache.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** Headless, CPU-only implementation of the Pixel Renderer concept.
+
+                Everything is drawn into an in-memory framebuffer of rgba32 pixels, so no
+                graphics API, context or display is needed. This makes the renderer
+                usable on GPU-less server nodes and for automated testing, and it serves
+                as the performance baseline for the other backends.
+
+                All primitives are implemented as loops over horizontal row spans. Apart
+                from resource registration (images, fonts) and viewport changes, no call
+                allocates memory. Image pixels are kept in a pooled store (see
+                image_store), so that images can be registered and unregistered at a high
+                rate without allocator churn.
+
+                The renderer keeps track of the framebuffer areas touched by drawing
+                ("damage"), so that presenters can copy only what changed. It can also
+                redraw partially: after invalidate() has been called for the parts of the
+                display that need updating, drawing between begin_partial_redraw() and
+                end_partial_redraw() only touches pixels inside those parts, skipping
+                primitives that lie entirely outside of them.
+
+                AlphaMode selects how colors and the framebuffer represent transparency.
+                With straight alpha (the default), native colors are rgba32 and pixels are
+                blended by interpolation. With premultiplied alpha, native colors are
+                rgba32_premul, images are premultiplied once when they are registered,
+                and all blending uses the cheaper premultiplied source-over equation;
+                the framebuffer (pixels(), framebuffer()) then holds premultiplied pixels,
+                which are the same as straight ones wherever the framebuffer is opaque.
+
+                CoordType is a signed integral type, or a fixed_point type (such as
+                fixed_24_8) for sub-pixel placement. With fixed-point coordinates, the
+                fractional edges of fill_rect() are antialiased (each edge pixel is blended
+                with the color scaled by its coverage), while everything else snaps to the
+                nearest pixel boundary; rectangles whose edges fall on pixel boundaries
+                take the same path as with integer coordinates, which is all there is for
+                integral coordinate types.
+             */
+            template <
+                vertical_direction VertAxisDir = vertical_direction::down,
+                typename CoordType = int,   // signed integral type or fixed_point
+                alpha_mode AlphaMode = alpha_mode::straight
+            >
+            class Renderer {
+            public:
+
+                static const horizontal_direction   horizontal_axis_dir = horizontal_direction::right;
+                static const vertical_direction     vertical_axis_dir   = VertAxisDir;
+                static const alpha_mode             color_alpha_mode    = AlphaMode;
+
+                using coord_t       = CoordType;
+                using length_t      = typename coord_traits<coord_t>::length_t;
+                using native_color  = typename std::conditional<AlphaMode == alpha_mode::premultiplied, rgba32_premul, rgba32>::type;
+                using image_handle  = image_store::handle;
+                using font_handle   = font_store::handle;
+                using fill_record   = rect_fill<coord_t, length_t, native_color>;
+                using image_record  = image_blit<coord_t, length_t, image_handle>;
+
+                struct _RGB24 {
+                    uint8_t rgb[3];
+                };
+
+                typedef std::vector<_RGB24> _RGB24Image;
+
+                /** Rectangle in framebuffer pixel coordinates (exclusive ends). Rows are
+                    numbered in memory order (see pixels()), which is that of the vertical
+                    axis, so boxes are the caller's rectangles in whole pixels.
+                 */
+                struct box {
+                    int x1, y1, x2, y2;
+                    bool empty() const { return x1 >= x2 || y1 >= y2; }
+                };
+
+                Renderer(): _width(0), _height(0), _kernels(&best_span_kernels())
+                {
+                    static_assert(has_constexpr_native_color<Renderer>::value, "color conversions must be constexpr");
+                    cancel_clipping();
+                }
+
+                Renderer(length_t width, length_t height): Renderer() { define_viewport(0, 0, width, height); }
+
+                /** Allocates the framebuffer. The framebuffer always starts at (0, 0);
+                    x and y are accepted for compatibility with the other backends only.
+                 */
+                void define_viewport(coord_t /*x*/, coord_t /*y*/, length_t w, length_t h)
+                {
+                    _width = pixel(w), _height = pixel(h);
+                    _pixels.assign(std::size_t(_width) * std::size_t(_height), rgba32 { { 0, 0, 0, 0 } });
+                    _damage.resize(_width, _height);
+                    _damage.add_all();
+                    _redraw.resize(_width, _height);
+                    _partial = false;
+                    _clip_stack.clear();
+                    cancel_clipping();
+                }
+
+                // There is no context to prepare, but the renderer loop should not have to know
+                void prepare_context() {}
+                void leave_context() {}
+
+                auto width () const -> length_t { return length_t(_width ); }
+                auto height() const -> length_t { return length_t(_height); }
+
+                /** Direct access to the framebuffer: rows are stored without padding, in
+                    the direction of the vertical axis, i.e. bottom to top if it points up
+                    (framebuffer() then has a negative stride). Pixels are premultiplied in
+                    premultiplied alpha mode.
+                 */
+                auto pixels() const -> const rgba32 * { return _pixels.data(); }
+
+                static constexpr auto rgba_norm_to_native(const rgba_norm &color) -> native_color { return to_native(from_float(color), premultiplied()); }
+
+                static constexpr auto rgb_to_native(const rgba_norm &color) -> native_color { return to_native(from_float({ color.r(), color.g(), color.b(), 1 }), premultiplied()); }
+
+                void clear(const native_color &color)
+                {
+                    if (!_partial) {
+                        _kernels->fill(_pixels.data(), _pixels.size(), to_pixel(color));
+                        _damage.add_all();
+                    }
+                    else {
+                        draw_area(surface(), [&](const box &part) { fill_box(part, to_pixel(color), _kernels->fill); });
+                    }
+                }
+
+                void fill_rect(coord_t x, coord_t y, length_t w, length_t h, const native_color &color)
+                {
+                    unsigned alpha = color.components[3];
+                    if (alpha == 0) return;
+
+                    if (!aligned(x, y, w, h)) {
+                        for_each_covered_box(x, y, w, h, color, [&](const box &b, const native_color &c) {
+                            auto area = clip(b);
+                            auto span = fill_span(c.components[3]);
+                            if (!area.empty()) draw_area(area, [&](const box &part) { fill_box(part, to_pixel(c), span); });
+                        });
+                        return;
+                    }
+
+                    auto area = clip(to_box(x, y, w, h));
+                    if (area.empty()) return;
+
+                    auto span = fill_span(alpha);
+                    draw_area(area, [&](const box &part) { fill_box(part, to_pixel(color), span); });
+                }
+
+                /** Registers an image with straight alpha (converting it once, here, in
+                    premultiplied alpha mode). Throws std::invalid_argument if the image is
+                    less than a pixel wide or high.
+                 */
+                auto register_rgba32_image(length_t width, length_t height, const rgba32 *pixels) -> image_handle
+                {
+                    if (AlphaMode == alpha_mode::straight) return _images.add(pixel(width), pixel(height), pixels);
+
+                    return _images.emplace(pixel(width), pixel(height), [&](rgba32 *dst, std::size_t count) {
+                        premultiply(pixels, count, reinterpret_cast<rgba32_premul*>(dst));
+                    });
+                }
+
+                /** Registers an image whose pixels are already premultiplied (converting it
+                    once, here, in straight alpha mode).
+                 */
+                auto register_rgba32_image(length_t width, length_t height, const rgba32_premul *pixels) -> image_handle
+                {
+                    if (AlphaMode == alpha_mode::premultiplied) {
+                        return _images.add(pixel(width), pixel(height), reinterpret_cast<const rgba32*>(pixels));
+                    }
+
+                    return _images.emplace(pixel(width), pixel(height), [&](rgba32 *dst, std::size_t count) {
+                        unpremultiply(pixels, count, dst);
+                    });
+                }
+
+                auto register_rgba_image(length_t width, length_t height, const rgba32 *pixels) -> image_handle
+                {
+                    return register_rgba32_image(width, height, pixels);
+                }
+
+                /** Adds a reference to a registered image, for sharing it between owners
+                    that each unregister it when done.
+                 */
+                void retain_image(image_handle handle)
+                {
+                    bool ok = _images.retain(handle);
+                    assert(ok); (void) ok;
+                }
+
+                /** Drops a reference to an image (registration counts as one); the image
+                    is freed with the last one. Its handle then becomes stale: drawing with
+                    it does nothing, and unregistering it again is harmless.
+                 */
+                void unregister_image(image_handle handle)
+                {
+                    if (_images.release(handle) && !_images.valid(handle)) _scaled_images.invalidate_image(handle);
+                }
+
+                auto image_stats() const -> image_store::statistics { return _images.stats(); }
+
+                /** Returns memory that is no longer used by any image to the system.
+                 */
+                void trim_image_memory() { _images.trim(); }
+
+                /** Statistics of the cache of resampled images used by draw_image_scaled()
+                    (see scaled_image_cache).
+                 */
+                auto scaled_image_cache_stats() const -> scaled_image_cache::statistics { return _scaled_images.stats(); }
+
+                void reset_scaled_image_cache_stats() { _scaled_images.reset_stats(); }
+
+                void set_scaled_image_cache_capacity(std::size_t bytes) { _scaled_images.set_capacity(bytes); }
+
+                /** Draws the specified image into the specified rectangle, repeating it
+                    both horizontally and vertically. The offset designates the image pixel
+                    that goes into the top left corner of the rectangle.
+                 */
+                void draw_image(coord_t x, coord_t y, length_t w, length_t h, image_handle handle,
+                    coord_t offset_x = 0, coord_t offset_y = 0)
+                {
+                    auto dest = to_box(x, y, w, h);
+                    auto area = clip(dest);
+                    if (area.empty()) return;
+
+                    auto img = _images.find(handle);
+                    if (!img) return;
+
+                    draw_area(area, [&](const box &part) { blit_image(dest, part, *img, pixel(offset_x), pixel(offset_y)); });
+                }
+
+                /** Draws the whole image scaled to the specified rectangle, resampled with
+                    the filter. Resampled images are cached (see scaled_image_cache): drawing
+                    an image again at the same size costs the same as draw_image(). Sizes
+                    too large for the cache are not cached; only their visible (unclipped)
+                    part is resampled, at every draw.
+                 */
+                void draw_image_scaled(coord_t x, coord_t y, length_t w, length_t h, image_handle handle,
+                    image_filter filter = image_filter::bilinear)
+                {
+                    auto dest = to_box(x, y, w, h);
+                    auto area = clip(dest);
+                    if (area.empty()) return;
+
+                    auto img = _images.find(handle);
+                    if (!img) return;
+
+                    int width = dest.x2 - dest.x1, height = dest.y2 - dest.y1;
+                    auto target = dest;
+                    if (width != img->width || height != img->height) {
+                        if (_scaled_images.fits(width, height)) {
+                            img = &_scaled_images.get(handle, *img, width, height, filter, premultiplied::value);
+                        }
+                        else {
+                            // The visible part, in rows of the scaled image (top-down)
+                            int y1 = VertAxisDir == vertical_direction::down ? area.y1 - dest.y1 : dest.y2 - area.y2;
+                            img = &_scaled_images.resample_region(*img, width, height, area.x1 - dest.x1, y1,
+                                area.x2 - dest.x1, y1 + (area.y2 - area.y1), filter, premultiplied::value);
+                            target = area;
+                        }
+                    }
+
+                    draw_area(area, [&](const box &part) { blit_image(target, part, *img, 0, 0); });
+                }
+
+                /** Fills rectangles in one pass (see bulk_draw.hpp); a record with the
+                    same color as the previous one reuses its span setup.
+                 */
+                void fill_rects(const fill_record *records, std::size_t count)
+                {
+                    native_color color = {};
+                    rgba32 pixel = {};
+                    void (*span)(rgba32 *, std::size_t, rgba32) = nullptr;
+
+                    for (auto r = records, end = records + count; r < end; r++) {
+
+                        if (r->color.components[3] == 0) continue;
+                        if (!aligned(r->x, r->y, r->w, r->h)) { fill_rect(r->x, r->y, r->w, r->h, r->color); continue; }
+
+                        auto area = clip(to_box(r->x, r->y, r->w, r->h));
+                        if (area.empty()) continue;
+
+                        if (!span || !same_color(r->color, color)) {
+                            color = r->color, pixel = to_pixel(color), span = fill_span(color.components[3]);
+                        }
+                        draw_area(area, [&](const box &part) { fill_box(part, pixel, span); });
+                    }
+                }
+
+                /** Draws images in one pass (see bulk_draw.hpp); a record with the same
+                    image as the previous one reuses its lookup.
+                 */
+                void draw_images(const image_record *records, std::size_t count)
+                {
+                    const image *img = nullptr;
+                    image_handle handle = {};
+
+                    for (auto r = records, end = records + count; r < end; r++) {
+
+                        auto dest = to_box(r->x, r->y, r->w, r->h);
+                        auto area = clip(dest);
+                        if (area.empty()) continue;
+
+                        if (!img || r->image != handle) handle = r->image, img = _images.find(handle);
+                        if (!img) continue;
+
+                        draw_area(area, [&](const box &part) { blit_image(dest, part, *img, pixel(r->offset_x), pixel(r->offset_y)); });
+                    }
+                }
+
+                /** Replaces the clipping rectangle currently in effect (at any nesting
+                    level of push_clip()).
+                 */
+                void set_clipping_rect(coord_t x, coord_t y, length_t w, length_t h)
+                {
+                    _clip = intersect(to_box(x, y, w, h), surface());
+                }
+
+                void cancel_clipping()
+                {
+                    _clip = surface();
+                }
+
+                /** Restricts drawing to the intersection of the current clipping rectangle
+                    and the specified one, until the matching pop_clip(). Meant for nested
+                    widgets: each clips to its own bounds without having to know those of
+                    its parents.
+                 */
+                void push_clip(coord_t x, coord_t y, length_t w, length_t h)
+                {
+                    _clip_stack.push_back(_clip);
+                    _clip = intersect(to_box(x, y, w, h), _clip);
+                }
+
+                /** Restores the clipping rectangle that was in effect at the matching
+                    push_clip().
+                 */
+                void pop_clip()
+                {
+                    assert(!_clip_stack.empty());
+                    _clip = _clip_stack.back();
+                    _clip_stack.pop_back();
+                }
+
+                auto clip_depth() const -> std::size_t { return _clip_stack.size(); }
+
+                /** Where a rectangle lies relative to the current clipping rectangle, e.g.
+                    to skip drawing widgets that are entirely clipped away. Constant time.
+                 */
+                auto clip_test(coord_t x, coord_t y, length_t w, length_t h) const -> clip_result
+                {
+                    return classify(to_box(x, y, w, h));
+                }
+
+                /** Fonts with more glyphs than this get their glyph atlas built lazily
+                    (see glyph_atlas), unless specified otherwise.
+                 */
+                static const std::size_t LAZY_ATLAS_THRESHOLD = 2048;
+
+                auto register_font(const gpc::fonts::rasterized_font &rfont) -> font_handle
+                {
+                    return register_font(rfont, default_atlas_mode(rfont));
+                }
+
+                auto register_font(const gpc::fonts::rasterized_font &rfont, glyph_atlas::mode mode) -> font_handle
+                {
+                    return _fonts.add(rfont, mode);
+                }
+
+                /** Registers a font shared through a font_library. Registering the same
+                    font again returns the same handle (each registration must be matched
+                    by an unregister_font() call).
+                 */
+                auto register_font(const font_store::shared_font &font) -> font_handle
+                {
+                    return register_font(font, default_atlas_mode(*font));
+                }
+
+                auto register_font(const font_store::shared_font &font, glyph_atlas::mode mode) -> font_handle
+                {
+                    return _fonts.add(font, mode);
+                }
+
+                /** Registers a packed font (see packed_font), whose tables and coverage are
+                    used in place: no glyph atlas is built. The font data must remain
+                    available until the font is unregistered (packed_font::load_file()
+                    takes care of that).
+                 */
+                auto register_font(const packed_font &font) -> font_handle
+                {
+                    return _fonts.add(font);
+                }
+
+                /** Releases a font registration. When the last one goes, the glyph atlas
+                    and the cached text runs of the font are freed, and the handle becomes
+                    stale: rendering text with it does nothing.
+                 */
+                void unregister_font(font_handle handle)
+                {
+                    if (_fonts.release(handle)) _text_runs.invalidate_font(handle);
+                }
+
+                /** Glyph cache statistics (hit/miss counters etc.) of a registered font.
+                 */
+                auto font_stats(font_handle handle) const -> glyph_atlas::statistics
+                {
+                    auto atlas = _fonts.find(handle);
+                    return atlas ? atlas->stats() : glyph_atlas::statistics();
+                }
+
+                void reset_font_stats(font_handle handle)
+                {
+                    if (auto atlas = _fonts.find(handle)) atlas->reset_stats();
+                }
+
+                /** Statistics of the text run cache, which keeps the glyph placement of
+                    recently rendered lines of text (see text_run_cache).
+                 */
+                auto text_cache_stats() const -> text_run_cache::statistics { return _text_runs.stats(); }
+
+                void reset_text_cache_stats() { _text_runs.reset_stats(); }
+
+                void set_text_cache_capacity(std::size_t bytes) { _text_runs.set_capacity(bytes); }
+
+                void set_text_color(const native_color &color)
+                {
+                    _text_color = color;
+                }
+
+                /** Renders a line of text, (x, y) being the starting point on the baseline.
+                    Codepoints that the font does not contain are skipped.
+                 */
+                void render_text(font_handle handle, coord_t x, coord_t y, const char32_t *text, std::size_t count)
+                {
+                    if (_text_color.components[3] == 0) return;
+
+                    auto atlas = _fonts.find(handle);
+                    if (!atlas) return;
+
+                    int ox = pixel(x), oy = pixel(y);
+                    const auto &run = cached_run(*atlas, handle, x, y, text, count);
+
+                    // The whole line is culled at once, and its glyphs are not clipped if it is entirely visible
+                    auto visibility = classify({ ox + run.x1, oy + run.y1, ox + run.x2, oy + run.y2 });
+                    if (visibility == clip_result::outside) return;
+
+                    auto color = to_pixel(_text_color);
+                    auto coverage = atlas->atlas_data();
+                    for (const auto &g: run.glyphs) {
+                        box dest = { ox + g.dx, oy + g.dy, ox + g.dx + g.width, oy + g.dy + g.height };
+                        auto area = visibility == clip_result::inside ? dest : intersect(dest, _clip);
+                        if (!area.empty()) {
+                            draw_area(area, [&](const box &part) { blit_glyph(dest, part, coverage + g.offset, g.width, color); });
+                        }
+                    }
+                }
+
+                /** Same as render_text(), for UTF-8 encoded text. Ill-formed sequences are
+                    rendered as U+FFFD (if the font has that glyph).
+                 */
+                void render_text_utf8(font_handle handle, coord_t x, coord_t y, const char *text, std::size_t length)
+                {
+                    utf8_to_ucs4(text, length, _utf32);
+                    render_text(handle, x, y, _utf32.data(), _utf32.size());
+                }
+
+                /** Marks a part of the display as needing to be redrawn (see
+                    begin_partial_redraw()).
+                 */
+                void invalidate(coord_t x, coord_t y, length_t w, length_t h)
+                {
+                    auto area = intersect(to_box(x, y, w, h), surface());
+                    _redraw.add(area.x1, area.y1, area.x2, area.y2);
+                }
+
+                /** From now until end_partial_redraw(), drawing is restricted to the
+                    invalidated parts of the display (at tile granularity).
+                 */
+                void begin_partial_redraw()
+                {
+                    _partial = true;
+                }
+
+                /** Ends restricted drawing and forgets about the invalidated parts.
+                 */
+                void end_partial_redraw()
+                {
+                    _partial = false;
+                    _redraw.clear();
+                }
+
+                /** The framebuffer areas touched by drawing since the last call to
+                    reset_damage(), in framebuffer coordinates (see pixels()) and at tile
+                    granularity.
+                 */
+                auto damage() const -> const damage_tracker & { return _damage; }
+
+                void reset_damage()
+                {
+                    _damage.clear();
+                }
+
+                // Tile-safe rasterization --------------------------------------------
+
+                /* The following methods are meant for executors that split drawing up
+                   into tiles (see TiledRenderer). They draw only inside the specified clip
+                   box, bypass the clipping state, partial redraws and damage tracking, and
+                   do not modify the renderer itself: they may be called concurrently from
+                   different threads as long as the clip boxes do not overlap.
+                 */
+
+                auto framebuffer_box(coord_t x, coord_t y, length_t w, length_t h) const -> box { return to_box(x, y, w, h); }
+
+                /** The pixels that fill_rect() touches, including those that fractional
+                    edges only cover partially.
+                 */
+                auto coverage_box(coord_t x, coord_t y, length_t w, length_t h) const -> box
+                {
+                    auto x1 = grid::raw(x), y1 = grid::raw(y);
+                    return { grid::floor(x1), grid::floor(y1), grid::ceil(x1 + grid::raw(w)), grid::ceil(y1 + grid::raw(h)) };
+                }
+
+                auto surface_box () const -> box { return surface(); }
+                auto clipping_box() const -> box { return _clip; }
+
+                auto text_color() const -> native_color { return _text_color; }
+
+                /** The bounding box of the glyph pixels of a line of text. Also makes sure
+                    the glyphs are in the font's glyph atlas, so that raster_render_text()
+                    does not need to modify it.
+                 */
+                auto text_box(font_handle handle, coord_t x, coord_t y, const char32_t *text, std::size_t count) -> box
+                {
+                    auto atlas = _fonts.find(handle);
+                    if (!atlas) return { 0, 0, 0, 0 };
+
+                    const auto &run = cached_run(*atlas, handle, x, y, text, count);
+                    if (run.glyphs.empty()) return { 0, 0, 0, 0 };
+
+                    int ox = pixel(x), oy = pixel(y);
+                    return { ox + run.x1, oy + run.y1, ox + run.x2, oy + run.y2 };
+                }
+
+                void raster_clear(const box &clip, const native_color &color)
+                {
+                    auto area = intersect(clip, surface());
+                    if (!area.empty()) fill_box(area, to_pixel(color), _kernels->fill);
+                }
+
+                void raster_fill_rect(const box &clip, coord_t x, coord_t y, length_t w, length_t h, const native_color &color)
+                {
+                    unsigned alpha = color.components[3];
+                    if (alpha == 0) return;
+
+                    if (!aligned(x, y, w, h)) {
+                        for_each_covered_box(x, y, w, h, color, [&](const box &b, const native_color &c) {
+                            auto area = intersect(b, clip);
+                            if (!area.empty()) fill_box(area, to_pixel(c), fill_span(c.components[3]));
+                        });
+                        return;
+                    }
+
+                    auto area = intersect(to_box(x, y, w, h), clip);
+                    if (!area.empty()) fill_box(area, to_pixel(color), fill_span(alpha));
+                }
+
+                void raster_draw_image(const box &clip, coord_t x, coord_t y, length_t w, length_t h, image_handle handle,
+                    coord_t offset_x, coord_t offset_y)
+                {
+                    auto dest = to_box(x, y, w, h);
+                    auto area = intersect(dest, clip);
+                    auto img = _images.find(handle);
+                    if (img && !area.empty()) blit_image(dest, area, *img, pixel(offset_x), pixel(offset_y));
+                }
+
+                void raster_render_text(const box &clip, const native_color &color, font_handle handle, coord_t x, coord_t y,
+                    const char32_t *text, std::size_t count)
+                {
+                    if (color.components[3] == 0) return;
+
+                    for_each_glyph<false>(handle, x, y, text, count, [&](const box &dest, const uint8_t *coverage, int pitch) {
+                        auto area = intersect(dest, clip);
+                        if (!area.empty()) blit_glyph(dest, area, coverage, pitch, to_pixel(color));
+                    });
+                }
+
+                void add_damage(const box &area)
+                {
+                    _damage.add(area.x1, area.y1, area.x2, area.y2);
+                }
+
+                // Readback -------------------------------------------------------------
+
+                /** Zero-copy, read-only view of the framebuffer (see framebuffer_view),
+                    valid until the next call to define_viewport().
+                 */
+                auto framebuffer() const -> framebuffer_view
+                {
+                    auto data = reinterpret_cast<const uint8_t*>(_pixels.data());
+                    auto stride = std::ptrdiff_t(_width) * std::ptrdiff_t(sizeof(rgba32));
+                    if (VertAxisDir == vertical_direction::down || _height == 0) {
+                        return { data, _width, _height, stride, pixel_format::rgba32, vertical_direction::down };
+                    }
+
+                    // The top row is the last one in memory
+                    return { data + std::ptrdiff_t(_height - 1) * stride, _width, _height, -stride, pixel_format::rgba32, vertical_direction::up };
+                }
+
+                /** Copies the framebuffer into a caller-owned buffer, top row first, in the
+                    requested format (see gpc::gui::read_pixels()).
+                 */
+                void read_pixels(pixel_format format, uint8_t *dst, std::ptrdiff_t dst_stride = 0) const
+                {
+                    gpc::gui::read_pixels(framebuffer(), format, dst, dst_stride);
+                }
+
+                /** Debugging / testing: see the PixelRenderer concept.
+                 */
+                auto _getRGB24Screenshot() -> _RGB24Image
+                {
+                    static_assert(sizeof(_RGB24) == 3, "_RGB24 must be tightly packed");
+
+                    _RGB24Image image(_pixels.size());
+                    if (!image.empty()) read_pixels(pixel_format::rgb24, &image[0].rgb[0]);
+
+                    return image;
+                }
+
+            private:
+
+                using image = image_store::image;
+
+                using premultiplied = std::integral_constant<bool, AlphaMode == alpha_mode::premultiplied>;
+
+                using grid = coord_traits<CoordType>;
+
+                static constexpr auto to_native(const rgba32 &color, std::false_type) -> rgba32 { return color; }
+                static constexpr auto to_native(const rgba32 &color, std::true_type ) -> rgba32_premul { return premultiply(color); }
+
+                // Native colors as framebuffer pixels (the kernels work on rgba32 either way)
+                static auto to_pixel(const rgba32 &color) -> rgba32 { return color; }
+                static auto to_pixel(const rgba32_premul &color) -> rgba32
+                {
+                    return { { color.components[0], color.components[1], color.components[2], color.components[3] } };
+                }
+
+                template <typename Color>
+                static bool same_color(const Color &a, const Color &b)
+                {
+                    return std::equal(a.components, a.components + 4, b.components);
+                }
+
+                // A native color with its opacity scaled by a coverage (0 - 255)
+                static auto covered(const rgba32 &color, unsigned coverage) -> rgba32
+                {
+                    return { { color.components[0], color.components[1], color.components[2], div_255(color.components[3] * coverage) } };
+                }
+                static auto covered(const rgba32_premul &color, unsigned coverage) -> rgba32_premul
+                {
+                    return { { div_255(color.components[0] * coverage), div_255(color.components[1] * coverage),
+                        div_255(color.components[2] * coverage), div_255(color.components[3] * coverage) } };
+                }
+
+                auto fill_span(unsigned alpha) const -> void (*)(rgba32 *, std::size_t, rgba32)
+                {
+                    return alpha == 255 ? _kernels->fill : premultiplied::value ? _kernels->blend_color_premul : _kernels->blend_color;
+                }
+
+                static auto default_atlas_mode(const gpc::fonts::rasterized_font &rfont) -> glyph_atlas::mode
+                {
+                    return rfont.variants[0].glyphs.size() > LAZY_ATLAS_THRESHOLD ? glyph_atlas::mode::lazy : glyph_atlas::mode::eager;
+                }
+
+                static auto intersect(const box &a, const box &b) -> box
+                {
+                    return { std::max(a.x1, b.x1), std::max(a.y1, b.y1), std::min(a.x2, b.x2), std::min(a.y2, b.y2) };
+                }
+
+                auto classify(const box &b) const -> clip_result
+                {
+                    if (b.empty() || _clip.empty() || b.x2 <= _clip.x1 || b.x1 >= _clip.x2 || b.y2 <= _clip.y1 || b.y1 >= _clip.y2) {
+                        return clip_result::outside;
+                    }
+                    if (b.x1 >= _clip.x1 && b.x2 <= _clip.x2 && b.y1 >= _clip.y1 && b.y2 <= _clip.y2) return clip_result::inside;
+                    return clip_result::partial;
+                }
+
+                // The part of a box that is inside the clipping rectangle (empty if none)
+                auto clip(const box &b) const -> box
+                {
+                    switch (classify(b)) {
+                    case clip_result::inside : return b;
+                    case clip_result::outside: return { 0, 0, 0, 0 };
+                    default                  : return intersect(b, _clip);
+                    }
+                }
+
+                static auto wrap(int v, int n) -> int
+                {
+                    v %= n;
+                    return v < 0 ? v + n : v;
+                }
+
+                // (a * b + c * d) / 255, rounded; the sum of the products must not exceed 255 * 255
+                static auto div_255(unsigned v) -> uint8_t
+                {
+                    v += 128;
+                    return uint8_t((v + (v >> 8)) >> 8);
+                }
+
+                static void blend_pixel(rgba32 &dst, const rgba32 &src, unsigned alpha)
+                {
+                    unsigned inv = 255 - alpha;
+                    dst.components[0] = div_255(src.components[0] * alpha + dst.components[0] * inv);
+                    dst.components[1] = div_255(src.components[1] * alpha + dst.components[1] * inv);
+                    dst.components[2] = div_255(src.components[2] * alpha + dst.components[2] * inv);
+                    dst.components[3] = div_255(255 * alpha + dst.components[3] * inv);
+                }
+
+                // Source-over of a premultiplied color onto a premultiplied pixel
+                static void blend_pixel_premul(rgba32 &dst, const rgba32 &src)
+                {
+                    unsigned inv = 255 - src.components[3];
+                    for (int i = 0; i < 4; i++) {
+                        unsigned v = src.components[i] + div_255(dst.components[i] * inv);
+                        dst.components[i] = uint8_t(std::min(v, 255U));
+                    }
+                }
+
+                static void blend_span(rgba32 *dst, const rgba32 *src, int count)
+                {
+                    for (auto end = dst + count; dst < end; dst++, src++) {
+                        unsigned alpha = src->components[3];
+                        if      (alpha == 255) *dst = *src;
+                        else if (alpha != 0  ) blend_pixel(*dst, *src, alpha);
+                    }
+                }
+
+                auto surface() const -> box { return { 0, 0, _width, _height }; }
+
+                // Nearest pixel boundary of a coordinate or length
+                template <typename T>
+                static auto pixel(T v) -> int { return grid::round(grid::raw(v)); }
+
+                // Always true with integral coordinates
+                static auto aligned(coord_t x, coord_t y, length_t w, length_t h) -> bool
+                {
+                    return grid::aligned(grid::raw(x)) && grid::aligned(grid::raw(y)) && grid::aligned(grid::raw(w)) && grid::aligned(grid::raw(h));
+                }
+
+                static auto to_box(coord_t x, coord_t y, length_t w, length_t h) -> box
+                {
+                    auto x1 = grid::raw(x), y1 = grid::raw(y);
+                    return { grid::round(x1), grid::round(y1), grid::round(x1 + grid::raw(w)), grid::round(y1 + grid::raw(h)) };
+                }
+
+                /** Splits the pixels touched by a rectangle with fractional edges into
+                    boxes of uniform coverage (at most 3 x 3: corners, edges, inside), and
+                    calls fn(box, color) for each one that is covered at all, with the
+                    color scaled by the coverage.
+                 */
+                template <typename Fn>
+                static void for_each_covered_box(coord_t x, coord_t y, length_t w, length_t h, const native_color &color, Fn &&fn)
+                {
+                    struct band { int p1, p2, coverage; };   // pixels [p1, p2), covered by coverage subpixels each
+
+                    auto split = [](int a1, int a2, band *bands) -> int {
+                        if (a2 <= a1) return 0;
+                        int p1 = grid::floor(a1), p2 = grid::ceil(a2);
+                        if (p2 - p1 == 1) { bands[0] = { p1, p2, a2 - a1 }; return 1; }
+
+                        int i1 = grid::ceil(a1), i2 = grid::floor(a2), n = 0;     // fully covered: [i1, i2)
+                        if (p1 < i1) bands[n++] = { p1, i1, i1 * grid::one - a1 };
+                        if (i1 < i2) bands[n++] = { i1, i2, grid::one };
+                        if (i2 < p2) bands[n++] = { i2, p2, a2 - i2 * grid::one };
+                        return n;
+                    };
+
+                    int x1 = grid::raw(x), x2 = x1 + grid::raw(w), y1 = grid::raw(y), y2 = y1 + grid::raw(h);
+
+                    band cols[3], rows[3];
+                    int nc = split(x1, x2, cols), nr = split(y1, y2, rows);
+                    const uint64_t full = uint64_t(grid::one) * uint64_t(grid::one);
+
+                    for (int r = 0; r < nr; r++) {
+                        for (int c = 0; c < nc; c++) {
+                            auto coverage = unsigned((uint64_t(rows[r].coverage) * uint64_t(cols[c].coverage) * 255 + full / 2) / full);
+                            auto scaled = coverage == 255 ? color : covered(color, coverage);
+                            if (scaled.components[3] != 0) fn(box { cols[c].p1, rows[r].p1, cols[c].p2, rows[r].p2 }, scaled);
+                        }
+                    }
+                }
+
+                auto row(int y) -> rgba32 * { return &_pixels[std::size_t(y) * std::size_t(_width)]; }
+
+                /** Executes a drawing function on the (already clipped) area, or, during
+                    partial redraws, on those parts of it that need redrawing. Records damage.
+                 */
+                template <typename Fn>
+                void draw_area(const box &area, Fn &&fn)
+                {
+                    if (!_partial) {
+                        fn(area);
+                        _damage.add(area.x1, area.y1, area.x2, area.y2);
+                    }
+                    else {
+                        _redraw.for_each_part(area.x1, area.y1, area.x2, area.y2, [&](int x1, int y1, int x2, int y2) {
+                            fn(box { x1, y1, x2, y2 });
+                            _damage.add(x1, y1, x2, y2);
+                        });
+                    }
+                }
+
+                void fill_box(const box &area, const rgba32 &color, void (*span)(rgba32 *, std::size_t, rgba32))
+                {
+                    auto w = std::size_t(area.x2 - area.x1);
+                    for (int y = area.y1; y < area.y2; y++) {
+                        span(row(y) + area.x1, w, color);
+                    }
+                }
+
+                /** Image rows run top-down: with an upward axis, the first row of the
+                    image goes into the last row of the destination.
+
+                    Every destination row is the same sequence of runs: a head from the
+                    offset to the right edge of the image, whole image rows, and a tail;
+                    they are computed once. Opaque images are copied rather than blended
+                    (which gives the same pixels): the first image row of a destination
+                    row is repeated by copying what has been written already, doubling
+                    the length of every copy, and destination rows that are a whole image
+                    height apart are copied in one piece.
+                 */
+                void blit_image(const box &dest, const box &area, const image &img, int offset_x, int offset_y)
+                {
+                    int sx0 = wrap(offset_x + area.x1 - dest.x1, img.width );
+                    int sy  = VertAxisDir == vertical_direction::down ? wrap(offset_y + area.y1 - dest.y1, img.height)
+                                                                      : wrap(offset_y + dest.y2 - 1 - area.y1, img.height);
+
+                    auto width = std::size_t(area.x2 - area.x1);
+                    auto head  = std::min(width, std::size_t(img.width - sx0));
+                    auto tiles = (width - head) / std::size_t(img.width);
+                    auto tail  = (width - head) % std::size_t(img.width);
+
+                    for (int y = area.y1; y < area.y2; y++) {
+
+                        const rgba32 *src_row = &img.pixels[std::size_t(sy) * std::size_t(img.width)];
+                        rgba32 *dst = row(y) + area.x1;
+
+                        if (!img.opaque) {
+                            blend_image_span(dst, src_row + sx0, head), dst += head;
+                            for (std::size_t i = 0; i < tiles; i++) blend_image_span(dst, src_row, std::size_t(img.width)), dst += img.width;
+                            blend_image_span(dst, src_row, tail);
+                        }
+                        else if (y - area.y1 >= img.height) {
+                            std::memcpy(dst, row(y - img.height) + area.x1, width * sizeof(rgba32));
+                        }
+                        else {
+                            std::memcpy(dst, src_row + sx0, head * sizeof(rgba32));
+                            if (tiles > 0 || tail > 0) {
+                                auto period = std::min(width - head, std::size_t(img.width));
+                                std::memcpy(dst + head, src_row, period * sizeof(rgba32));
+                                for (auto done = head + period; done < width; ) {
+                                    auto n = std::min(done - head, width - done);
+                                    std::memcpy(dst + done, dst + head, n * sizeof(rgba32));
+                                    done += n;
+                                }
+                            }
+                        }
+
+                        if (VertAxisDir == vertical_direction::down) { if (++sy == img.height) sy = 0; }
+                        else { if (sy-- == 0) sy = img.height - 1; }
+                    }
+                }
+
+                void blend_image_span(rgba32 *dst, const rgba32 *src, std::size_t count)
+                {
+                    if (premultiplied::value) _kernels->blend_premul(dst, src, count);
+                    else blend_span(dst, src, int(count));
+                }
+
+                /** Calls fn(dest, coverage, pitch) for every glyph of a line of text that
+                    has pixels. With Acquire, glyphs are looked up through
+                    glyph_atlas::acquire() (packing them on demand and counting hits and
+                    misses), otherwise through the side-effect free glyph_atlas::find().
+                 */
+                template <bool Acquire, typename Fn>
+                void for_each_glyph(font_handle handle, coord_t x, coord_t y, const char32_t *text, std::size_t count, Fn &&fn)
+                {
+                    auto font = _fonts.find(handle);
+                    if (!font) return;
+
+                    auto &atlas = *font;
+
+                    for (auto end = text + count; text < end; text++) {
+
+                        auto glyph = Acquire ? atlas.acquire(*text) : static_cast<const glyph_atlas &>(atlas).find(*text);
+                        if (!glyph) continue;
+
+                        if (glyph->width > 0 && glyph->height > 0) {
+                            coord_t gy = VertAxisDir == vertical_direction::down ? y - (glyph->y_min + glyph->height) : y + glyph->y_min;
+                            fn(to_box(x + glyph->x_min, gy, glyph->width, glyph->height), atlas.coverage(*glyph), glyph->width);
+                        }
+
+                        x += glyph->adv_x;
+                    }
+                }
+
+                /** The glyph placement of a line of text, from the text run cache (laying
+                    the text out and caching it if necessary). The glyph atlas must be
+                    that of the font; coverage offsets refer to its data as of the return.
+                 */
+                auto cached_run(glyph_atlas &atlas, font_handle handle, coord_t x, coord_t y, const char32_t *text, std::size_t count)
+                    -> const text_run_cache::run &
+                {
+                    auto run = _text_runs.find(handle, text, count);
+                    if (run) return *run;
+
+                    int ox = pixel(x), oy = pixel(y);
+                    _run_glyphs.clear();
+                    for_each_glyph<true>(handle, x, y, text, count, [&](const box &dest, const uint8_t *coverage, int pitch) {
+                        // (offset must be taken right away, as the atlas may grow while laying out the run)
+                        _run_glyphs.push_back({ dest.x1 - ox, dest.y1 - oy, pitch, dest.y2 - dest.y1,
+                            uint32_t(coverage - atlas.atlas_data()) });
+                    });
+                    return _text_runs.insert(handle, text, count, _run_glyphs);
+                }
+
+                /** Coverage rows run top-down, so with an upward axis they are walked
+                    backwards.
+                 */
+                void blit_glyph(const box &dest, const box &area, const uint8_t *coverage, int pitch, const rgba32 &color)
+                {
+                    unsigned color_alpha = color.components[3];
+
+                    int first = VertAxisDir == vertical_direction::down ? area.y1 - dest.y1 : dest.y2 - 1 - area.y1;
+                    auto step = VertAxisDir == vertical_direction::down ? std::ptrdiff_t(pitch) : -std::ptrdiff_t(pitch);
+                    coverage += std::size_t(first) * std::size_t(pitch) + std::size_t(area.x1 - dest.x1);
+
+                    for (int y = area.y1; y < area.y2; y++, coverage += step) {
+                        auto dst = row(y) + area.x1;
+                        auto src = coverage;
+                        for (auto end = dst + (area.x2 - area.x1); dst < end; dst++, src++) {
+                            if (*src == 0) continue;
+                            if ((*src & color_alpha) == 255) { *dst = color; continue; }
+                            if (premultiplied::value) {
+                                // Coverage scales all components of a premultiplied color
+                                unsigned c = *src;
+                                blend_pixel_premul(*dst, rgba32 { { div_255(color.components[0] * c), div_255(color.components[1] * c),
+                                    div_255(color.components[2] * c), div_255(color_alpha * c) } });
+                                continue;
+                            }
+                            unsigned alpha = color_alpha == 255 ? *src : div_255(*src * color_alpha);
+                            blend_pixel(*dst, color, alpha);
+                        }
+                    }
+                }
+
+                int                     _width, _height;
+                std::vector<rgba32>     _pixels;
+                box                     _clip;
+                std::vector<box>        _clip_stack;
+                native_color            _text_color = { { 0, 0, 0, 255 } };
+                image_store             _images;
+                font_store              _fonts;
+                const span_kernels     *_kernels;
+                text_run_cache          _text_runs;
+                scaled_image_cache      _scaled_images;
+                std::vector<text_run_cache::placed_glyph> _run_glyphs;    // scratch buffer
+                std::vector<char32_t>   _utf32;                             // scratch buffer
+                damage_tracker          _damage;
+                damage_tracker          _redraw;
+                bool                    _partial = false;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "../color.hpp"
+#include "image_store.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** How draw_image_scaled() resamples images:
+                - bilinear: interpolates between the 2x2 nearest source pixels (smooth
+                            when enlarging; skips pixels when reducing by more than half)
+                - box:      averages the source pixels covered by each destination pixel,
+                            weighted by the covered area (the better choice for thumbnails)
+             */
+            enum class image_filter { bilinear, box };
+
+            namespace detail {
+
+                // Resampling weights are fixed-point numbers with 12 fractional bits
+                const int RESAMPLE_WEIGHT_BITS = 12;
+                const int RESAMPLE_WEIGHT_ONE  = 1 << RESAMPLE_WEIGHT_BITS;
+
+                // The source pixels that contribute to a destination pixel, and their weights
+                struct taps {
+                    int         first, count;
+                    std::size_t weights;        // index of the first weight in taps_table::weights
+                };
+
+                struct taps_table {
+                    std::vector<taps>       pixels;
+                    std::vector<uint16_t>   weights;
+                };
+
+                /** Weights of the source pixels (0 to src - 1) for the destination pixels
+                    first to last - 1 (of 0 to dst - 1) along one axis; the weights of a
+                    pixel add up to RESAMPLE_WEIGHT_ONE exactly.
+
+                    The weights are quantized cumulatively (every weight is the difference
+                    between the rounded sums up to and including it, and before it), so
+                    that each stays within 0 to RESAMPLE_WEIGHT_ONE whatever the number of
+                    taps: when a box covers thousands of source pixels, the rounding
+                    spreads the weight evenly over them instead of overflowing.
+                 */
+                inline void make_taps(int src, int dst, int first_pixel, int last_pixel, image_filter filter, taps_table &table)
+                {
+                    table.pixels.clear(), table.weights.clear();
+
+                    double scale = double(src) / dst;
+                    std::vector<double> w;
+
+                    for (int i = first_pixel; i < last_pixel; i++) {
+                        int first;
+                        w.clear();
+                        if (filter == image_filter::bilinear) {
+                            double center = (i + 0.5) * scale - 0.5;
+                            double f = std::floor(center);
+                            int x0 = int(f);
+                            double t = center - f;
+                            // Clamp to the edges of the image
+                            if (x0 < 0)             first = 0,       w.push_back(1);
+                            else if (x0 >= src - 1) first = src - 1, w.push_back(1);
+                            else                    first = x0,      w.push_back(1 - t), w.push_back(t);
+                        }
+                        else {
+                            double x1 = i * scale, x2 = (i + 1) * scale;
+                            first = int(x1);
+                            int last = std::min(src, int(std::ceil(x2)));
+                            for (int x = first; x < last; x++) w.push_back(std::min(x2, x + 1.0) - std::max(x1, double(x)));
+                        }
+
+                        double total = 0;
+                        for (auto v: w) total += v;
+                        taps t = { first, int(w.size()), table.weights.size() };
+                        double sum = 0;
+                        int previous = 0;
+                        for (std::size_t k = 0; k < w.size(); k++) {
+                            sum += w[k];
+                            int q = k + 1 < w.size() ? std::min(RESAMPLE_WEIGHT_ONE, int(sum / total * RESAMPLE_WEIGHT_ONE + 0.5)) : RESAMPLE_WEIGHT_ONE;
+                            table.weights.push_back(uint16_t(q - previous));
+                            previous = q;
+                        }
+                        table.pixels.push_back(t);
+                    }
+                }
+
+                // The range of source pixels read through a taps table
+                inline void source_range(const taps_table &table, int &first, int &last)
+                {
+                    first = table.pixels.front().first, last = first;
+                    for (const auto &t: table.pixels) first = std::min(first, t.first), last = std::max(last, t.first + t.count);
+                }
+
+            } // ns detail
+
+            /** LRU cache of resampled images ("variants"), used by the CPU renderer so
+                that drawing an image again at the same size costs a plain blit.
+
+                Variants are keyed by image handle, size and filter. Because handles
+                carry the generation of their slot, a variant can never be mistaken for
+                one of a different image; the renderer still invalidates the variants of
+                an image when it is freed, to give their memory back right away.
+
+                The cache is bounded by a memory budget: when an insertion exceeds it,
+                the least recently used variants are evicted. Variants larger than the
+                whole budget (e.g. an image zoomed far in) are not made at all: the
+                renderer resamples only the visible part of them, on every draw (see
+                resample_region()).
+
+                Resampling is separable (horizontal, then vertical) with 12-bit integer
+                weights, and done on premultiplied pixels, so that transparent pixels do
+                not bleed their color into their neighbours.
+             */
+            class scaled_image_cache {
+            public:
+
+                static const std::size_t DEFAULT_CAPACITY = 16 * 1024 * 1024;
+
+                using image = image_store::image;
+
+                struct statistics {
+                    std::size_t hits, misses, evictions;
+                    std::size_t variants, bytes, capacity;
+                };
+
+                explicit scaled_image_cache(std::size_t capacity_ = DEFAULT_CAPACITY):
+                    capacity(capacity_), bytes(0), hits(0), misses(0), evictions(0) {}
+
+                /** Returns the variant of the image (designated by handle, with pixels
+                    src) of the specified size, resampling it on a miss. Premultiplied
+                    tells whether the source pixels are premultiplied; the variant has
+                    the same alpha mode.
+                 */
+                auto get(image_store::handle handle, const image &src, int width, int height, image_filter filter, bool premultiplied) -> const image &
+                {
+                    auto key = hash(handle, width, height, filter);
+
+                    auto it = index.find(key);
+                    if (it != index.end()) {
+                        if (matches(*it->second, handle, width, height, filter)) {
+                            hits++;
+                            variants.splice(variants.begin(), variants, it->second);
+                            return variants.front().view;
+                        }
+                        erase(it->second);      // hash collision
+                    }
+                    misses++;
+
+                    auto size = variant_size(width, height);
+                    while (!variants.empty() && bytes + size > capacity) {
+                        evictions++;
+                        erase(std::prev(variants.end()));
+                    }
+
+                    variants.emplace_front();
+                    auto &v = variants.front();
+                    v.key = key, v.handle = handle, v.filter = filter;
+                    v.pixels.resize(std::size_t(width) * std::size_t(height));
+                    resample(src, width, height, 0, 0, width, height, filter, premultiplied, v.pixels.data());
+                    v.view = { width, height, v.pixels.data(), src.opaque };
+
+                    index[key] = variants.begin();
+                    bytes += size;
+
+                    return v.view;
+                }
+
+                /** True if a variant of the specified size can be cached.
+                 */
+                auto fits(int width, int height) const -> bool { return variant_size(width, height) <= capacity; }
+
+                /** Resamples the part x1, y1 - x2, y2 (in pixels of the scaled image,
+                    rows top-down) of the image scaled to width x height, without caching
+                    it (counted as a miss). Only the source pixels contributing to that
+                    part are read. The result is valid until the next call.
+                 */
+                auto resample_region(const image &src, int width, int height, int x1, int y1, int x2, int y2,
+                    image_filter filter, bool premultiplied) -> const image &
+                {
+                    misses++;
+
+                    region.resize(std::size_t(x2 - x1) * std::size_t(y2 - y1));
+                    resample(src, width, height, x1, y1, x2, y2, filter, premultiplied, region.data());
+                    region_view = { x2 - x1, y2 - y1, region.data(), src.opaque };
+
+                    return region_view;
+                }
+
+                /** Removes all variants of an image (e.g. when the image is freed).
+                 */
+                void invalidate_image(image_store::handle handle)
+                {
+                    for (auto it = variants.begin(); it != variants.end(); ) {
+                        auto next = std::next(it);
+                        if (it->handle == handle) erase(it);
+                        it = next;
+                    }
+                }
+
+                void clear()
+                {
+                    while (!variants.empty()) erase(variants.begin());
+                }
+
+                void set_capacity(std::size_t capacity_)
+                {
+                    capacity = capacity_;
+                    while (!variants.empty() && bytes > capacity) erase(std::prev(variants.end()));
+                }
+
+                auto stats() const -> statistics
+                {
+                    return { hits, misses, evictions, variants.size(), bytes, capacity };
+                }
+
+                void reset_stats() { hits = misses = evictions = 0; }
+
+            private:
+
+                struct variant {
+                    uint64_t                key;
+                    image_store::handle     handle;
+                    image_filter            filter;
+                    std::vector<rgba32>     pixels;
+                    image                   view;
+                };
+
+                using variant_list = std::list<variant>;
+
+                static auto variant_size(int width, int height) -> std::size_t
+                {
+                    return sizeof(variant) + 2 * sizeof(void*) + std::size_t(width) * std::size_t(height) * sizeof(rgba32);
+                }
+
+                // FNV-1a over the image handle, the size and the filter
+                static auto hash(image_store::handle handle, int width, int height, image_filter filter) -> uint64_t
+                {
+                    uint64_t h = 14695981039346656037ULL;
+                    for (uint64_t v: { uint64_t(handle), uint64_t(uint32_t(width)), uint64_t(uint32_t(height)), uint64_t(filter) }) {
+                        h ^= v;
+                        h *= 1099511628211ULL;
+                    }
+                    return h;
+                }
+
+                static auto matches(const variant &v, image_store::handle handle, int width, int height, image_filter filter) -> bool
+                {
+                    return v.handle == handle && v.view.width == width && v.view.height == height && v.filter == filter;
+                }
+
+                void erase(variant_list::iterator it)
+                {
+                    index.erase(it->key);
+                    bytes -= variant_size(it->view.width, it->view.height);
+                    variants.erase(it);
+                }
+
+                /** Resamples the part x1, y1 - x2, y2 of the image scaled to width x
+                    height into dst (of (x2 - x1) x (y2 - y1) pixels).
+                 */
+                void resample(const image &src, int width, int height, int x1, int y1, int x2, int y2,
+                    image_filter filter, bool premultiplied, rgba32 *dst)
+                {
+                    detail::make_taps(src.width, width, x1, x2, filter, columns);
+                    detail::make_taps(src.height, height, y1, y2, filter, rows);
+
+                    int sx1, sx2, sy1, sy2;
+                    detail::source_range(columns, sx1, sx2);
+                    detail::source_range(rows, sy1, sy2);
+
+                    auto out_width = std::size_t(x2 - x1), out_height = std::size_t(y2 - y1);
+                    bool convert = !premultiplied && !src.opaque;   // filter premultiplied pixels
+
+                    // Horizontal pass: the source rows in use, at the output width (in 1/256 units)
+                    interim.resize(std::size_t(sy2 - sy1) * out_width * 4);
+                    for (int y = sy1; y < sy2; y++) {
+                        auto in = src.pixels + std::size_t(y) * std::size_t(src.width) + sx1;
+                        if (convert) {
+                            source.resize(std::size_t(sx2 - sx1));
+                            premultiply(in, source.size(), reinterpret_cast<rgba32_premul*>(source.data()));
+                            in = source.data();
+                        }
+                        auto out = &interim[std::size_t(y - sy1) * out_width * 4];
+                        for (const auto &t: columns.pixels) {
+                            uint32_t sum[4] = { 0, 0, 0, 0 };
+                            auto weight = &columns.weights[t.weights];
+                            for (int k = 0; k < t.count; k++) {
+                                const auto &p = in[t.first - sx1 + k];
+                                for (int c = 0; c < 4; c++) sum[c] += p.components[c] * uint32_t(weight[k]);
+                            }
+                            for (int c = 0; c < 4; c++) *out++ = uint16_t((sum[c] + (1 << (detail::RESAMPLE_WEIGHT_BITS - 9))) >> (detail::RESAMPLE_WEIGHT_BITS - 8));
+                        }
+                    }
+
+                    // Vertical pass
+                    for (std::size_t y = 0; y < out_height; y++) {
+                        const auto &t = rows.pixels[y];
+                        auto weight = &rows.weights[t.weights];
+                        auto out = dst + y * out_width;
+                        for (std::size_t x = 0; x < out_width; x++, out++) {
+                            uint32_t sum[4] = { 0, 0, 0, 0 };
+                            for (int k = 0; k < t.count; k++) {
+                                auto in = &interim[(std::size_t(t.first - sy1 + k) * out_width + x) * 4];
+                                for (int c = 0; c < 4; c++) sum[c] += in[c] * uint32_t(weight[k]);
+                            }
+                            for (int c = 0; c < 4; c++) out->components[c] = uint8_t((sum[c] + (1u << (detail::RESAMPLE_WEIGHT_BITS + 7))) >> (detail::RESAMPLE_WEIGHT_BITS + 8));
+                        }
+                    }
+
+                    if (convert) unpremultiply(reinterpret_cast<const rgba32_premul*>(dst), out_width * out_height, dst);
+                }
+
+                variant_list                                        variants;   // most recently used first
+                std::unordered_map<uint64_t, variant_list::iterator> index;
+                std::size_t                                         capacity, bytes;
+                std::size_t                                         hits, misses, evictions;
+
+                // Scratch buffers, kept to avoid allocations
+                detail::taps_table                                  columns, rows;
+                std::vector<rgba32>                                 source;     // a premultiplied source row
+                std::vector<uint16_t>                               interim;
+                std::vector<rgba32>                                 region;     // see resample_region()
+                image                                               region_view = { 0, 0, nullptr, false };
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include "../renderer.hpp"
+#include "../cpu_features.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** A set of functions that process horizontal runs ("spans") of rgba32 pixels.
+
+                Every implementation (scalar, SSE2, AVX2, NEON) computes bit-identical
+                results; they differ in speed only. All divisions by 255 are rounded.
+
+                - fill:          overwrites the span with the color (no blending)
+                - blend_color:   source-over of a constant straight-alpha color
+                - blend_premul:  source-over of premultiplied source pixels onto premultiplied
+                                 destination pixels
+                - blend_color_premul: source-over of a constant premultiplied color onto
+                                 premultiplied destination pixels (same result as blend_premul
+                                 with a source span of that color)
+             */
+            struct span_kernels {
+                simd_level  level;
+                const char *name;
+                void (*fill        )(rgba32 *dst, std::size_t count, rgba32 color);
+                void (*blend_color )(rgba32 *dst, std::size_t count, rgba32 color);
+                void (*blend_premul)(rgba32 *dst, const rgba32 *src, std::size_t count);
+                void (*blend_color_premul)(rgba32 *dst, std::size_t count, rgba32 color);
+            };
+
+            namespace detail {
+
+                inline auto div_255(unsigned v) -> uint8_t
+                {
+                    v += 128;
+                    return uint8_t((v + (v >> 8)) >> 8);
+                }
+
+                inline auto pack(rgba32 color) -> uint32_t
+                {
+                    uint32_t v;
+                    std::memcpy(&v, &color, 4);
+                    return v;
+                }
+
+                // Scalar ---------------------------------------------------------
+
+                inline void fill_scalar(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    std::fill_n(dst, count, color);
+                }
+
+                inline void blend_color_scalar(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    unsigned alpha = color.components[3], inv = 255 - alpha;
+                    unsigned r = color.components[0] * alpha, g = color.components[1] * alpha, b = color.components[2] * alpha;
+                    unsigned a = 255 * alpha;
+
+                    for (auto end = dst + count; dst < end; dst++) {
+                        dst->components[0] = div_255(r + dst->components[0] * inv);
+                        dst->components[1] = div_255(g + dst->components[1] * inv);
+                        dst->components[2] = div_255(b + dst->components[2] * inv);
+                        dst->components[3] = div_255(a + dst->components[3] * inv);
+                    }
+                }
+
+                inline void blend_premul_scalar(rgba32 *dst, const rgba32 *src, std::size_t count)
+                {
+                    for (auto end = dst + count; dst < end; dst++, src++) {
+                        unsigned inv = 255 - src->components[3];
+                        for (int i = 0; i < 4; i++) {
+                            unsigned v = src->components[i] + div_255(dst->components[i] * inv);
+                            dst->components[i] = uint8_t(std::min(v, 255U));
+                        }
+                    }
+                }
+
+                inline void blend_color_premul_scalar(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    unsigned inv = 255 - color.components[3];
+                    unsigned r = color.components[0], g = color.components[1], b = color.components[2], a = color.components[3];
+
+                    for (auto end = dst + count; dst < end; dst++) {
+                        dst->components[0] = uint8_t(std::min(r + div_255(dst->components[0] * inv), 255U));
+                        dst->components[1] = uint8_t(std::min(g + div_255(dst->components[1] * inv), 255U));
+                        dst->components[2] = uint8_t(std::min(b + div_255(dst->components[2] * inv), 255U));
+                        dst->components[3] = uint8_t(std::min(a + div_255(dst->components[3] * inv), 255U));
+                    }
+                }
+
+                #if defined(GPC_GUI_X86)
+
+                // SSE2 -----------------------------------------------------------
+
+                // (v + 128) / 255 on 16-bit lanes, rounded exactly like div_255()
+                GPC_GUI_TARGET("sse2") inline auto div_255_sse2(__m128i v) -> __m128i
+                {
+                    v = _mm_add_epi16(v, _mm_set1_epi16(128));
+                    return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+                }
+
+                GPC_GUI_TARGET("sse2") inline void fill_sse2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c = _mm_set1_epi32(int(pack(color)));
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), c);
+                    for (; dst < end; dst++) *dst = color;
+                }
+
+                GPC_GUI_TARGET("sse2") inline void blend_color_sse2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    short alpha = color.components[3];
+                    // Source term per lane: color * alpha (alpha lane: 255 * alpha)
+                    auto src = _mm_setr_epi16(
+                        short(color.components[0] * alpha), short(color.components[1] * alpha), short(color.components[2] * alpha), short(255 * alpha),
+                        short(color.components[0] * alpha), short(color.components[1] * alpha), short(color.components[2] * alpha), short(255 * alpha));
+                    auto inv  = _mm_set1_epi16(short(255 - alpha));
+                    auto zero = _mm_setzero_si128();
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) {
+                        auto d  = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+                        auto lo = div_255_sse2(_mm_add_epi16(src, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv)));
+                        auto hi = div_255_sse2(_mm_add_epi16(src, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv)));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+                    }
+                    blend_color_scalar(dst, std::size_t(end - dst), color);
+                }
+
+                GPC_GUI_TARGET("sse2") inline auto blend_premul_sse2_half(__m128i s, __m128i d) -> __m128i
+                {
+                    // Broadcast each pixel's source alpha to its 4 lanes
+                    auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                    auto inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+                    return div_255_sse2(_mm_mullo_epi16(d, inv));
+                }
+
+                GPC_GUI_TARGET("sse2") inline void blend_premul_sse2(rgba32 *dst, const rgba32 *src, std::size_t count)
+                {
+                    auto zero = _mm_setzero_si128();
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4, src += 4) {
+                        auto s  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                        auto d  = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+                        auto lo = blend_premul_sse2_half(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+                        auto hi = blend_premul_sse2_half(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+                    }
+                    blend_premul_scalar(dst, src, std::size_t(end - dst));
+                }
+
+                GPC_GUI_TARGET("sse2") inline void blend_color_premul_sse2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c    = _mm_set1_epi32(int(pack(color)));
+                    auto inv  = _mm_set1_epi16(short(255 - color.components[3]));
+                    auto zero = _mm_setzero_si128();
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) {
+                        auto d  = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+                        auto lo = div_255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv));
+                        auto hi = div_255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_adds_epu8(c, _mm_packus_epi16(lo, hi)));
+                    }
+                    blend_color_premul_scalar(dst, std::size_t(end - dst), color);
+                }
+
+                // AVX2 -----------------------------------------------------------
+
+                GPC_GUI_TARGET("avx2") inline auto div_255_avx2(__m256i v) -> __m256i
+                {
+                    v = _mm256_add_epi16(v, _mm256_set1_epi16(128));
+                    return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), 8);
+                }
+
+                GPC_GUI_TARGET("avx2") inline void fill_avx2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c = _mm256_set1_epi32(int(pack(color)));
+                    auto end = dst + count;
+                    for (; dst + 8 <= end; dst += 8) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), c);
+                    for (; dst < end; dst++) *dst = color;
+                }
+
+                GPC_GUI_TARGET("avx2") inline void blend_color_avx2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    short alpha = color.components[3];
+                    short r = short(color.components[0] * alpha), g = short(color.components[1] * alpha);
+                    short b = short(color.components[2] * alpha), a = short(255 * alpha);
+                    auto src  = _mm256_setr_epi16(r, g, b, a, r, g, b, a, r, g, b, a, r, g, b, a);
+                    auto inv  = _mm256_set1_epi16(short(255 - alpha));
+                    auto zero = _mm256_setzero_si256();
+
+                    // Unpacking works within 128-bit lanes, and so does packing: pixel order is preserved
+                    auto end = dst + count;
+                    for (; dst + 8 <= end; dst += 8) {
+                        auto d  = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst));
+                        auto lo = div_255_avx2(_mm256_add_epi16(src, _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv)));
+                        auto hi = div_255_avx2(_mm256_add_epi16(src, _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_packus_epi16(lo, hi));
+                    }
+                    blend_color_sse2(dst, std::size_t(end - dst), color);
+                }
+
+                GPC_GUI_TARGET("avx2") inline auto blend_premul_avx2_half(__m256i s, __m256i d) -> __m256i
+                {
+                    auto a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                    auto inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+                    return div_255_avx2(_mm256_mullo_epi16(d, inv));
+                }
+
+                GPC_GUI_TARGET("avx2") inline void blend_premul_avx2(rgba32 *dst, const rgba32 *src, std::size_t count)
+                {
+                    auto zero = _mm256_setzero_si256();
+
+                    auto end = dst + count;
+                    for (; dst + 8 <= end; dst += 8, src += 8) {
+                        auto s  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+                        auto d  = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst));
+                        auto lo = blend_premul_avx2_half(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+                        auto hi = blend_premul_avx2_half(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+                    }
+                    blend_premul_sse2(dst, src, std::size_t(end - dst));
+                }
+
+                GPC_GUI_TARGET("avx2") inline void blend_color_premul_avx2(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c    = _mm256_set1_epi32(int(pack(color)));
+                    auto inv  = _mm256_set1_epi16(short(255 - color.components[3]));
+                    auto zero = _mm256_setzero_si256();
+
+                    auto end = dst + count;
+                    for (; dst + 8 <= end; dst += 8) {
+                        auto d  = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst));
+                        auto lo = div_255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv));
+                        auto hi = div_255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_adds_epu8(c, _mm256_packus_epi16(lo, hi)));
+                    }
+                    blend_color_premul_sse2(dst, std::size_t(end - dst), color);
+                }
+
+                #endif // GPC_GUI_X86
+
+                #if defined(GPC_GUI_NEON)
+
+                // NEON -----------------------------------------------------------
+
+                inline auto div_255_neon(uint16x8_t v) -> uint16x8_t
+                {
+                    v = vaddq_u16(v, vdupq_n_u16(128));
+                    return vshrq_n_u16(vaddq_u16(v, vshrq_n_u16(v, 8)), 8);
+                }
+
+                inline void fill_neon(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c = vdupq_n_u32(pack(color));
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) vst1q_u32(reinterpret_cast<uint32_t*>(dst), c);
+                    for (; dst < end; dst++) *dst = color;
+                }
+
+                inline void blend_color_neon(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    uint16_t alpha = color.components[3];
+                    const uint16_t terms[8] = {
+                        uint16_t(color.components[0] * alpha), uint16_t(color.components[1] * alpha), uint16_t(color.components[2] * alpha), uint16_t(255 * alpha),
+                        uint16_t(color.components[0] * alpha), uint16_t(color.components[1] * alpha), uint16_t(color.components[2] * alpha), uint16_t(255 * alpha) };
+                    auto src = vld1q_u16(terms);
+                    auto inv = vdup_n_u8(uint8_t(255 - alpha));
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) {
+                        auto d  = vld1q_u8(reinterpret_cast<uint8_t*>(dst));
+                        auto lo = div_255_neon(vmlal_u8(src, vget_low_u8 (d), inv));
+                        auto hi = div_255_neon(vmlal_u8(src, vget_high_u8(d), inv));
+                        vst1q_u8(reinterpret_cast<uint8_t*>(dst), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+                    }
+                    blend_color_scalar(dst, std::size_t(end - dst), color);
+                }
+
+                inline void blend_premul_neon(rgba32 *dst, const rgba32 *src, std::size_t count)
+                {
+                    static const uint8_t alpha_index[16] = { 3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15 };
+                    auto broadcast = vld1q_u8(alpha_index);
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4, src += 4) {
+                        auto s   = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+                        auto d   = vld1q_u8(reinterpret_cast<uint8_t*>(dst));
+                        auto inv = vmvnq_u8(vqtbl1q_u8(s, broadcast));
+                        auto lo  = div_255_neon(vmull_u8(vget_low_u8 (d), vget_low_u8 (inv)));
+                        auto hi  = div_255_neon(vmull_u8(vget_high_u8(d), vget_high_u8(inv)));
+                        vst1q_u8(reinterpret_cast<uint8_t*>(dst), vqaddq_u8(s, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi))));
+                    }
+                    blend_premul_scalar(dst, src, std::size_t(end - dst));
+                }
+
+                inline void blend_color_premul_neon(rgba32 *dst, std::size_t count, rgba32 color)
+                {
+                    auto c   = vreinterpretq_u8_u32(vdupq_n_u32(pack(color)));
+                    auto inv = vdup_n_u8(uint8_t(255 - color.components[3]));
+
+                    auto end = dst + count;
+                    for (; dst + 4 <= end; dst += 4) {
+                        auto d  = vld1q_u8(reinterpret_cast<uint8_t*>(dst));
+                        auto lo = div_255_neon(vmull_u8(vget_low_u8 (d), inv));
+                        auto hi = div_255_neon(vmull_u8(vget_high_u8(d), inv));
+                        vst1q_u8(reinterpret_cast<uint8_t*>(dst), vqaddq_u8(c, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi))));
+                    }
+                    blend_color_premul_scalar(dst, std::size_t(end - dst), color);
+                }
+
+                #endif // GPC_GUI_NEON
+
+            } // ns detail
+
+            /** Returns the kernel set for the specified instruction set level, or nullptr
+                if that level was not compiled in or is not supported by the host CPU.
+             */
+            inline auto span_kernels_for(simd_level level) -> const span_kernels *
+            {
+                static const span_kernels scalar = { simd_level::scalar, "scalar",
+                    detail::fill_scalar, detail::blend_color_scalar, detail::blend_premul_scalar,
+                    detail::blend_color_premul_scalar };
+                #if defined(GPC_GUI_X86)
+                static const span_kernels sse2 = { simd_level::sse2, "sse2",
+                    detail::fill_sse2, detail::blend_color_sse2, detail::blend_premul_sse2,
+                    detail::blend_color_premul_sse2 };
+                static const span_kernels avx2 = { simd_level::avx2, "avx2",
+                    detail::fill_avx2, detail::blend_color_avx2, detail::blend_premul_avx2,
+                    detail::blend_color_premul_avx2 };
+                #endif
+                #if defined(GPC_GUI_NEON)
+                static const span_kernels neon = { simd_level::neon, "neon",
+                    detail::fill_neon, detail::blend_color_neon, detail::blend_premul_neon,
+                    detail::blend_color_premul_neon };
+                #endif
+
+                if (!host_cpu_features().supports(level)) return nullptr;
+
+                switch (level) {
+                case simd_level::scalar: return &scalar;
+                #if defined(GPC_GUI_X86)
+                case simd_level::sse2: return &sse2;
+                case simd_level::avx2: return &avx2;
+                #endif
+                #if defined(GPC_GUI_NEON)
+                case simd_level::neon: return &neon;
+                #endif
+                default: return nullptr;
+                }
+            }
+
+            /** The fastest kernel set supported by the host CPU, determined on first use.
+             */
+            inline auto best_span_kernels() -> const span_kernels &
+            {
+                static const span_kernels &kernels = [] () -> const span_kernels & {
+                    for (auto level: { simd_level::avx2, simd_level::neon, simd_level::sse2 }) {
+                        if (auto k = span_kernels_for(level)) return *k;
+                    }
+                    return *span_kernels_for(simd_level::scalar);
+                }();
+
+                return kernels;
+            }
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** LRU cache of laid-out lines of text ("runs"), used by the CPU renderer to
+                avoid repeating glyph lookup and placement for labels that are drawn
+                again and again.
+
+                A run is the list of glyph blits of a render_text() call, with positions
+                relative to the text origin, so that it can be reused at any location.
+                Runs are keyed by font and text (the text color does not influence the
+                layout); lookups hash the text once and do not allocate.
+
+                The cache is bounded by an approximate memory budget: when an insertion
+                exceeds it, the least recently used runs are evicted.
+             */
+            class text_run_cache {
+            public:
+
+                static const std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+                struct placed_glyph {
+                    int         dx, dy;             // top left corner, relative to the origin
+                    int         width, height;
+                    uint32_t    offset;             // of the coverage in the font's glyph atlas
+                };
+
+                struct run {
+                    uint64_t                    key;
+                    std::size_t                 font;
+                    std::vector<char32_t>       text;
+                    std::vector<placed_glyph>   glyphs;
+                    int                         x1, y1, x2, y2;     // bounding box of the glyphs, relative to the origin
+                };
+
+                struct statistics {
+                    std::size_t hits, misses, evictions;
+                    std::size_t runs, bytes, capacity;
+                };
+
+                explicit text_run_cache(std::size_t capacity_ = DEFAULT_CAPACITY):
+                    capacity(capacity_), bytes(0), hits(0), misses(0), evictions(0) {}
+
+                /** Returns the cached run for the text, or nullptr (counted as a miss).
+                 */
+                auto find(std::size_t font, const char32_t *text, std::size_t count) -> const run *
+                {
+                    auto it = index.find(hash(font, text, count));
+                    if (it == index.end() || !matches(*it->second, font, text, count)) { misses++; return nullptr; }
+
+                    hits++;
+                    runs.splice(runs.begin(), runs, it->second);    // move to front (most recently used)
+                    return &*it->second;
+                }
+
+                /** Adds a run and returns a reference to it. Cheap if the cache is full:
+                    the storage of the least recently used run is recycled.
+                 */
+                auto insert(std::size_t font, const char32_t *text, std::size_t count, const std::vector<placed_glyph> &glyphs) -> const run &
+                {
+                    auto key = hash(font, text, count);
+
+                    // Replace a run with the same hash (text changed, or a hash collision)
+                    auto it = index.find(key);
+                    if (it != index.end()) erase(it->second, spare.empty());
+
+                    auto size = run_size(count, glyphs.size());
+                    while (!runs.empty() && bytes + size > capacity) {
+                        evictions++;
+                        erase(std::prev(runs.end()), spare.empty());
+                    }
+
+                    if (!spare.empty()) runs.splice(runs.begin(), spare, spare.begin());
+                    else                runs.emplace_front();
+
+                    auto &r = runs.front();
+                    r.key = key, r.font = font;
+                    r.text.assign(text, text + count);
+                    r.glyphs.assign(glyphs.begin(), glyphs.end());
+                    r.x1 = r.y1 = r.x2 = r.y2 = 0;
+                    if (!glyphs.empty()) {
+                        const auto &first = glyphs.front();
+                        r.x1 = first.dx, r.y1 = first.dy, r.x2 = first.dx + first.width, r.y2 = first.dy + first.height;
+                    }
+                    for (const auto &g: glyphs) {
+                        r.x1 = std::min(r.x1, g.dx), r.x2 = std::max(r.x2, g.dx + g.width);
+                        r.y1 = std::min(r.y1, g.dy), r.y2 = std::max(r.y2, g.dy + g.height);
+                    }
+
+                    index[key] = runs.begin();
+                    bytes += size;
+
+                    return r;
+                }
+
+                /** Removes all runs of a font (e.g. when the font is disposed of).
+                 */
+                void invalidate_font(std::size_t font)
+                {
+                    for (auto it = runs.begin(); it != runs.end(); ) {
+                        auto next = std::next(it);
+                        if (it->font == font) erase(it);
+                        it = next;
+                    }
+                }
+
+                void clear()
+                {
+                    while (!runs.empty()) erase(runs.begin());
+                }
+
+                void set_capacity(std::size_t capacity_)
+                {
+                    capacity = capacity_;
+                    while (!runs.empty() && bytes > capacity) erase(std::prev(runs.end()));
+                }
+
+                auto stats() const -> statistics
+                {
+                    return { hits, misses, evictions, runs.size(), bytes, capacity };
+                }
+
+                void reset_stats() { hits = misses = evictions = 0; }
+
+            private:
+
+                using run_list = std::list<run>;
+
+                static auto run_size(std::size_t text_length, std::size_t glyph_count) -> std::size_t
+                {
+                    return sizeof(run) + 2 * sizeof(void*) + text_length * sizeof(char32_t) + glyph_count * sizeof(placed_glyph);
+                }
+
+                // FNV-1a over the font handle and the codepoints
+                static auto hash(std::size_t font, const char32_t *text, std::size_t count) -> uint64_t
+                {
+                    uint64_t h = 14695981039346656037ULL ^ uint64_t(font);
+                    h *= 1099511628211ULL;
+                    for (auto end = text + count; text < end; text++) {
+                        h ^= uint64_t(*text);
+                        h *= 1099511628211ULL;
+                    }
+                    return h;
+                }
+
+                static auto matches(const run &r, std::size_t font, const char32_t *text, std::size_t count) -> bool
+                {
+                    return r.font == font && r.text.size() == count && std::equal(text, text + count, r.text.begin());
+                }
+
+                // Removes a run; if recycle is set, its node (and storage) is kept for the next insertion
+                void erase(run_list::iterator it, bool recycle = false)
+                {
+                    index.erase(it->key);
+                    bytes -= run_size(it->text.size(), it->glyphs.size());
+                    if (recycle) spare.splice(spare.begin(), runs, it);
+                    else         runs.erase(it);
+                }
+
+                run_list                                        runs;       // most recently used first
+                run_list                                        spare;      // at most one evicted run, for reuse of its storage
+                std::unordered_map<uint64_t, run_list::iterator> index;
+                std::size_t                                     capacity, bytes;
+                std::size_t                                     hits, misses, evictions;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** A minimal work-stealing thread pool for data-parallel loops.
+
+                parallel_for() splits the index range into one contiguous chunk per
+                thread. Every thread (including the calling one) works its way through
+                its own chunk from the front; a thread that runs out of work steals the
+                back half of the chunk of another thread. This keeps neighbouring indices
+                (e.g. neighbouring screen tiles) on the same thread while still balancing
+                uneven workloads.
+
+                The worker threads are created once and sleep between loops.
+             */
+            class thread_pool {
+            public:
+
+                /** thread_count includes the calling thread; 0 means one thread per
+                    hardware thread.
+                 */
+                explicit thread_pool(unsigned thread_count = 0):
+                    queues(), generation(0), active(0), stopping(false), job_fn(nullptr), job_ctx(nullptr)
+                {
+                    if (thread_count == 0) thread_count = std::max(1U, std::thread::hardware_concurrency());
+
+                    queue_count = thread_count;
+                    queues.reset(new queue[thread_count]);
+
+                    for (unsigned i = 1; i < thread_count; i++) {
+                        workers.emplace_back([this, i]() { worker_loop(i); });
+                    }
+                }
+
+                ~thread_pool()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    wake.notify_all();
+                    for (auto &worker: workers) worker.join();
+                }
+
+                thread_pool(const thread_pool &) = delete;
+                thread_pool & operator = (const thread_pool &) = delete;
+
+                auto size() const -> unsigned { return queue_count; }
+
+                /** Calls fn(i) for every i in [0, count), distributed over the threads of
+                    the pool, and returns when all calls have completed. Not reentrant.
+                 */
+                template <typename Fn>
+                void parallel_for(std::size_t count, Fn &&fn)
+                {
+                    using fn_t = typename std::remove_reference<Fn>::type;
+
+                    if (count == 0) return;
+
+                    if (queue_count == 1 || count == 1) {
+                        for (std::size_t i = 0; i < count; i++) fn(i);
+                        return;
+                    }
+
+                    for (unsigned i = 0; i < queue_count; i++) {
+                        std::lock_guard<std::mutex> lock(queues[i].mutex);
+                        queues[i].begin = count *  i      / queue_count;
+                        queues[i].end   = count * (i + 1) / queue_count;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        job_fn  = [](void *ctx, std::size_t i) { (*static_cast<fn_t*>(ctx))(i); };
+                        job_ctx = const_cast<void*>(static_cast<const void*>(&fn));
+                        active  = queue_count - 1;
+                        generation++;
+                    }
+                    wake.notify_all();
+
+                    run_tasks(0);
+
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this]() { return active == 0; });
+                }
+
+            private:
+
+                struct queue {
+                    std::mutex  mutex;
+                    std::size_t begin = 0, end = 0;
+                };
+
+                void worker_loop(unsigned self)
+                {
+                    std::size_t seen = 0;
+
+                    for (;;) {
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [&]() { return stopping || generation != seen; });
+                            if (stopping) return;
+                            seen = generation;
+                        }
+
+                        run_tasks(self);
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (--active == 0) done.notify_one();
+                    }
+                }
+
+                void run_tasks(unsigned self)
+                {
+                    std::size_t index;
+                    while (pop(self, index) || steal(self, index)) job_fn(job_ctx, index);
+                }
+
+                auto pop(unsigned self, std::size_t &index) -> bool
+                {
+                    auto &q = queues[self];
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    if (q.begin == q.end) return false;
+                    index = q.begin++;
+                    return true;
+                }
+
+                auto steal(unsigned self, std::size_t &index) -> bool
+                {
+                    for (unsigned n = 1; n < queue_count; n++) {
+
+                        auto &victim = queues[(self + n) % queue_count];
+                        std::size_t begin, end;
+                        {
+                            std::lock_guard<std::mutex> lock(victim.mutex);
+                            if (victim.begin == victim.end) continue;
+                            // Take the back half (at least one index)
+                            begin = victim.begin + (victim.end - victim.begin) / 2;
+                            end = victim.end;
+                            victim.end = begin;
+                        }
+
+                        index = begin;
+                        auto &own = queues[self];
+                        std::lock_guard<std::mutex> lock(own.mutex);
+                        own.begin = begin + 1, own.end = end;
+                        return true;
+                    }
+                    return false;
+                }
+
+                unsigned                    queue_count;
+                std::unique_ptr<queue[]>    queues;
+                std::vector<std::thread>    workers;
+
+                std::mutex                  mutex;
+                std::condition_variable     wake, done;
+                std::size_t                 generation;
+                unsigned                    active;
+                bool                        stopping;
+
+                void                      (*job_fn)(void *ctx, std::size_t index);
+                void                       *job_ctx;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
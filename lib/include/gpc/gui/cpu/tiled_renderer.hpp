@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../utf8.hpp"
+#include "../native_color.hpp"
+#include "thread_pool.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace cpu {
+
+            /** Multi-threaded, tiled execution mode for the CPU renderer.
+
+                Implements the Renderer interface on top of a cpu::Renderer ("backend").
+                Draw calls are recorded, together with the clipping rectangle and text
+                color in effect; flush() then sorts ("bins") the recorded commands into
+                square screen tiles and rasterizes the tiles in parallel on a
+                work-stealing thread pool.
+
+                Every tile executes the commands touching it in their original order, and
+                pixels are computed exactly as by the backend itself, so the result is
+                bit-identical to single-threaded rendering regardless of thread count.
+
+                Resource management is forwarded to the backend. Partial redraws of the
+                backend are not supported in this mode; damage is recorded as usual.
+             */
+            template <class Backend>
+            class TiledRenderer {
+            public:
+
+                using backend_t     = Backend;
+                using coord_t       = typename Backend::coord_t;
+                using length_t      = typename Backend::length_t;
+                using native_color  = typename Backend::native_color;
+                using image_handle  = typename Backend::image_handle;
+                using font_handle   = typename Backend::font_handle;
+                using box           = typename Backend::box;
+
+                static const horizontal_direction   horizontal_axis_dir = Backend::horizontal_axis_dir;
+                static const vertical_direction     vertical_axis_dir   = Backend::vertical_axis_dir;
+
+                static const int DEFAULT_TILE_SIZE = 64;
+
+                static_assert(has_constexpr_native_color<Backend>::value, "the backend must convert colors at compile time");
+
+                /** thread_count includes the calling thread; 0 means one thread per
+                    hardware thread.
+                 */
+                explicit TiledRenderer(Backend *backend_, unsigned thread_count = 0, int tile_size_ = DEFAULT_TILE_SIZE):
+                    backend(backend_), pool(thread_count), tile_size(tile_size_),
+                    clip(backend_->surface_box()), text_color(backend_->text_color())
+                {}
+
+                auto get_backend() const -> Backend * { return backend; }
+
+                auto thread_count() const -> unsigned { return pool.size(); }
+
+                // Forwarded to the backend --------------------------------------------
+
+                auto width () const -> length_t { return backend->width (); }
+                auto height() const -> length_t { return backend->height(); }
+
+                static constexpr auto rgba_norm_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Backend>::from_rgba_norm(color); }
+
+                static constexpr auto rgb_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Backend>::from_rgb(color); }
+
+                template <typename... Args>
+                auto register_font(Args&&... args) -> font_handle { return backend->register_font(std::forward<Args>(args)...); }
+
+                template <typename... Args>
+                auto register_rgba32_image(Args&&... args) -> image_handle { return backend->register_rgba32_image(std::forward<Args>(args)...); }
+
+                template <typename... Args>
+                auto register_rgba_image(Args&&... args) -> image_handle { return backend->register_rgba_image(std::forward<Args>(args)...); }
+
+                /** Takes effect immediately: commands recorded since the last flush() that
+                    use the image are skipped if it gets freed.
+                 */
+                void unregister_image(image_handle image) { backend->unregister_image(image); }
+
+                void retain_image(image_handle image) { backend->retain_image(image); }
+
+                /** Same as unregister_image(), for text recorded with the font.
+                 */
+                void unregister_font(font_handle font) { backend->unregister_font(font); }
+
+                /** Debugging / testing: see the PixelRenderer concept. Flushes first.
+                 */
+                auto _getRGB24Screenshot() -> typename Backend::_RGB24Image
+                {
+                    flush();
+                    return backend->_getRGB24Screenshot();
+                }
+
+                // Recorded ------------------------------------------------------------
+
+                void clear(const native_color &color)
+                {
+                    command cmd(opcode::clear, backend->surface_box(), backend->surface_box());
+                    cmd.color = color;
+                    commands.push_back(cmd);
+                }
+
+                void fill_rect(coord_t x, coord_t y, length_t w, length_t h, const native_color &color)
+                {
+                    command cmd(opcode::fill_rect, intersect(backend->coverage_box(x, y, w, h), clip), clip);
+                    if (cmd.bounds.empty() || color.components[3] == 0) return;
+
+                    cmd.x = x, cmd.y = y, cmd.w = w, cmd.h = h;
+                    cmd.color = color;
+                    commands.push_back(cmd);
+                }
+
+                void draw_image(coord_t x, coord_t y, length_t w, length_t h, image_handle image, coord_t offset_x = 0, coord_t offset_y = 0)
+                {
+                    command cmd(opcode::draw_image, intersect(backend->framebuffer_box(x, y, w, h), clip), clip);
+                    if (cmd.bounds.empty()) return;
+
+                    cmd.x = x, cmd.y = y, cmd.w = w, cmd.h = h;
+                    cmd.image = image, cmd.offset_x = offset_x, cmd.offset_y = offset_y;
+                    commands.push_back(cmd);
+                }
+
+                void set_text_color(const native_color &color)
+                {
+                    text_color = color;
+                }
+
+                void render_text(font_handle font, coord_t x, coord_t y, const char32_t *str, std::size_t count)
+                {
+                    command cmd(opcode::render_text, intersect(backend->text_box(font, x, y, str, count), clip), clip);
+                    if (cmd.bounds.empty() || text_color.components[3] == 0) return;
+
+                    cmd.x = x, cmd.y = y;
+                    cmd.color = text_color;
+                    cmd.font = font, cmd.first = text.size(), cmd.count = count;
+                    text.insert(text.end(), str, str + count);
+                    commands.push_back(cmd);
+                }
+
+                void render_text_utf8(font_handle font, coord_t x, coord_t y, const char *str, std::size_t length)
+                {
+                    utf8_to_ucs4(str, length, utf32);
+                    render_text(font, x, y, utf32.data(), utf32.size());
+                }
+
+                void set_clipping_rect(coord_t x, coord_t y, length_t w, length_t h)
+                {
+                    clip = intersect(backend->framebuffer_box(x, y, w, h), backend->surface_box());
+                }
+
+                void cancel_clipping()
+                {
+                    clip = backend->surface_box();
+                }
+
+                void push_clip(coord_t x, coord_t y, length_t w, length_t h)
+                {
+                    clip_stack.push_back(clip);
+                    clip = intersect(backend->framebuffer_box(x, y, w, h), clip);
+                }
+
+                void pop_clip()
+                {
+                    assert(!clip_stack.empty());
+                    clip = clip_stack.back();
+                    clip_stack.pop_back();
+                }
+
+                auto clip_depth() const -> std::size_t { return clip_stack.size(); }
+
+                auto clip_test(coord_t x, coord_t y, length_t w, length_t h) const -> clip_result
+                {
+                    auto b = backend->framebuffer_box(x, y, w, h), area = intersect(b, clip);
+                    if (area.empty()) return clip_result::outside;
+                    return area.x1 == b.x1 && area.y1 == b.y1 && area.x2 == b.x2 && area.y2 == b.y2 ? clip_result::inside : clip_result::partial;
+                }
+
+                // Execution -----------------------------------------------------------
+
+                /** Rasterizes everything recorded since the last flush into the backend's
+                    framebuffer. In the steady state, this does not allocate memory.
+                 */
+                void flush()
+                {
+                    if (commands.empty()) return;
+
+                    auto surface = backend->surface_box();
+                    int tiles_x = (surface.x2 + tile_size - 1) / tile_size;
+                    int tiles_y = (surface.y2 + tile_size - 1) / tile_size;
+                    auto tile_count = std::size_t(tiles_x) * std::size_t(tiles_y);
+
+                    // Nothing to draw into (0 x 0 framebuffer)
+                    if (tile_count == 0) { commands.clear(), text.clear(); return; }
+
+                    bin_commands(tiles_x, tile_count);
+
+                    pool.parallel_for(tile_count, [&](std::size_t t) {
+                        int tx = int(t % std::size_t(tiles_x)), ty = int(t / std::size_t(tiles_x));
+                        box tile = { tx * tile_size, ty * tile_size, (tx + 1) * tile_size, (ty + 1) * tile_size };
+                        for (auto i = bin_start[t]; i < bin_start[t + 1]; i++) {
+                            execute(commands[bin_items[i]], tile);
+                        }
+                    });
+
+                    for (const auto &cmd: commands) backend->add_damage(cmd.bounds);
+
+                    commands.clear(), text.clear();
+                }
+
+            private:
+
+                enum class opcode: uint8_t { clear, fill_rect, draw_image, render_text };
+
+                struct command {
+                    opcode          op;
+                    box             bounds;         // affected framebuffer area
+                    box             clip;
+                    coord_t         x, y;
+                    length_t        w, h;
+                    native_color    color;          // fill / clear / text color
+                    image_handle    image;
+                    coord_t         offset_x, offset_y;
+                    font_handle     font;
+                    std::size_t     first, count;   // range in the text buffer
+
+                    command(opcode op_, const box &bounds_, const box &clip_):
+                        op(op_), bounds(bounds_), clip(clip_), x(0), y(0), w(0), h(0), color(),
+                        image(), offset_x(0), offset_y(0), font(), first(0), count(0) {}
+                };
+
+                static auto intersect(const box &a, const box &b) -> box
+                {
+                    return { std::max(a.x1, b.x1), std::max(a.y1, b.y1), std::min(a.x2, b.x2), std::min(a.y2, b.y2) };
+                }
+
+                /** Builds, for every tile, the list of commands touching it, in recording
+                    order. The lists are stored back to back in a single array (two passes:
+                    counting, then filling). Commands with empty bounds touch no tile.
+                 */
+                void bin_commands(int tiles_x, std::size_t tile_count)
+                {
+                    bin_start.assign(tile_count + 1, 0);
+
+                    auto for_each_tile = [&](const box &b, auto &&fn) {
+                        if (b.empty()) return;
+                        for (int ty = b.y1 / tile_size; ty <= (b.y2 - 1) / tile_size; ty++) {
+                            for (int tx = b.x1 / tile_size; tx <= (b.x2 - 1) / tile_size; tx++) {
+                                fn(std::size_t(ty) * std::size_t(tiles_x) + std::size_t(tx));
+                            }
+                        }
+                    };
+
+                    for (const auto &cmd: commands) {
+                        for_each_tile(cmd.bounds, [&](std::size_t t) { bin_start[t + 1]++; });
+                    }
+                    for (std::size_t t = 0; t < tile_count; t++) bin_start[t + 1] += bin_start[t];
+
+                    bin_items.resize(bin_start[tile_count]);
+                    bin_cursor.assign(bin_start.begin(), bin_start.end() - 1);
+                    for (std::size_t i = 0; i < commands.size(); i++) {
+                        for_each_tile(commands[i].bounds, [&](std::size_t t) { bin_items[bin_cursor[t]++] = uint32_t(i); });
+                    }
+                }
+
+                void execute(const command &cmd, const box &tile)
+                {
+                    auto area = intersect(cmd.clip, tile);
+
+                    switch (cmd.op) {
+                    case opcode::clear:
+                        backend->raster_clear(area, cmd.color);
+                        break;
+                    case opcode::fill_rect:
+                        backend->raster_fill_rect(area, cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+                        break;
+                    case opcode::draw_image:
+                        backend->raster_draw_image(area, cmd.x, cmd.y, cmd.w, cmd.h, cmd.image, cmd.offset_x, cmd.offset_y);
+                        break;
+                    case opcode::render_text:
+                        backend->raster_render_text(area, cmd.color, cmd.font, cmd.x, cmd.y, &text[cmd.first], cmd.count);
+                        break;
+                    }
+                }
+
+                Backend                    *backend;
+                thread_pool                 pool;
+                int                         tile_size;
+                box                         clip;
+                std::vector<box>            clip_stack;
+                native_color                text_color;
+                std::vector<command>        commands;
+                std::vector<char32_t>       text;
+                std::vector<char32_t>       utf32;          // scratch buffer
+                std::vector<std::size_t>    bin_start, bin_cursor;
+                std::vector<uint32_t>       bin_items;
+            };
+
+        } // ns cpu
+
+    } // ns gui
+
+} // ns gpc
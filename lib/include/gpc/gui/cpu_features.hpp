@@ -0,0 +1,95 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GPC_GUI_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define GPC_GUI_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Functions using instruction set extensions beyond the compiler's baseline must be
+   marked with this macro so that GCC and Clang allow the corresponding intrinsics.
+   MSVC makes all intrinsics available regardless.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define GPC_GUI_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GPC_GUI_TARGET(isa)
+#endif
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Instruction set levels for which optimized code paths exist.
+         */
+        enum class simd_level { scalar, sse2, avx2, neon };
+
+        struct cpu_features {
+            bool sse2  = false;
+            bool ssse3 = false;
+            bool avx2  = false;
+            bool neon  = false;
+
+            bool supports(simd_level level) const
+            {
+                switch (level) {
+                case simd_level::sse2: return sse2;
+                case simd_level::avx2: return avx2;
+                case simd_level::neon: return neon;
+                default: return true;
+                }
+            }
+        };
+
+        inline auto detect_cpu_features() -> cpu_features
+        {
+            cpu_features features;
+
+            #if defined(GPC_GUI_X86) && (defined(__GNUC__) || defined(__clang__))
+
+            __builtin_cpu_init();
+            features.sse2  = __builtin_cpu_supports("sse2" ) != 0;
+            features.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+            features.avx2  = __builtin_cpu_supports("avx2" ) != 0;
+
+            #elif defined(GPC_GUI_X86) && defined(_MSC_VER)
+
+            int info[4];
+            __cpuid(info, 0);
+            int max_leaf = info[0];
+            __cpuid(info, 1);
+            features.sse2  = (info[3] & (1 << 26)) != 0;
+            features.ssse3 = (info[2] & (1 <<  9)) != 0;
+            bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+            if (max_leaf >= 7 && os_saves_ymm) {
+                __cpuidex(info, 7, 0);
+                features.avx2 = (info[1] & (1 << 5)) != 0;
+            }
+
+            #endif
+
+            #if defined(GPC_GUI_NEON)
+            features.neon = true;
+            #endif
+
+            return features;
+        }
+
+        /** Detection is done only once per process.
+         */
+        inline auto host_cpu_features() -> const cpu_features &
+        {
+            static const cpu_features features = detect_cpu_features();
+            return features;
+        }
+
+    } // ns gui
+
+} // ns gpc
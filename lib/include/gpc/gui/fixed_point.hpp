@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Signed fixed-point number with FracBits fractional bits, meant as a renderer
+            coordinate type (CoordType) for layouts that place things at sub-pixel
+            positions, e.g. on high-DPI displays: fixed_24_8 is a coordinate in 1/256
+            pixel steps.
+
+            Integers convert implicitly, so that code written for integer coordinates
+            keeps working; use from_raw() or the (explicit) constructor from double for
+            fractional values. Like an integer, a default-initialized fixed_point is
+            indeterminate (value-initialized, it is 0).
+         */
+        template <typename Int, int FracBits>
+        class fixed_point {
+        public:
+
+            static_assert(std::is_integral<Int>::value && std::is_signed<Int>::value, "fixed_point must be based on a signed integral type");
+            static_assert(FracBits > 0 && FracBits < int(sizeof(Int) * 8) - 1, "invalid number of fractional bits");
+
+            using raw_t = Int;
+
+            static const int    frac_bits = FracBits;
+            static const Int    one       = Int(1) << FracBits;
+
+            fixed_point() = default;
+
+            constexpr fixed_point(int v): value(Int(v) * one) {}
+
+            explicit constexpr fixed_point(double v): value(Int(v * one + (v < 0 ? -0.5 : 0.5))) {}
+
+            static constexpr auto from_raw(Int raw) -> fixed_point { return fixed_point(raw, raw_tag()); }
+
+            constexpr auto raw() const -> Int { return value; }
+
+            constexpr auto to_double() const -> double { return double(value) / one; }
+
+            constexpr auto is_integer() const -> bool { return (value & (one - 1)) == 0; }
+
+            auto operator += (fixed_point other) -> fixed_point & { value += other.value; return *this; }
+            auto operator -= (fixed_point other) -> fixed_point & { value -= other.value; return *this; }
+
+            constexpr auto operator - () const -> fixed_point { return from_raw(-value); }
+
+            friend constexpr auto operator + (fixed_point a, fixed_point b) -> fixed_point { return from_raw(a.value + b.value); }
+            friend constexpr auto operator - (fixed_point a, fixed_point b) -> fixed_point { return from_raw(a.value - b.value); }
+            friend constexpr auto operator * (fixed_point a, int b) -> fixed_point { return from_raw(a.value * b); }
+            friend constexpr auto operator * (int a, fixed_point b) -> fixed_point { return from_raw(a * b.value); }
+            friend constexpr auto operator / (fixed_point a, int b) -> fixed_point { return from_raw(a.value / b); }
+
+            friend constexpr bool operator == (fixed_point a, fixed_point b) { return a.value == b.value; }
+            friend constexpr bool operator != (fixed_point a, fixed_point b) { return a.value != b.value; }
+            friend constexpr bool operator <  (fixed_point a, fixed_point b) { return a.value <  b.value; }
+            friend constexpr bool operator <= (fixed_point a, fixed_point b) { return a.value <= b.value; }
+            friend constexpr bool operator >  (fixed_point a, fixed_point b) { return a.value >  b.value; }
+            friend constexpr bool operator >= (fixed_point a, fixed_point b) { return a.value >= b.value; }
+
+        private:
+
+            struct raw_tag {};
+
+            constexpr fixed_point(Int raw, raw_tag): value(raw) {}
+
+            Int value;
+        };
+
+        using fixed_24_8 = fixed_point<int32_t, 8>;
+
+        namespace detail {
+
+            template <int SubpixelBits>
+            struct subpixel_grid {
+
+                static const int subpixel_bits = SubpixelBits;
+                static const int one = 1 << SubpixelBits;
+
+                // Pixel boundaries from positions in subpixels (arithmetic shifts round towards minus infinity)
+                static constexpr auto floor(int raw) -> int { return raw >> SubpixelBits; }
+                static constexpr auto ceil (int raw) -> int { return (raw + one - 1) >> SubpixelBits; }
+                static constexpr auto round(int raw) -> int { return (raw + (one >> 1)) >> SubpixelBits; }
+
+                static constexpr auto aligned(int raw) -> bool { return (raw & (one - 1)) == 0; }
+            };
+
+        } // ns detail
+
+        /** What renderers need to know about a coordinate type: the matching length
+            type, and how to express coordinates and lengths in subpixels (raw()),
+            subpixel_bits being 0 for integral types.
+         */
+        template <typename CoordType>
+        struct coord_traits: detail::subpixel_grid<0> {
+
+            static_assert(std::is_integral<CoordType>::value && std::is_signed<CoordType>::value,
+                "coordinates must be signed integers or fixed_point numbers");
+
+            using length_t = typename std::make_unsigned<CoordType>::type;
+
+            template <typename T>
+            static constexpr auto raw(T v) -> int { return int(v); }
+        };
+
+        /** Lengths in fixed point have the same type as coordinates (and must not be
+            negative).
+         */
+        template <typename Int, int FracBits>
+        struct coord_traits<fixed_point<Int, FracBits>>: detail::subpixel_grid<FracBits> {
+
+            using length_t = fixed_point<Int, FracBits>;
+
+            static constexpr auto raw(fixed_point<Int, FracBits> v) -> int { return int(v.raw()); }
+        };
+
+    } // ns gui
+
+} // ns gpc
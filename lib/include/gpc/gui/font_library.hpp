@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <cereal/archives/binary.hpp>
+
+#include <gpc/fonts/rasterized_font.hpp>
+#include <gpc/fonts/cereal.hpp>
+
+#include "mapped_file.hpp"
+#include "memory_istream.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Loads rasterized fonts (.rft, as produced by GPCFontRasterizer) from memory
+            or from memory-mapped files, and shares them: loading a font whose data is
+            identical to that of a font that is still in use (by any renderer) returns
+            the existing font instead of deserializing it again.
+
+            Fonts are identified by the size and a 128-bit digest of their data (two
+            independent 64-bit hashes), so that distinct fonts are never confused in
+            practice; fonts that only share a hash are kept side by side. They are
+            freed when the last shared_ptr to them goes away (renderers keep theirs
+            until the font is unregistered).
+
+            The library is thread-safe; instance() is the process-wide library.
+         */
+        class font_library {
+        public:
+
+            using font_ptr = std::shared_ptr<const gpc::fonts::rasterized_font>;
+
+            struct statistics {
+                std::size_t loads;          // deserializations
+                std::size_t shared;         // load requests satisfied by an existing font
+                std::size_t fonts;          // fonts currently alive
+            };
+
+            static auto instance() -> font_library &
+            {
+                static font_library library;
+                return library;
+            }
+
+            font_library(): loads(0), shared(0) {}
+
+            font_library(const font_library &) = delete;
+            font_library & operator = (const font_library &) = delete;
+
+            /** Loads a font from serialized data in memory, which is only read during
+                the call.
+             */
+            auto load(const void *data, std::size_t size) -> font_ptr
+            {
+                auto key = digest_of(static_cast<const uint8_t*>(data), size);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (auto font = lookup(key)) { shared++; return font; }
+                }
+
+                // Deserialize without holding the lock
+                auto font = std::make_shared<gpc::fonts::rasterized_font>();
+                {
+                    memory_istream stream(data, size);
+                    cereal::BinaryInputArchive archive(stream);
+                    archive >> *font;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                loads++;
+                // Another thread may have loaded the same font in the meantime
+                if (auto existing = lookup(key)) return existing;
+                fonts.emplace(key.h1, entry{ key, font });
+                return font;
+            }
+
+            /** Loads a font from a file, by mapping it into memory.
+             */
+            auto load_file(const std::string &path) -> font_ptr
+            {
+                mapped_file file(path);
+                return load(file.data(), file.size());
+            }
+
+            auto stats() const -> statistics
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                std::size_t alive = 0;
+                for (const auto &entry: fonts) if (!entry.second.font.expired()) alive++;
+                return { loads, shared, alive };
+            }
+
+        private:
+
+            struct digest {
+                std::size_t     size;
+                uint64_t        h1, h2;
+
+                bool operator == (const digest &other) const { return size == other.size && h1 == other.h1 && h2 == other.h2; }
+            };
+
+            struct entry {
+                digest                                                  key;
+                std::weak_ptr<const gpc::fonts::rasterized_font>        font;
+            };
+
+            // Two unrelated hashes over 64-bit words (the tail is zero-padded): FNV-1a,
+            // and a multiply-rotate hash in the style of MurmurHash2-64
+            static auto digest_of(const uint8_t *data, std::size_t size) -> digest
+            {
+                uint64_t h1 = 14695981039346656037ULL;
+                uint64_t h2 = 0x9E3779B97F4A7C15ULL ^ (size * 0xC6A4A7935BD1E995ULL);
+
+                auto mix = [&](uint64_t word) {
+                    h1 = (h1 ^ word) * 1099511628211ULL;
+                    word *= 0xC6A4A7935BD1E995ULL;
+                    word ^= word >> 47;
+                    h2 = (h2 ^ word * 0xC6A4A7935BD1E995ULL) * 0xC6A4A7935BD1E995ULL;
+                    h2 = (h2 << 31) | (h2 >> 33);
+                };
+
+                std::size_t i = 0;
+                for (; i + 8 <= size; i += 8) {
+                    uint64_t word;
+                    std::memcpy(&word, data + i, 8);
+                    mix(word);
+                }
+                if (i < size) {
+                    uint64_t word = 0;
+                    std::memcpy(&word, data + i, size - i);
+                    mix(word);
+                }
+                h2 ^= h2 >> 29; h2 *= 0xBF58476D1CE4E5B9ULL; h2 ^= h2 >> 32;
+                return { size, h1 ^ (h1 >> 29), h2 };
+            }
+
+            // Caller holds the lock; drops the entries whose font has been freed on the way
+            auto lookup(const digest &key) -> font_ptr
+            {
+                auto range = fonts.equal_range(key.h1);
+                for (auto it = range.first; it != range.second; ) {
+                    auto font = it->second.font.lock();
+                    if (!font) { it = fonts.erase(it); continue; }
+                    if (it->second.key == key) return font;
+                    ++it;
+                }
+                return nullptr;
+            }
+
+            mutable std::mutex                              mutex;
+            std::unordered_multimap<uint64_t, entry>        fonts;     // by first hash
+            std::size_t                                     loads, shared;
+        };
+
+    } // ns gui
+
+} // ns gpc
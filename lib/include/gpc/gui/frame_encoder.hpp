@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "framebuffer_view.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Run-length codec for rows of 32-bit pixels (PackBits applied to pixels).
+
+            The encoded data is a sequence of packets, each starting with a control
+            byte c: if c < 128, c + 1 literal pixels follow; otherwise, the single pixel
+            that follows is repeated c - 126 times (2 to 129).
+         */
+        struct pixel_rle {
+
+            /** Appends the encoding of count pixels to out.
+             */
+            static void encode(const uint32_t *px, std::size_t count, std::vector<uint8_t> &out)
+            {
+                std::size_t i = 0;
+                while (i < count) {
+                    // Length of the run starting at i
+                    std::size_t run = 1;
+                    while (i + run < count && run < 129 && px[i + run] == px[i]) run++;
+
+                    if (run >= 2) {
+                        out.push_back(uint8_t(run + 126));
+                        put(out, px[i]);
+                        i += run;
+                        continue;
+                    }
+
+                    // Literals: up to the next run of at least 2 (or 128 pixels)
+                    std::size_t n = 1;
+                    while (i + n < count && n < 128 && !(i + n + 1 < count && px[i + n] == px[i + n + 1])) n++;
+                    out.push_back(uint8_t(n - 1));
+                    for (std::size_t j = 0; j < n; j++) put(out, px[i + j]);
+                    i += n;
+                }
+            }
+
+            /** Decodes exactly count pixels; returns the position after the consumed
+                data, or nullptr if the data is malformed or truncated.
+             */
+            static auto decode(const uint8_t *in, const uint8_t *end, uint32_t *px, std::size_t count) -> const uint8_t *
+            {
+                std::size_t i = 0;
+                while (i < count) {
+                    if (in >= end) return nullptr;
+                    unsigned c = *in++;
+                    std::size_t n = c < 128 ? c + 1 : c - 126;
+                    std::size_t bytes = c < 128 ? 4 * n : 4;
+                    if (n > count - i || std::size_t(end - in) < bytes) return nullptr;
+
+                    if (c < 128) {
+                        std::memcpy(px + i, in, bytes);
+                    }
+                    else {
+                        uint32_t v;
+                        std::memcpy(&v, in, 4);
+                        std::fill(px + i, px + i + n, v);
+                    }
+                    in += bytes, i += n;
+                }
+                return in;
+            }
+
+        private:
+
+            static void put(std::vector<uint8_t> &out, uint32_t v)
+            {
+                uint8_t bytes[4];
+                std::memcpy(bytes, &v, 4);
+                out.insert(out.end(), bytes, bytes + 4);
+            }
+        };
+
+        /** Pipeline stage that turns a sequence of frames into a compact stream of
+            frame deltas, for streaming a headless renderer's output to remote viewers.
+
+            submit() copies a finished frame (converting it to rgba32, top row first)
+            into a back buffer and returns; a background thread then compares it with the
+            previously encoded frame in square tiles, run-length encodes the tiles that
+            changed (see pixel_rle) and passes the result to the sink. If frames are
+            submitted faster than they can be encoded, the waiting frame is replaced by
+            the newer one (and counted as dropped), so the renderer never waits for the
+            encoder.
+
+            Stream format (all integers little-endian):
+              stream header:  "GPCF", u16 version (1), u16 tile size
+              per frame:      "FRME", u32 frame number, u16 width, u16 height,
+                              u32 number of tiles, u32 size of the tile data in bytes
+              per tile:       u16 tile column, u16 tile row, u32 encoded size,
+                              RLE-encoded rows of the tile, pixels as bytes r, g, b, a
+            A frame whose size differs from the previous one contains all its tiles.
+            Frame dimensions and the tile size must therefore fit in 16 bits (which also
+            bounds the tile indices); the encoder throws std::invalid_argument otherwise.
+         */
+        class frame_encoder {
+        public:
+
+            using sink = std::function<void(const uint8_t *data, std::size_t size)>;
+
+            static const int DEFAULT_TILE_SIZE = 64;
+            static const int MAX_DIMENSION = 0xFFFF;        // of frames and tiles
+
+            struct statistics {
+                std::size_t submitted, encoded, dropped;
+                std::size_t tiles_total, tiles_changed;
+                std::size_t bytes_written;
+            };
+
+            /** Writes to a stdio stream (file or pipe); the stream is not closed.
+             */
+            static auto file_sink(std::FILE *file) -> sink
+            {
+                return [file](const uint8_t *data, std::size_t size) { std::fwrite(data, 1, size, file); std::fflush(file); };
+            }
+
+            explicit frame_encoder(sink output_, int tile_size_ = DEFAULT_TILE_SIZE):
+                output(std::move(output_)), tile_size(tile_size_),
+                pending_ready(false), busy(false), stopping(false),
+                frame_number(0), stats_()
+            {
+                if (tile_size < 1 || tile_size > MAX_DIMENSION) throw std::invalid_argument("frame_encoder: invalid tile size");
+
+                std::vector<uint8_t> header;
+                header.insert(header.end(), { 'G', 'P', 'C', 'F' });
+                put16(header, 1);
+                put16(header, uint16_t(tile_size));
+                output(header.data(), header.size());
+                stats_.bytes_written = header.size();
+
+                worker = std::thread([this]() { run(); });
+            }
+
+            ~frame_encoder()
+            {
+                finish();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                worker.join();
+            }
+
+            frame_encoder(const frame_encoder &) = delete;
+            frame_encoder & operator = (const frame_encoder &) = delete;
+
+            /** Hands over a finished frame. Costs one copy (with format conversion if
+                needed) of the frame; never waits for the encoder.
+             */
+            void submit(const framebuffer_view &view)
+            {
+                if (view.width < 0 || view.width > MAX_DIMENSION || view.height < 0 || view.height > MAX_DIMENSION) {
+                    throw std::invalid_argument("frame_encoder: frame size out of range");
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (pending_ready) stats_.dropped++;
+                stats_.submitted++;
+
+                pending.width = view.width, pending.height = view.height;
+                pending.pixels.resize(std::size_t(view.width) * std::size_t(view.height));
+                if (!pending.pixels.empty()) read_pixels(view, pixel_format::rgba32, reinterpret_cast<uint8_t*>(&pending.pixels[0]));
+                pending_ready = true;
+
+                wake.notify_one();
+            }
+
+            /** Waits until all submitted frames have been encoded and written.
+             */
+            void finish()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                idle.wait(lock, [this]() { return !pending_ready && !busy; });
+            }
+
+            auto stats() const -> statistics
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return stats_;
+            }
+
+        private:
+
+            struct frame {
+                int                     width = 0, height = 0;
+                std::vector<uint32_t>   pixels;
+            };
+
+            void run()
+            {
+                for (;;) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        wake.wait(lock, [this]() { return stopping || pending_ready; });
+                        if (!pending_ready) return;
+
+                        std::swap(pending, current);
+                        pending_ready = false, busy = true;
+                    }
+
+                    std::size_t tiles_total, tiles_changed;
+                    encode(tiles_total, tiles_changed);
+                    output(buffer.data(), buffer.size());
+                    std::swap(current, previous);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stats_.encoded++;
+                        stats_.tiles_total += tiles_total, stats_.tiles_changed += tiles_changed;
+                        stats_.bytes_written += buffer.size();
+                        busy = false;
+                    }
+                    idle.notify_all();
+                }
+            }
+
+            // Encodes current (as a delta to previous) into buffer
+            void encode(std::size_t &tiles_total, std::size_t &tiles_changed)
+            {
+                int w = current.width, h = current.height;
+                bool full = previous.width != w || previous.height != h;
+                int tiles_x = (w + tile_size - 1) / tile_size, tiles_y = (h + tile_size - 1) / tile_size;
+
+                buffer.clear();
+                buffer.insert(buffer.end(), { 'F', 'R', 'M', 'E' });
+                put32(buffer, frame_number++);
+                put16(buffer, uint16_t(w));
+                put16(buffer, uint16_t(h));
+                auto count_pos = buffer.size();
+                put32(buffer, 0);
+                put32(buffer, 0);
+                auto data_start = buffer.size();
+
+                uint32_t count = 0;
+                for (int ty = 0; ty < tiles_y; ty++) {
+                    for (int tx = 0; tx < tiles_x; tx++) {
+
+                        int x1 = tx * tile_size, y1 = ty * tile_size;
+                        int tw = std::min(tile_size, w - x1), th = std::min(tile_size, h - y1);
+
+                        if (!full && !tile_changed(x1, y1, tw, th)) continue;
+
+                        put16(buffer, uint16_t(tx));
+                        put16(buffer, uint16_t(ty));
+                        auto size_pos = buffer.size();
+                        put32(buffer, 0);
+
+                        auto tile_start = buffer.size();
+                        for (int y = y1; y < y1 + th; y++) {
+                            pixel_rle::encode(&current.pixels[std::size_t(y) * std::size_t(w) + std::size_t(x1)], std::size_t(tw), buffer);
+                        }
+                        set32(buffer, size_pos, uint32_t(buffer.size() - tile_start));
+                        count++;
+                    }
+                }
+
+                set32(buffer, count_pos, count);
+                set32(buffer, count_pos + 4, uint32_t(buffer.size() - data_start));
+
+                tiles_total = std::size_t(tiles_x) * std::size_t(tiles_y), tiles_changed = count;
+            }
+
+            auto tile_changed(int x1, int y1, int tw, int th) const -> bool
+            {
+                auto w = std::size_t(current.width);
+                for (int y = y1; y < y1 + th; y++) {
+                    auto offset = std::size_t(y) * w + std::size_t(x1);
+                    if (std::memcmp(&current.pixels[offset], &previous.pixels[offset], std::size_t(tw) * 4) != 0) return true;
+                }
+                return false;
+            }
+
+            static void put16(std::vector<uint8_t> &out, uint16_t v)
+            {
+                out.push_back(uint8_t(v)), out.push_back(uint8_t(v >> 8));
+            }
+
+            static void put32(std::vector<uint8_t> &out, uint32_t v)
+            {
+                put16(out, uint16_t(v)), put16(out, uint16_t(v >> 16));
+            }
+
+            static void set32(std::vector<uint8_t> &out, std::size_t pos, uint32_t v)
+            {
+                for (int i = 0; i < 4; i++) out[pos + i] = uint8_t(v >> (8 * i));
+            }
+
+            sink                        output;
+            int                         tile_size;
+
+            frame                       pending, current, previous;
+            std::vector<uint8_t>        buffer;             // encoded frame (worker thread only)
+
+            mutable std::mutex          mutex;
+            std::condition_variable     wake, idle;
+            bool                        pending_ready, busy, stopping;
+            uint32_t                    frame_number;
+            statistics                  stats_;
+            std::thread                 worker;
+        };
+
+    } // ns gui
+
+} // ns gpc
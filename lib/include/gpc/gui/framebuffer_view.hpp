@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "cpu_features.hpp"
+#include "renderer.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Byte layouts of pixels with 8-bit channels, named in memory order.
+         */
+        enum class pixel_format { rgba32, bgra32, rgb24, bgr24 };
+
+        inline auto bytes_per_pixel(pixel_format format) -> int
+        {
+            return format == pixel_format::rgba32 || format == pixel_format::bgra32 ? 4 : 3;
+        }
+
+        /** Read-only view of the pixels of a framebuffer, without copying them.
+
+            data points to the top row of the image; stride is the (signed) distance in
+            bytes from one row to the row below it. orientation tells how the rows are
+            laid out in memory: down (top row first) or up (bottom row first, stride
+            negative). A view is only valid until the framebuffer is resized.
+         */
+        struct framebuffer_view {
+            const uint8_t      *data;
+            int                 width, height;
+            std::ptrdiff_t      stride;
+            pixel_format        format;
+            vertical_direction  orientation;
+
+            /** Row y, counting from the top.
+             */
+            auto row(int y) const -> const uint8_t * { return data + std::ptrdiff_t(y) * stride; }
+        };
+
+        namespace detail {
+
+            /** Describes a conversion between two pixel formats as a byte shuffle: dst byte
+                i of a pixel takes src byte map[i] of the same pixel (-1: constant 255).
+             */
+            struct swizzle {
+                int src_bpp, dst_bpp;
+                int map[4];
+            };
+
+            inline auto make_swizzle(pixel_format from, pixel_format to) -> swizzle
+            {
+                // Position of R, G, B, A within a pixel of each format (-1: absent)
+                static const int positions[4][4] = {
+                    { 0, 1, 2, 3 }, { 2, 1, 0, 3 }, { 0, 1, 2, -1 }, { 2, 1, 0, -1 }
+                };
+
+                const auto &src = positions[int(from)], &dst = positions[int(to)];
+
+                swizzle sw = { bytes_per_pixel(from), bytes_per_pixel(to), { -1, -1, -1, -1 } };
+                for (int channel = 0; channel < 4; channel++) {
+                    if (dst[channel] >= 0) sw.map[dst[channel]] = src[channel];
+                }
+                return sw;
+            }
+
+            inline void swizzle_row_scalar(const swizzle &sw, const uint8_t *src, uint8_t *dst, int count)
+            {
+                for (int i = 0; i < count; i++, src += sw.src_bpp, dst += sw.dst_bpp) {
+                    for (int j = 0; j < sw.dst_bpp; j++) dst[j] = sw.map[j] < 0 ? 255 : src[sw.map[j]];
+                }
+            }
+
+            /** Shuffle mask for 4 pixels (one 16-byte vector) of 32-bit source pixels.
+                Indices with the top bit set select zero, for both PSHUFB and TBL.
+             */
+            inline void make_shuffle_mask(const swizzle &sw, uint8_t mask[16], uint8_t fill[16])
+            {
+                for (int i = 0; i < 16; i++) mask[i] = 0x80, fill[i] = 0;
+                for (int px = 0; px < 4; px++) {
+                    for (int j = 0; j < sw.dst_bpp; j++) {
+                        int k = px * sw.dst_bpp + j;
+                        if (sw.map[j] < 0) fill[k] = 255;
+                        else mask[k] = uint8_t(px * 4 + sw.map[j]);
+                    }
+                }
+            }
+
+            #if defined(GPC_GUI_X86)
+
+            // 32-bit source pixels only
+            GPC_GUI_TARGET("ssse3") inline void swizzle_row_ssse3(const swizzle &sw, const uint8_t *src, uint8_t *dst, int count)
+            {
+                alignas(16) uint8_t mask_bytes[16], fill_bytes[16];
+                make_shuffle_mask(sw, mask_bytes, fill_bytes);
+                auto mask = _mm_load_si128(reinterpret_cast<const __m128i*>(mask_bytes));
+                auto fill = _mm_load_si128(reinterpret_cast<const __m128i*>(fill_bytes));
+
+                int out_bytes = 4 * sw.dst_bpp;
+                int i = 0;
+                // A 16-byte store covers 4 output pixels; with 24-bit output, the last
+                // 4 bytes spill into the next pixels, so stop early enough
+                for (; i + (sw.dst_bpp == 4 ? 4 : 6) <= count; i += 4, src += 16, dst += out_bytes) {
+                    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(_mm_shuffle_epi8(v, mask), fill));
+                }
+                swizzle_row_scalar(sw, src, dst, count - i);
+            }
+
+            #endif // GPC_GUI_X86
+
+            #if defined(GPC_GUI_NEON)
+
+            inline void swizzle_row_neon(const swizzle &sw, const uint8_t *src, uint8_t *dst, int count)
+            {
+                uint8_t mask_bytes[16], fill_bytes[16];
+                make_shuffle_mask(sw, mask_bytes, fill_bytes);
+                auto mask = vld1q_u8(mask_bytes);
+                auto fill = vld1q_u8(fill_bytes);
+
+                int out_bytes = 4 * sw.dst_bpp;
+                int i = 0;
+                for (; i + (sw.dst_bpp == 4 ? 4 : 6) <= count; i += 4, src += 16, dst += out_bytes) {
+                    vst1q_u8(dst, vorrq_u8(vqtbl1q_u8(vld1q_u8(src), mask), fill));
+                }
+                swizzle_row_scalar(sw, src, dst, count - i);
+            }
+
+            #endif // GPC_GUI_NEON
+
+            inline void swizzle_row(const swizzle &sw, const uint8_t *src, uint8_t *dst, int count)
+            {
+                if (sw.src_bpp == 4) {
+                    #if defined(GPC_GUI_X86)
+                    if (host_cpu_features().ssse3) return swizzle_row_ssse3(sw, src, dst, count);
+                    #elif defined(GPC_GUI_NEON)
+                    return swizzle_row_neon(sw, src, dst, count);
+                    #endif
+                }
+                swizzle_row_scalar(sw, src, dst, count);
+            }
+
+        } // ns detail
+
+        /** Copies the pixels of a view into a caller-provided buffer, top row first,
+            converting them to the specified format. dst_stride is the distance between
+            rows in the destination buffer; 0 means tightly packed rows.
+            Identical formats are copied row by row; conversions use vectorized byte
+            shuffles (SSSE3 or NEON) where available.
+         */
+        inline void
+        read_pixels(const framebuffer_view &view, pixel_format format, uint8_t *dst, std::ptrdiff_t dst_stride = 0)
+        {
+            auto row_bytes = std::size_t(view.width) * std::size_t(bytes_per_pixel(format));
+            if (dst_stride == 0) dst_stride = std::ptrdiff_t(row_bytes);
+
+            if (format == view.format) {
+                if (view.stride == dst_stride && dst_stride == std::ptrdiff_t(row_bytes)) {
+                    std::memcpy(dst, view.data, row_bytes * std::size_t(view.height));
+                }
+                else {
+                    for (int y = 0; y < view.height; y++) std::memcpy(dst + y * dst_stride, view.row(y), row_bytes);
+                }
+                return;
+            }
+
+            auto sw = detail::make_swizzle(view.format, format);
+            for (int y = 0; y < view.height; y++) {
+                detail::swizzle_row(sw, view.row(y), dst + y * dst_stride, view.width);
+            }
+        }
+
+    } // ns gui
+
+} // ns gpc
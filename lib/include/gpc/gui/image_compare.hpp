@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "cpu_features.hpp"
+#include "color.hpp"
+#include "framebuffer_view.hpp"
+#include "cpu/damage_tracker.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Options for compare_images().
+         */
+        struct image_compare_options {
+            uint8_t tolerance   = 0;        // largest acceptable difference per channel
+            bool    early_out   = true;     // stop at the first mismatching pixel
+            bool    diff_image  = false;    // produce a diff image (implies !early_out)
+            bool    regions     = false;    // produce mismatch rectangles (implies !early_out)
+        };
+
+        /** Result of compare_images().
+         */
+        struct image_diff {
+
+            struct rect {
+                int x, y, w, h;
+            };
+
+            std::size_t         mismatched_pixels = 0;  // 1 at most with early_out
+            int                 first_x = -1, first_y = -1;
+            unsigned            max_difference = 0;     // largest channel difference found
+            std::vector<rect>   regions;                // areas containing mismatches (32x32 granularity)
+            std::vector<rgba32> diff_image;             // mismatches in red over a faded copy of the first image
+
+            bool identical() const { return mismatched_pixels == 0; }
+        };
+
+        namespace detail {
+
+            inline auto find_mismatch_scalar(const uint8_t *a, const uint8_t *b, std::size_t size, unsigned tolerance) -> std::size_t
+            {
+                for (std::size_t i = 0; i < size; i++) {
+                    unsigned d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+                    if (d > tolerance) return i;
+                }
+                return size;
+            }
+
+            #if defined(GPC_GUI_X86)
+
+            GPC_GUI_TARGET("sse2") inline auto find_mismatch_sse2(const uint8_t *a, const uint8_t *b, std::size_t size, unsigned tolerance) -> std::size_t
+            {
+                auto tol  = _mm_set1_epi8(char(tolerance));
+                auto zero = _mm_setzero_si128();
+
+                auto exceeding = [&](std::size_t i) {
+                    auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                    auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                    auto diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+                    return _mm_subs_epu8(diff, tol);        // non-zero where diff > tolerance
+                };
+
+                std::size_t i = 0;
+                // 64 bytes per iteration, single test
+                for (; i + 64 <= size; i += 64) {
+                    auto any = _mm_or_si128(_mm_or_si128(exceeding(i), exceeding(i + 16)), _mm_or_si128(exceeding(i + 32), exceeding(i + 48)));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xFFFF) break;
+                }
+                for (; i + 16 <= size; i += 16) {
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(exceeding(i), zero)) != 0xFFFF) break;
+                }
+                return i + find_mismatch_scalar(a + i, b + i, size - i, tolerance);
+            }
+
+            #endif // GPC_GUI_X86
+
+            #if defined(GPC_GUI_NEON)
+
+            inline auto find_mismatch_neon(const uint8_t *a, const uint8_t *b, std::size_t size, unsigned tolerance) -> std::size_t
+            {
+                std::size_t i = 0;
+                for (; i + 16 <= size; i += 16) {
+                    if (vmaxvq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) > tolerance) break;
+                }
+                return i + find_mismatch_scalar(a + i, b + i, size - i, tolerance);
+            }
+
+            #endif // GPC_GUI_NEON
+
+        } // ns detail
+
+        /** Returns the offset of the first byte at which the two buffers differ by more
+            than the tolerance, or size if there is none.
+         */
+        inline auto
+        find_mismatch(const uint8_t *a, const uint8_t *b, std::size_t size, unsigned tolerance = 0) -> std::size_t
+        {
+            #if defined(GPC_GUI_X86)
+            if (host_cpu_features().sse2) return detail::find_mismatch_sse2(a, b, size, tolerance);
+            #elif defined(GPC_GUI_NEON)
+            return detail::find_mismatch_neon(a, b, size, tolerance);
+            #endif
+            return detail::find_mismatch_scalar(a, b, size, tolerance);
+        }
+
+        /** Compares two images of the same size, given as rows of pixels of
+            bytes_per_pixel 8-bit channels (e.g. 4 for rgba32, 3 for the RGB24
+            screenshots of the PixelRenderer concept), a and b pointing to the top row
+            and stride_a and stride_b being the (signed) distances in bytes from one
+            row to the next one down, so that bottom-up framebuffers are compared in
+            place.
+
+            A pixel mismatches if any of its channels differs by more than the
+            tolerance. The images are scanned with vectorized comparisons that skip
+            from one mismatching pixel to the next.
+
+            The result goes to diff, whose buffers are reused: batch comparisons that
+            keep passing the same image_diff do not allocate once it has grown.
+         */
+        inline void
+        compare_images(const uint8_t *a, std::ptrdiff_t stride_a, const uint8_t *b, std::ptrdiff_t stride_b,
+            int width, int height, int bytes_per_pixel, const image_compare_options &options, image_diff &diff)
+        {
+            diff.mismatched_pixels = 0;
+            diff.first_x = diff.first_y = -1;
+            diff.max_difference = 0;
+            diff.regions.clear();
+            diff.diff_image.clear();
+
+            // Nothing to compare, nor to report (an empty diff image)
+            if (width <= 0 || height <= 0) return;
+
+            auto stride = std::size_t(width) * std::size_t(bytes_per_pixel);
+            bool report = options.diff_image || options.regions;
+
+            if (!report && options.early_out) {
+                // Images without padding are scanned in one go
+                bool contiguous = stride_a == std::ptrdiff_t(stride) && stride_b == std::ptrdiff_t(stride);
+                auto rows = contiguous ? std::min(height, 1) : height;
+                auto size = contiguous ? stride * std::size_t(height) : stride;
+
+                for (int y = 0; y < rows; y++) {
+                    auto row_a = a + y * stride_a, row_b = b + y * stride_b;
+                    auto offset = find_mismatch(row_a, row_b, size, options.tolerance);
+                    if (offset == size) continue;
+
+                    diff.mismatched_pixels = 1;
+                    diff.first_x = int(offset % stride) / bytes_per_pixel, diff.first_y = y + int(offset / stride);
+                    auto pixel = offset - offset % std::size_t(bytes_per_pixel);
+                    for (int c = 0; c < bytes_per_pixel; c++) {
+                        unsigned ca = row_a[pixel + c], cb = row_b[pixel + c];
+                        diff.max_difference = std::max(diff.max_difference, ca > cb ? ca - cb : cb - ca);
+                    }
+                    break;
+                }
+                return;
+            }
+
+            cpu::damage_tracker areas;
+            if (options.regions) areas.resize(width, height);
+
+            if (options.diff_image) {
+                auto count = std::size_t(width) * std::size_t(height);
+                diff.diff_image.resize(count);
+                // Faded grey copy of the first image (assumes at least 3 channels)
+                auto out = &diff.diff_image[0].components[0];
+                for (int y = 0; y < height; y++) {
+                    auto p = a + y * stride_a;
+                    for (auto end = out + 4 * width; out < end; out += 4, p += bytes_per_pixel) {
+                        auto grey = uint8_t(192 + ((unsigned(p[0]) + p[1] + p[2]) * 21 >> 8));
+                        out[0] = out[1] = out[2] = grey, out[3] = 255;
+                    }
+                }
+            }
+
+            for (int y = 0; y < height; y++) {
+
+                auto row_a = a + y * stride_a, row_b = b + y * stride_b;
+
+                // Jump from mismatch to mismatch
+                for (std::size_t pos = 0; (pos += find_mismatch(row_a + pos, row_b + pos, stride - pos, options.tolerance)) < stride; ) {
+
+                    int x = int(pos) / bytes_per_pixel;
+                    pos = std::size_t(x + 1) * std::size_t(bytes_per_pixel);
+
+                    unsigned max_diff = 0;
+                    for (int c = 0; c < bytes_per_pixel; c++) {
+                        unsigned ca = row_a[x * bytes_per_pixel + c], cb = row_b[x * bytes_per_pixel + c];
+                        max_diff = std::max(max_diff, ca > cb ? ca - cb : cb - ca);
+                    }
+
+                    if (diff.mismatched_pixels++ == 0) diff.first_x = x, diff.first_y = y;
+                    diff.max_difference = std::max(diff.max_difference, max_diff);
+                    if (options.regions) areas.add(x, y, x + 1, y + 1);
+                    if (options.diff_image) diff.diff_image[std::size_t(y) * std::size_t(width) + std::size_t(x)] = { { 255, 0, 0, 255 } };
+                }
+            }
+
+            if (options.regions) {
+                std::vector<cpu::damage_tracker::rect> rects;
+                areas.get_regions(rects);
+                for (const auto &r: rects) diff.regions.push_back({ r.x, r.y, r.w, r.h });
+            }
+        }
+
+        /** Same as above, for images without padding.
+         */
+        inline void
+        compare_images(const uint8_t *a, const uint8_t *b, int width, int height, int bytes_per_pixel,
+            const image_compare_options &options, image_diff &diff)
+        {
+            auto stride = std::ptrdiff_t(width) * bytes_per_pixel;
+            compare_images(a, stride, b, stride, width, height, bytes_per_pixel, options, diff);
+        }
+
+        inline auto
+        compare_images(const uint8_t *a, const uint8_t *b, int width, int height, int bytes_per_pixel,
+            const image_compare_options &options = image_compare_options()) -> image_diff
+        {
+            image_diff diff;
+            compare_images(a, b, width, height, bytes_per_pixel, options, diff);
+            return diff;
+        }
+
+        inline void
+        compare_images(const rgba32 *a, const rgba32 *b, int width, int height, const image_compare_options &options, image_diff &diff)
+        {
+            compare_images(&a->components[0], &b->components[0], width, height, 4, options, diff);
+        }
+
+        inline auto
+        compare_images(const rgba32 *a, const rgba32 *b, int width, int height,
+            const image_compare_options &options = image_compare_options()) -> image_diff
+        {
+            return compare_images(&a->components[0], &b->components[0], width, height, 4, options);
+        }
+
+        /** Compares two framebuffers in place (see PixelRenderer::framebuffer()),
+            whatever their row order and stride. Throws std::invalid_argument if they
+            differ in size or pixel format.
+         */
+        inline void
+        compare_images(const framebuffer_view &a, const framebuffer_view &b, const image_compare_options &options, image_diff &diff)
+        {
+            if (a.width != b.width || a.height != b.height || a.format != b.format) {
+                throw std::invalid_argument("compare_images(): framebuffers differ in size or pixel format");
+            }
+
+            compare_images(a.row(0), a.stride, b.row(0), b.stride, a.width, a.height, bytes_per_pixel(a.format), options, diff);
+        }
+
+        inline auto
+        compare_images(const framebuffer_view &a, const framebuffer_view &b,
+            const image_compare_options &options = image_compare_options()) -> image_diff
+        {
+            image_diff diff;
+            compare_images(a, b, options, diff);
+            return diff;
+        }
+
+        /** Compares two screenshots as returned by PixelRenderer::_getRGB24Screenshot()
+            (possibly of different renderers).
+         */
+        template <typename RGB24ImageA, typename RGB24ImageB>
+        auto compare_screenshots(const RGB24ImageA &a, const RGB24ImageB &b, int width, int height,
+            const image_compare_options &options = image_compare_options()) -> image_diff
+        {
+            static_assert(sizeof(a[0]) == 3 && sizeof(b[0]) == 3, "RGB24 pixels must be tightly packed");
+
+            if (a.size() != std::size_t(width) * std::size_t(height) || b.size() != a.size()) {
+                throw std::invalid_argument("compare_screenshots(): image sizes do not match");
+            }
+
+            return compare_images(&a[0].rgb[0], &b[0].rgb[0], width, height, 3, options);
+        }
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cpu_features.hpp"
+#include "renderer.hpp"
+#include "native_color.hpp"
+#include "bulk_draw.hpp"
+#include "utf8.hpp"
+
+#if defined(GPC_GUI_X86) && !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+/* Instrumentation of renderers (see InstrumentedRenderer) is compiled in only if this
+   is defined to a non-zero value; otherwise the adaptor forwards every call as is.
+ */
+#ifndef GPC_GUI_INSTRUMENTATION
+#define GPC_GUI_INSTRUMENTATION 0
+#endif
+
+namespace gpc {
+
+    namespace gui {
+
+        /** The kinds of renderer calls that are timed separately.
+         */
+        enum class primitive_category { clear, fill_rect, draw_image, render_text, upload, flush };
+
+        static const std::size_t PRIMITIVE_CATEGORY_COUNT = 6;
+
+        inline auto category_name(primitive_category category) -> const char *
+        {
+            static const char *const names[PRIMITIVE_CATEGORY_COUNT] = { "clear", "fill_rect", "draw_image", "render_text", "upload", "flush" };
+            return names[std::size_t(category)];
+        }
+
+        /** What a renderer did during a frame (or, summed up, over several frames).
+
+            Pixel counts are derived from the geometry of the calls and the clipping
+            rectangle in effect: pixels_drawn is the area that clear(), fill_rect() and
+            draw_image() cover after clipping, pixels_clipped the area clipping removed.
+            Text is accounted for in glyphs: the codepoints passed to render_text*(), as
+            decoded from UTF-8 (ill-formed sequences count as the U+FFFD they render as).
+         */
+        struct render_stats {
+
+            struct category {
+                uint64_t    calls;
+                uint64_t    nanoseconds;
+            };
+
+            uint64_t    frames;
+            category    categories[PRIMITIVE_CATEGORY_COUNT];
+            uint64_t    state_changes;      // text color and clipping
+            uint64_t    pixels_drawn;
+            uint64_t    pixels_clipped;
+            uint64_t    glyphs;
+            uint64_t    bytes_uploaded;     // image pixel data
+
+            auto operator [] (primitive_category c) const -> const category & { return categories[std::size_t(c)]; }
+            auto operator [] (primitive_category c) -> category & { return categories[std::size_t(c)]; }
+
+            auto calls() const -> uint64_t
+            {
+                uint64_t n = 0;
+                for (const auto &c: categories) n += c.calls;
+                return n;
+            }
+
+            void add(const render_stats &other)
+            {
+                frames += other.frames;
+                for (std::size_t i = 0; i < PRIMITIVE_CATEGORY_COUNT; i++) {
+                    categories[i].calls       += other.categories[i].calls;
+                    categories[i].nanoseconds += other.categories[i].nanoseconds;
+                }
+                state_changes  += other.state_changes;
+                pixels_drawn   += other.pixels_drawn;
+                pixels_clipped += other.pixels_clipped;
+                glyphs         += other.glyphs;
+                bytes_uploaded += other.bytes_uploaded;
+            }
+        };
+
+        namespace detail {
+
+            /** Timestamps for the instrumentation: the time stamp counter on x86 (a few
+                cycles to read, against some 20 ns for steady_clock), steady_clock in
+                nanoseconds elsewhere. The length of a tick is measured once, against
+                steady_clock, which takes a few milliseconds: render_instrumentation does
+                it when constructed, so that it does not land in a frame.
+             */
+            struct tick_clock {
+
+                static auto now() -> uint64_t
+                {
+                    #if defined(GPC_GUI_X86)
+                    return __rdtsc();
+                    #else
+                    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+                    #endif
+                }
+
+                static auto nanoseconds_per_tick() -> double
+                {
+                    static const double rate = calibrate();
+                    return rate;
+                }
+
+                static auto to_nanoseconds(uint64_t ticks) -> uint64_t { return uint64_t(double(ticks) * nanoseconds_per_tick() + 0.5); }
+
+            private:
+
+                static auto calibrate() -> double
+                {
+                    #if defined(GPC_GUI_X86)
+                    using clock = std::chrono::steady_clock;
+                    auto t0 = clock::now();
+                    auto c0 = now();
+                    auto t1 = t0;
+                    while (t1 - t0 < std::chrono::milliseconds(5)) t1 = clock::now();
+                    auto c1 = now();
+                    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+                    return c1 > c0 ? double(ns) / double(c1 - c0) : 1.0;
+                    #else
+                    return 1.0;
+                    #endif
+                }
+            };
+
+        } // ns detail
+
+        /** Collects the counters and timings of an InstrumentedRenderer, frame by frame,
+            and optionally a trace of the individual calls.
+
+            Counting happens between begin_frame() and end_frame(); end_frame() makes the
+            counters of the frame available as last_frame() and adds them to totals().
+            Calls made outside of a frame are attributed to the next one.
+
+            Tracing records one event per call (and one per frame) into a buffer of fixed
+            capacity, allocated by start_trace(); events that do not fit are dropped.
+            write_chrome_trace() exports the trace in the JSON format of the Chrome
+            trace viewer (chrome://tracing, Perfetto).
+         */
+        class render_instrumentation {
+        public:
+
+            struct trace_event {
+                const char *name;
+                uint64_t    start, duration;    // ticks
+            };
+
+            struct frame_event {
+                uint64_t        start, duration;    // ticks
+                render_stats    stats;
+            };
+
+            render_instrumentation(): current(), last(), total(), frame_start(detail::tick_clock::now()),
+                tracing(false), trace_capacity(0), trace_start(0), dropped(0), ticks()
+            {
+                detail::tick_clock::nanoseconds_per_tick();     // calibrate now rather than in the first end_frame()
+            }
+
+            void begin_frame()
+            {
+                frame_start = detail::tick_clock::now();
+            }
+
+            void end_frame()
+            {
+                auto end = detail::tick_clock::now();
+
+                current.frames = 1;
+                for (std::size_t i = 0; i < PRIMITIVE_CATEGORY_COUNT; i++) {
+                    current.categories[i].nanoseconds = detail::tick_clock::to_nanoseconds(ticks[i]);
+                    ticks[i] = 0;
+                }
+                if (tracing) {
+                    if (frames.size() < trace_capacity) frames.push_back({ frame_start, end - frame_start, current });
+                    else dropped++;
+                }
+
+                last = current;
+                total.add(current);
+                current = render_stats();
+            }
+
+            auto last_frame() const -> const render_stats & { return last; }
+            auto totals() const -> const render_stats & { return total; }
+
+            void reset_totals() { total = render_stats(); }
+
+            // Tracing ---------------------------------------------------------
+
+            /** Starts tracing (discarding any previous trace), with room for the
+                specified number of call events (and as many frames).
+             */
+            void start_trace(std::size_t max_events)
+            {
+                events.clear(), frames.clear();
+                events.reserve(max_events), frames.reserve(max_events);
+                trace_capacity = max_events;
+                trace_start = detail::tick_clock::now();
+                dropped = 0;
+                tracing = true;
+            }
+
+            void stop_trace() { tracing = false; }
+
+            auto trace_events() const -> const std::vector<trace_event> & { return events; }
+            auto frame_events() const -> const std::vector<frame_event> & { return frames; }
+            auto dropped_events() const -> std::size_t { return dropped; }
+
+            /** Writes the trace as a Chrome trace ("JSON object format"); the stream is
+                not closed. Returns false if writing failed.
+             */
+            bool write_chrome_trace(std::FILE *file) const
+            {
+                auto us = [](uint64_t ticks) { return double(ticks) * detail::tick_clock::nanoseconds_per_tick() / 1000.0; };
+
+                std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+                std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"renderer\"}}");
+
+                for (const auto &f: frames) {
+                    const auto &s = f.stats;
+                    std::fprintf(file, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"args\":{\"calls\":%llu,\"state_changes\":%llu,\"pixels_drawn\":%llu,\"pixels_clipped\":%llu,\"glyphs\":%llu,\"bytes_uploaded\":%llu}}",
+                        us(f.start - std::min(f.start, trace_start)), us(f.duration),
+                        (unsigned long long) s.calls(), (unsigned long long) s.state_changes, (unsigned long long) s.pixels_drawn,
+                        (unsigned long long) s.pixels_clipped, (unsigned long long) s.glyphs, (unsigned long long) s.bytes_uploaded);
+                }
+                for (const auto &e: events) {
+                    std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"renderer\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                        e.name, us(e.start - std::min(e.start, trace_start)), us(e.duration));
+                }
+
+                std::fprintf(file, "\n]}\n");
+                return std::ferror(file) == 0;
+            }
+
+            // Used by InstrumentedRenderer -----------------------------------
+
+            static auto start() -> uint64_t { return detail::tick_clock::now(); }
+
+            void record(primitive_category category, uint64_t start, std::size_t calls = 1)
+            {
+                auto end = detail::tick_clock::now();
+                auto c = std::size_t(category);
+                current.categories[c].calls += calls;
+                ticks[c] += end - start;
+
+                if (tracing) {
+                    if (events.size() < trace_capacity) events.push_back({ category_name(category), start, end - start });
+                    else dropped++;
+                }
+            }
+
+            void state_change() { current.state_changes++; }
+
+            void pixels(uint64_t covered, uint64_t visible)
+            {
+                current.pixels_drawn   += visible;
+                current.pixels_clipped += covered - visible;
+            }
+
+            void glyphs(std::size_t count) { current.glyphs += count; }
+
+            void upload(std::size_t bytes) { current.bytes_uploaded += bytes; }
+
+        private:
+
+            render_stats                current, last, total;
+            uint64_t                    frame_start;
+
+            bool                        tracing;
+            std::size_t                 trace_capacity;
+            uint64_t                    trace_start;
+            std::size_t                 dropped;
+            std::vector<trace_event>    events;
+            std::vector<frame_event>    frames;
+
+            uint64_t                    ticks[PRIMITIVE_CATEGORY_COUNT];
+        };
+
+        /** Stands in for render_instrumentation when instrumentation is disabled: same
+            interface, nothing recorded.
+         */
+        class null_instrumentation {
+        public:
+
+            void begin_frame() {}
+            void end_frame() {}
+
+            auto last_frame() const -> render_stats { return render_stats(); }
+            auto totals() const -> render_stats { return render_stats(); }
+
+            void reset_totals() {}
+
+            void start_trace(std::size_t) {}
+            void stop_trace() {}
+            auto dropped_events() const -> std::size_t { return 0; }
+
+            bool write_chrome_trace(std::FILE *file) const
+            {
+                std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}\n");
+                return std::ferror(file) == 0;
+            }
+
+            static auto start() -> uint64_t { return 0; }
+            void record(primitive_category, uint64_t, std::size_t = 1) {}
+            void state_change() {}
+            void pixels(uint64_t, uint64_t) {}
+            void glyphs(std::size_t) {}
+            void upload(std::size_t) {}
+        };
+
+        /** Adaptor that implements the Renderer interface on top of another Renderer
+            (the "backend"), forwarding every call and, if Enabled, measuring it: calls
+            and time per primitive category, pixels drawn and clipped away, glyphs and
+            uploaded bytes, per frame (see render_instrumentation).
+
+            Enabled defaults to GPC_GUI_INSTRUMENTATION. When disabled, instrumentation()
+            is a null_instrumentation and the adaptor reduces to inline forwarding calls,
+            so that the code using it need not change.
+
+            Time spent by deferred backends (such as TiledRenderer) shows up under flush.
+         */
+        template <class Renderer, bool Enabled = (GPC_GUI_INSTRUMENTATION != 0)>
+        class InstrumentedRenderer {
+        public:
+
+            using backend_t         = Renderer;
+            using coord_t           = typename Renderer::coord_t;
+            using length_t          = typename Renderer::length_t;
+            using native_color      = typename Renderer::native_color;
+            using image_handle      = typename Renderer::image_handle;
+            using font_handle       = typename Renderer::font_handle;
+            using instrumentation_t = typename std::conditional<Enabled, render_instrumentation, null_instrumentation>::type;
+
+            static const horizontal_direction   horizontal_axis_dir = Renderer::horizontal_axis_dir;
+            static const vertical_direction     vertical_axis_dir   = Renderer::vertical_axis_dir;
+
+            static const bool enabled = Enabled;
+
+            explicit InstrumentedRenderer(Renderer *backend_): backend(backend_) {}
+
+            auto get_backend() const -> Renderer * { return backend; }
+
+            auto instrumentation() -> instrumentation_t & { return instr; }
+            auto instrumentation() const -> const instrumentation_t & { return instr; }
+
+            // Context ---------------------------------------------------------
+
+            void define_viewport(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                backend->define_viewport(x, y, w, h);
+                clips.reset();
+            }
+
+            void prepare_context() { backend->prepare_context(); }
+            void leave_context() { backend->leave_context(); }
+
+            auto width () const -> length_t { return backend->width (); }
+            auto height() const -> length_t { return backend->height(); }
+
+            static constexpr auto rgba_norm_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Renderer>::from_rgba_norm(color); }
+
+            static constexpr auto rgb_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Renderer>::from_rgb(color); }
+
+            // Resources -------------------------------------------------------
+
+            template <typename... Args>
+            auto register_font(Args&&... args) -> font_handle
+            {
+                auto t = instr.start();
+                auto handle = backend->register_font(std::forward<Args>(args)...);
+                instr.record(primitive_category::upload, t);
+                return handle;
+            }
+
+            template <typename Pixel>
+            auto register_rgba32_image(length_t w, length_t h, const Pixel *pixels) -> image_handle
+            {
+                auto t = instr.start();
+                auto handle = backend->register_rgba32_image(w, h, pixels);
+                instr.record(primitive_category::upload, t);
+                instr.upload(std::size_t(whole_pixels(w)) * std::size_t(whole_pixels(h)) * sizeof(Pixel));
+                return handle;
+            }
+
+            template <typename Pixel>
+            auto register_rgba_image(length_t w, length_t h, const Pixel *pixels) -> image_handle
+            {
+                auto t = instr.start();
+                auto handle = backend->register_rgba_image(w, h, pixels);
+                instr.record(primitive_category::upload, t);
+                instr.upload(std::size_t(whole_pixels(w)) * std::size_t(whole_pixels(h)) * sizeof(Pixel));
+                return handle;
+            }
+
+            void unregister_image(image_handle image) { backend->unregister_image(image); }
+
+            void retain_image(image_handle image) { backend->retain_image(image); }
+
+            void unregister_font(font_handle font) { backend->unregister_font(font); }
+
+            // Drawing ---------------------------------------------------------
+
+            void clear(const native_color &color)
+            {
+                auto t = instr.start();
+                backend->clear(color);
+                instr.record(primitive_category::clear, t);
+
+                auto area = uint64_t(whole_pixels(backend->width())) * uint64_t(whole_pixels(backend->height()));
+                instr.pixels(area, area);
+            }
+
+            void fill_rect(coord_t x, coord_t y, length_t w, length_t h, const native_color &color)
+            {
+                auto t = instr.start();
+                backend->fill_rect(x, y, w, h, color);
+                instr.record(primitive_category::fill_rect, t);
+                count_pixels(x, y, w, h);
+            }
+
+            void draw_image(coord_t x, coord_t y, length_t w, length_t h, image_handle image, coord_t offset_x = 0, coord_t offset_y = 0)
+            {
+                auto t = instr.start();
+                backend->draw_image(x, y, w, h, image, offset_x, offset_y);
+                instr.record(primitive_category::draw_image, t);
+                count_pixels(x, y, w, h);
+            }
+
+            /** Bulk calls (see bulk_draw.hpp) count as one call per record.
+             */
+            void fill_rects(const fill_record_t<Renderer> *records, std::size_t count)
+            {
+                auto t = instr.start();
+                gpc::gui::fill_rects(*backend, records, count);
+                instr.record(primitive_category::fill_rect, t, count);
+                for (std::size_t i = 0; Enabled && i < count; i++) count_pixels(records[i].x, records[i].y, records[i].w, records[i].h);
+            }
+
+            void draw_images(const image_record_t<Renderer> *records, std::size_t count)
+            {
+                auto t = instr.start();
+                gpc::gui::draw_images(*backend, records, count);
+                instr.record(primitive_category::draw_image, t, count);
+                for (std::size_t i = 0; Enabled && i < count; i++) count_pixels(records[i].x, records[i].y, records[i].w, records[i].h);
+            }
+
+            void set_text_color(const native_color &color)
+            {
+                backend->set_text_color(color);
+                instr.state_change();
+            }
+
+            void render_text(font_handle font, coord_t x, coord_t y, const char32_t *text, std::size_t count)
+            {
+                auto t = instr.start();
+                backend->render_text(font, x, y, text, count);
+                instr.record(primitive_category::render_text, t);
+                instr.glyphs(count);
+            }
+
+            void render_text_utf8(font_handle font, coord_t x, coord_t y, const char *text, std::size_t length)
+            {
+                auto t = instr.start();
+                backend->render_text_utf8(font, x, y, text, length);
+                instr.record(primitive_category::render_text, t);
+                if (Enabled) instr.glyphs(utf8_length(text, length));
+            }
+
+            // Clipping --------------------------------------------------------
+
+            void set_clipping_rect(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                backend->set_clipping_rect(x, y, w, h);
+                instr.state_change();
+                clips.set(to_bounds(x, y, w, h));
+            }
+
+            void cancel_clipping()
+            {
+                backend->cancel_clipping();
+                instr.state_change();
+                clips.cancel();
+            }
+
+            void push_clip(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                backend->push_clip(x, y, w, h);
+                instr.state_change();
+                clips.push(to_bounds(x, y, w, h));
+            }
+
+            void pop_clip()
+            {
+                backend->pop_clip();
+                instr.state_change();
+                clips.pop();
+            }
+
+            auto clip_depth() const -> std::size_t { return backend->clip_depth(); }
+
+            auto clip_test(coord_t x, coord_t y, length_t w, length_t h) const -> clip_result { return backend->clip_test(x, y, w, h); }
+
+            // Deferred backends -----------------------------------------------
+
+            void flush()
+            {
+                auto t = instr.start();
+                backend->flush();
+                instr.record(primitive_category::flush, t);
+            }
+
+            auto _getRGB24Screenshot() -> decltype(std::declval<Renderer &>()._getRGB24Screenshot())
+            {
+                return backend->_getRGB24Screenshot();
+            }
+
+        private:
+
+            using traits = coord_traits<coord_t>;
+
+            // Pixel bounds (of the pixels touched, for fractional coordinates)
+            struct bounds { int x1, y1, x2, y2; };
+
+            template <typename T>
+            static auto whole_pixels(T v) -> int { return traits::round(traits::raw(v)); }
+
+            static auto to_bounds(coord_t x, coord_t y, length_t w, length_t h) -> bounds
+            {
+                auto rx = traits::raw(x), ry = traits::raw(y);
+                return { traits::floor(rx), traits::floor(ry), traits::ceil(rx + traits::raw(w)), traits::ceil(ry + traits::raw(h)) };
+            }
+
+            /** Follows the clipping rectangle, in the coordinates of the caller (either
+                axis direction), to tell how much of a rectangle clipping lets through.
+             */
+            struct clip_tracker {
+
+                bool                                    active = false;
+                bounds                                  rect = {};
+                std::vector<std::pair<bool, bounds>>    stack;
+
+                void reset() { active = false; stack.clear(); }
+                void set(const bounds &b) { active = true, rect = b; }
+                void cancel() { active = false; }
+
+                void push(const bounds &b)
+                {
+                    stack.emplace_back(active, rect);
+                    rect = active ? intersect(rect, b) : b;
+                    active = true;
+                }
+
+                void pop()
+                {
+                    assert(!stack.empty());
+                    active = stack.back().first, rect = stack.back().second;
+                    stack.pop_back();
+                }
+
+                auto visible(const bounds &b, const bounds &surface) const -> uint64_t
+                {
+                    return area(intersect(active ? intersect(rect, surface) : surface, b));
+                }
+            };
+
+            struct null_clip_tracker {
+                void reset() {}
+                void set(const bounds &) {}
+                void cancel() {}
+                void push(const bounds &) {}
+                void pop() {}
+                auto visible(const bounds &, const bounds &) const -> uint64_t { return 0; }
+            };
+
+            static auto intersect(const bounds &a, const bounds &b) -> bounds
+            {
+                return { std::max(a.x1, b.x1), std::max(a.y1, b.y1), std::min(a.x2, b.x2), std::min(a.y2, b.y2) };
+            }
+
+            static auto area(const bounds &b) -> uint64_t
+            {
+                return b.x2 > b.x1 && b.y2 > b.y1 ? uint64_t(b.x2 - b.x1) * uint64_t(b.y2 - b.y1) : 0;
+            }
+
+            void count_pixels(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                if (!Enabled) return;
+
+                bounds rect = to_bounds(x, y, w, h);
+                bounds surface = { 0, 0, whole_pixels(backend->width()), whole_pixels(backend->height()) };
+                instr.pixels(area(rect), clips.visible(rect, surface));
+            }
+
+            Renderer                   *backend;
+            instrumentation_t           instr;
+            typename std::conditional<Enabled, clip_tracker, null_clip_tracker>::type clips;
+        };
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Read-only memory mapping of a whole file, e.g. for loading fonts without
+            reading them into a buffer first. The pages are loaded by the OS as they are
+            accessed, and shared between processes mapping the same file.
+         */
+        class mapped_file {
+        public:
+
+            mapped_file(): data_(nullptr), size_(0) {}
+
+            /** Maps the file; throws std::runtime_error if it cannot be opened or mapped.
+             */
+            explicit mapped_file(const std::string &path): mapped_file()
+            {
+                #if defined(_WIN32)
+
+                auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("mapped_file: cannot open \"" + path + "\"");
+
+                LARGE_INTEGER size;
+                if (!GetFileSizeEx(file, &size)) { CloseHandle(file); throw std::runtime_error("mapped_file: cannot get size of \"" + path + "\""); }
+                size_ = std::size_t(size.QuadPart);
+
+                if (size_ > 0) {
+                    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                    if (mapping) {
+                        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                        CloseHandle(mapping);   // the view keeps the mapping alive
+                    }
+                }
+                CloseHandle(file);
+
+                #else
+
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0) throw std::runtime_error("mapped_file: cannot open \"" + path + "\"");
+
+                struct stat st;
+                if (::fstat(fd, &st) != 0) { ::close(fd); throw std::runtime_error("mapped_file: cannot get size of \"" + path + "\""); }
+                size_ = std::size_t(st.st_size);
+
+                if (size_ > 0) {
+                    auto addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (addr != MAP_FAILED) data_ = static_cast<const uint8_t*>(addr);
+                }
+                ::close(fd);    // the mapping keeps the file alive
+
+                #endif
+
+                if (size_ > 0 && !data_) throw std::runtime_error("mapped_file: cannot map \"" + path + "\"");
+            }
+
+            ~mapped_file() { unmap(); }
+
+            mapped_file(const mapped_file &) = delete;
+            mapped_file & operator = (const mapped_file &) = delete;
+
+            mapped_file(mapped_file &&other): data_(other.data_), size_(other.size_)
+            {
+                other.data_ = nullptr, other.size_ = 0;
+            }
+
+            mapped_file & operator = (mapped_file &&other)
+            {
+                if (this != &other) {
+                    unmap();
+                    data_ = other.data_, size_ = other.size_;
+                    other.data_ = nullptr, other.size_ = 0;
+                }
+                return *this;
+            }
+
+            auto data() const -> const uint8_t * { return data_; }
+            auto size() const -> std::size_t { return size_; }
+
+        private:
+
+            void unmap()
+            {
+                if (!data_) return;
+
+                #if defined(_WIN32)
+                UnmapViewOfFile(data_);
+                #else
+                ::munmap(const_cast<uint8_t*>(data_), size_);
+                #endif
+                data_ = nullptr, size_ = 0;
+            }
+
+            const uint8_t  *data_;
+            std::size_t     size_;
+        };
+
+    } // ns gui
+
+} // ns gpc
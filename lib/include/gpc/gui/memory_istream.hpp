@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+
+namespace gpc {
+
+    namespace gui {
+
+        namespace detail {
+
+            struct memory_streambuf: std::streambuf {
+
+                memory_streambuf(const char *data, std::size_t size)
+                {
+                    auto p = const_cast<char*>(data);   // never written to: the buffer has no put area
+                    setg(p, p, p + size);
+                }
+            };
+
+        } // ns detail
+
+        /** Input stream reading straight from a block of memory (e.g. a font embedded
+            as a byte array, or a memory-mapped file), so that it can be deserialized
+            without first being copied into a string or string stream.
+         */
+        class memory_istream: private detail::memory_streambuf, public std::istream {
+        public:
+
+            memory_istream(const void *data, std::size_t size):
+                detail::memory_streambuf(static_cast<const char*>(data), size),
+                std::istream(static_cast<std::streambuf*>(this))
+            {}
+        };
+
+    } // ns gui
+
+} // ns gpc
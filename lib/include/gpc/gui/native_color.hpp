@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "color.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** How a renderer converts normalized colors to its native color specifiers.
+
+            Converting colors must always be possible at compile time (see docs/log.txt,
+            2015-12-15): by default, the trait uses the renderer's static constexpr
+            rgba_norm_to_native() and rgb_to_native(). A backend whose conversions are
+            not static members can specialize the trait instead.
+         */
+        template <class Renderer>
+        struct native_color_traits {
+
+            using native_color = typename Renderer::native_color;
+
+            // Templates, so that a renderer lacking a conversion fails has_constexpr_native_color instead of the build
+
+            template <class R = Renderer>
+            static constexpr auto from_rgba_norm(const rgba_norm &color) -> decltype(R::rgba_norm_to_native(color)) { return R::rgba_norm_to_native(color); }
+
+            template <class R = Renderer>
+            static constexpr auto from_rgb(const rgba_norm &color) -> decltype(R::rgb_to_native(color)) { return R::rgb_to_native(color); }
+        };
+
+        namespace detail {
+
+            template <typename... Ts> struct make_void { using type = void; };
+
+            template <class Renderer, typename = void>
+            struct constexpr_native_color: std::false_type {};
+
+            // Only well-formed if both conversions can be evaluated in a constant expression
+            template <class Renderer>
+            struct constexpr_native_color<Renderer, typename make_void<
+                std::integral_constant<bool, (void(native_color_traits<Renderer>::from_rgba_norm(rgba_norm(1, 0, 0, 0.5f))), true)>,
+                std::integral_constant<bool, (void(native_color_traits<Renderer>::from_rgb(rgba_norm(0, 1, 0))), true)>
+            >::type>: std::true_type {};
+
+        } // ns detail
+
+        /** True if the renderer's color conversions can be done at compile time.
+            Backends and adaptors check themselves with this (static_assert).
+         */
+        template <class Renderer>
+        struct has_constexpr_native_color: detail::constexpr_native_color<Renderer> {};
+
+        /** Converts a color to a renderer's native color; usable in constant expressions,
+            e.g. to make constant colors of drawing loops immediate values:
+
+                constexpr auto grey = native_color_of<renderer_t>({ 0.5f, 0.5f, 0.5f });
+         */
+        template <class Renderer>
+        constexpr auto native_color_of(const rgba_norm &color) -> typename Renderer::native_color
+        {
+            return native_color_traits<Renderer>::from_rgba_norm(color);
+        }
+
+        /** Fixed set of native colors, converted at compile time (see make_palette()).
+         */
+        template <class Renderer, std::size_t Size>
+        struct color_palette {
+
+            static_assert(has_constexpr_native_color<Renderer>::value, "the renderer must convert colors at compile time");
+
+            using native_color = typename Renderer::native_color;
+
+            static constexpr auto size() -> std::size_t { return Size; }
+
+            constexpr auto operator [] (std::size_t index) const -> const native_color & { return colors[index]; }
+
+            native_color colors[Size];
+        };
+
+        /** Makes a palette from normalized colors:
+
+                static constexpr auto palette = make_palette<renderer_t>(rgba_norm::black(), rgba_norm { 1, 0, 0 });
+                renderer.fill_rect(x, y, w, h, palette[1]);
+         */
+        template <class Renderer, typename... Colors>
+        constexpr auto make_palette(const Colors &... colors) -> color_palette<Renderer, sizeof...(Colors)>
+        {
+            return { { native_color_of<Renderer>(colors)... } };
+        }
+
+    } // ns gui
+
+} // ns gpc
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gpc/fonts/rasterized_font.hpp>
+
+#include "mapped_file.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Compact binary font format ("packed font", .gpf) that renderers use in place,
+            e.g. straight out of a memory-mapped file or an embedded byte array: loading
+            a font amounts to checking its header and tables.
+
+            Layout (native byte order, which the header records; every section starts at
+            a multiple of ALIGNMENT bytes):
+              header        see struct header
+              index         glyph_count codepoints (uint32), sorted
+              glyphs        glyph_count glyph records (struct glyph), parallel to the index
+              pixels        coverage of the glyphs (one byte per pixel, rows top-down),
+                            trimmed to their non-empty pixels and packed back to back
+
+            Packed fonts are produced from rasterized fonts (.rft) by write(), see the
+            GPCFontPacker tool. Data that is not memory-mapped (such as embedded arrays)
+            must be aligned to ALIGNMENT bytes.
+         */
+        class packed_font {
+        public:
+
+            static const uint16_t       VERSION         = 1;
+            static const std::size_t    ALIGNMENT       = 16;
+            static const uint32_t       ENDIANNESS_MARK = 0x01020304;
+
+            struct header {
+                char        magic[4];           // "GPCP"
+                uint16_t    version;
+                uint16_t    header_size;
+                uint32_t    byte_order;         // ENDIANNESS_MARK, in the byte order of the producer
+                uint32_t    glyph_count;
+                uint32_t    glyph_size;         // sizeof(glyph)
+                uint32_t    index_offset, glyphs_offset, pixels_offset;
+                uint32_t    pixels_size;
+                uint32_t    file_size;
+                uint32_t    reserved[2];
+            };
+
+            struct glyph {
+                int32_t     x_min, y_min;       // relative to pen position and baseline
+                int32_t     width, height;      // also the pitch of the coverage block
+                int32_t     adv_x;
+                uint32_t    offset;             // of the coverage block
+                uint32_t    packed;             // coverage is trimmed and packed (always, in a file)
+            };
+
+            static_assert(sizeof(header) == 48, "packed_font::header must not contain padding");
+            static_assert(sizeof(glyph) == 28, "packed_font::glyph must not contain padding");
+
+            packed_font(): data_(nullptr), size_(0), header_(nullptr) {}
+
+            /** Checks the data and makes a view of it; throws std::runtime_error if it is
+                not a valid packed font. The data must remain available for as long as
+                the font (or anything built from it) is in use; owner, if specified, is
+                kept alive until then.
+             */
+            packed_font(const void *data, std::size_t size, std::shared_ptr<const void> owner_ = nullptr):
+                data_(static_cast<const uint8_t*>(data)), size_(size), header_(nullptr), owner(std::move(owner_))
+            {
+                if (reinterpret_cast<std::uintptr_t>(data_) % ALIGNMENT != 0) fail("data is not aligned");
+                if (size_ < sizeof(header)) fail("data too short");
+
+                auto h = reinterpret_cast<const header*>(data_);
+                if (std::memcmp(h->magic, "GPCP", 4) != 0) fail("not a packed font");
+                if (h->byte_order != ENDIANNESS_MARK) fail("wrong byte order");
+                if (h->version != VERSION) fail("unsupported version");
+                if (h->header_size != sizeof(header) || h->glyph_size != sizeof(glyph) || h->file_size > size_) fail("inconsistent header");
+
+                auto fits = [&](uint32_t offset, uint64_t bytes) {
+                    return offset % ALIGNMENT == 0 && offset >= sizeof(header) && offset + bytes <= h->file_size;
+                };
+                if (!fits(h->index_offset , uint64_t(h->glyph_count) * 4) ||
+                    !fits(h->glyphs_offset, uint64_t(h->glyph_count) * sizeof(glyph)) ||
+                    !fits(h->pixels_offset, h->pixels_size)) fail("sections out of bounds");
+
+                header_ = h;
+
+                // Make sure no glyph reads coverage outside the pixel section
+                for (auto g = glyphs(), end = g + glyph_count(); g < end; g++) {
+                    if (g->width < 0 || g->height < 0 || !g->packed ||
+                        uint64_t(g->offset) + uint64_t(g->width) * uint64_t(g->height) > h->pixels_size) fail("glyph out of bounds");
+                }
+            }
+
+            /** Maps a packed font file into memory.
+             */
+            static auto load_file(const std::string &path) -> packed_font
+            {
+                auto file = std::make_shared<mapped_file>(path);
+                return packed_font(file->data(), file->size(), file);
+            }
+
+            auto data() const -> const uint8_t * { return data_; }
+            auto size() const -> std::size_t { return size_; }
+
+            auto glyph_count() const -> std::size_t { return header_->glyph_count; }
+
+            auto codepoints() const -> const char32_t *
+            {
+                return reinterpret_cast<const char32_t*>(data_ + header_->index_offset);
+            }
+
+            auto glyphs() const -> const glyph *
+            {
+                return reinterpret_cast<const glyph*>(data_ + header_->glyphs_offset);
+            }
+
+            auto pixels() const -> const uint8_t * { return data_ + header_->pixels_offset; }
+            auto pixels_size() const -> std::size_t { return header_->pixels_size; }
+
+            /** What keeps the data alive (may be empty).
+             */
+            auto data_owner() const -> const std::shared_ptr<const void> & { return owner; }
+
+            /** Trims the coverage bitmap of a glyph (given at src, pitch g.width) to its
+                non-empty pixels, appends the result to out and updates the glyph.
+             */
+            static void pack_glyph(const uint8_t *src, glyph &g, std::vector<uint8_t> &out)
+            {
+                int x1 = g.width, y1 = g.height, x2 = 0, y2 = 0;
+
+                for (int y = 0; y < g.height; y++) {
+                    for (int x = 0; x < g.width; x++) {
+                        if (src[y * g.width + x] != 0) {
+                            x1 = std::min(x1, x), x2 = std::max(x2, x + 1);
+                            y1 = std::min(y1, y), y2 = std::max(y2, y + 1);
+                        }
+                    }
+                }
+                if (x1 >= x2) x1 = y1 = x2 = y2 = 0;
+
+                auto offset = out.size();
+                for (int y = y1; y < y2; y++) {
+                    out.insert(out.end(), src + y * g.width + x1, src + y * g.width + x2);
+                }
+
+                // Coverage rows are stored top-down, the glyph's y_min is at the bottom
+                g.y_min += g.height - y2;
+                g.x_min += x1;
+                g.width = x2 - x1, g.height = y2 - y1;
+                g.offset = uint32_t(offset);
+                g.packed = 1;
+            }
+
+            /** Converts (the first variant of) a rasterized font into a packed font.
+             */
+            static void write(const gpc::fonts::rasterized_font &rfont, std::vector<uint8_t> &out)
+            {
+                const auto &variant = rfont.variants[0];
+                auto count = uint32_t(variant.glyphs.size());
+
+                std::vector<glyph> records;
+                std::vector<uint8_t> pixels;
+                records.reserve(count);
+                for (const auto &rec: variant.glyphs) {
+                    const auto &bounds = rec.cbox.bounds;
+                    glyph g = { bounds.x_min, bounds.y_min, bounds.x_max - bounds.x_min, bounds.y_max - bounds.y_min,
+                        rec.cbox.adv_x, 0, 0 };
+                    pack_glyph(variant.pixels.data() + rec.pixel_base, g, pixels);
+                    records.push_back(g);
+                }
+
+                header h = {};
+                std::memcpy(h.magic, "GPCP", 4);
+                h.version = VERSION, h.header_size = sizeof(header);
+                h.byte_order = ENDIANNESS_MARK;
+                h.glyph_count = count, h.glyph_size = sizeof(glyph);
+                h.index_offset  = align(sizeof(header));
+                h.glyphs_offset = align(h.index_offset + 4 * count);
+                h.pixels_offset = align(h.glyphs_offset + uint32_t(sizeof(glyph)) * count);
+                h.pixels_size   = uint32_t(pixels.size());
+                h.file_size     = align(h.pixels_offset + h.pixels_size);
+
+                out.assign(h.file_size, 0);
+                std::memcpy(&out[0], &h, sizeof(h));
+                for (uint32_t i = 0; i < count; i++) {
+                    uint32_t cp = uint32_t(rfont.index[i]);
+                    std::memcpy(&out[h.index_offset + 4 * i], &cp, 4);
+                }
+                if (count > 0) std::memcpy(&out[h.glyphs_offset], records.data(), sizeof(glyph) * count);
+                if (!pixels.empty()) std::memcpy(&out[h.pixels_offset], pixels.data(), pixels.size());
+            }
+
+        private:
+
+            static auto align(std::size_t offset) -> uint32_t
+            {
+                return uint32_t((offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+            }
+
+            [[noreturn]] static void fail(const char *reason)
+            {
+                throw std::runtime_error(std::string("packed_font: ") + reason);
+            }
+
+            const uint8_t                  *data_;
+            std::size_t                     size_;
+            const header                   *header_;
+            std::shared_ptr<const void>     owner;
+        };
+
+    } // ns gui
+
+} // ns gpc
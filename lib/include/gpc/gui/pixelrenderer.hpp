@@ -23,7 +23,7 @@ namespace gpc {
          */
         template <
             VerticalDirection VertAxisDir,
-            typename CoordType // TODO: must be a signed integral type
+            typename CoordType // signed integral type, or fixed_point for sub-pixel coordinates
         >
         class PixelRenderer: public Renderer<VertAxisDir, CoordType> {
         public:
@@ -46,6 +46,17 @@ namespace gpc {
                 must be exactly as many rows as the content rectangle is high.
              */
             auto _getRGB24Screenshot() -> _RGB24Image;
+
+            /** Optional, for frequent captures (e.g. streaming): returns a read-only view
+                of the live framebuffer (pointer, stride, pixel format and row order, see
+                framebuffer_view.hpp) without copying or converting anything.
+             */
+            auto framebuffer() const -> framebuffer_view;
+
+            /** Optional: copies the display content into a caller-owned buffer, top row
+                first, converting it to the requested pixel format on the way.
+             */
+            void read_pixels(pixel_format format, uint8_t *dst, std::ptrdiff_t dst_stride = 0) const;
             
         };
 
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "renderer.hpp"
+#include "native_color.hpp"
+#include "utf8.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        /** Adaptor that implements the Renderer interface on top of another Renderer
+            (the "backend"), recording draw calls into a command buffer ("display list")
+            instead of executing them right away.
+
+            Resource management (fonts, images, color conversion) is forwarded to the
+            backend immediately; everything that draws or changes drawing state is
+            recorded, and executed by replay().
+
+            While recording, the following optimizations take place:
+            - state changes that have no effect (same clipping rect or text color as
+              before, or overridden before the next draw) are dropped;
+            - the text color is folded into the text commands, so that it is only set
+              on the backend when it actually changes;
+            - a draw command is moved up to join the most recent command of the same
+              kind and state (color, image, font) if that does not change the result,
+              i.e. if it does not overlap any of the commands it jumps over;
+            - adjacent fill_rect's of the same color forming a rectangle are merged.
+
+            Frames are delimited by begin_frame() / end_frame(). end_frame() compares
+            the new frame with the previous one, so that flush() can skip the replay
+            entirely for backends that retain their content (such as the CPU renderer).
+            In the steady state, recording a frame does not allocate memory.
+         */
+        template <class Renderer>
+        class RecordingRenderer {
+        public:
+
+            using backend_t     = Renderer;
+            using coord_t       = typename Renderer::coord_t;
+            using length_t      = typename Renderer::length_t;
+            using native_color  = typename Renderer::native_color;
+            using image_handle  = typename Renderer::image_handle;
+            using font_handle   = typename Renderer::font_handle;
+
+            static const horizontal_direction   horizontal_axis_dir = Renderer::horizontal_axis_dir;
+            static const vertical_direction     vertical_axis_dir   = Renderer::vertical_axis_dir;
+
+            static_assert(std::is_trivially_copyable<native_color>::value, "native_color must be trivially copyable to be recorded");
+            static_assert(std::is_trivially_copyable<image_handle>::value, "image_handle must be trivially copyable to be recorded");
+            static_assert(std::is_trivially_copyable<font_handle >::value, "font_handle must be trivially copyable to be recorded");
+            static_assert(has_constexpr_native_color<Renderer>::value, "the backend must convert colors at compile time");
+
+            /** How far back (in commands) a draw command may be moved to join one with
+                the same state.
+             */
+            static const std::size_t MAX_LOOKBACK = 16;
+
+            explicit RecordingRenderer(Renderer *backend_):
+                backend(backend_), segment_start(0), text_color(), text_color_set(false), changed(true) {}
+
+            auto get_backend() const -> Renderer * { return backend; }
+
+            // Forwarded to the backend --------------------------------------------
+
+            static constexpr auto rgba_norm_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Renderer>::from_rgba_norm(color); }
+
+            static constexpr auto rgb_to_native(const rgba_norm &color) -> native_color { return native_color_traits<Renderer>::from_rgb(color); }
+
+            template <typename... Args>
+            auto register_font(Args&&... args) -> font_handle { return backend->register_font(std::forward<Args>(args)...); }
+
+            template <typename... Args>
+            auto register_rgba32_image(Args&&... args) -> image_handle { return backend->register_rgba32_image(std::forward<Args>(args)...); }
+
+            template <typename... Args>
+            auto register_rgba_image(Args&&... args) -> image_handle { return backend->register_rgba_image(std::forward<Args>(args)...); }
+
+            /** Takes effect immediately: an image must not be unregistered while
+                recorded commands still use it.
+             */
+            void unregister_image(image_handle image) { backend->unregister_image(image); }
+
+            void retain_image(image_handle image) { backend->retain_image(image); }
+
+            void unregister_font(font_handle font) { backend->unregister_font(font); }
+
+            // Recorded ------------------------------------------------------------
+
+            void clear(const native_color &color)
+            {
+                command cmd(opcode::clear);
+                cmd.color = color;
+                commands.push_back(cmd);
+                segment_start = commands.size();
+            }
+
+            void fill_rect(coord_t x, coord_t y, length_t w, length_t h, const native_color &color)
+            {
+                command cmd(opcode::fill_rect, x, y, w, h);
+                cmd.color = color;
+                add_draw_command(cmd);
+            }
+
+            void draw_image(coord_t x, coord_t y, length_t w, length_t h, image_handle image, coord_t offset_x = 0, coord_t offset_y = 0)
+            {
+                command cmd(opcode::draw_image, x, y, w, h);
+                cmd.image = { image, offset_x, offset_y };
+                add_draw_command(cmd);
+            }
+
+            void set_text_color(const native_color &color)
+            {
+                text_color = color;
+                text_color_set = true;
+            }
+
+            void render_text(font_handle font, coord_t x, coord_t y, const char32_t *str, std::size_t count)
+            {
+                command cmd(opcode::render_text, x, y, 0, 0);
+                cmd.text = { font, text_color, text_color_set, uint32_t(text.size()), uint32_t(count) };
+                text.insert(text.end(), str, str + count);
+                add_draw_command(cmd);
+            }
+
+            /** UTF-8 text is decoded straight into the text buffer of the frame.
+             */
+            void render_text_utf8(font_handle font, coord_t x, coord_t y, const char *str, std::size_t length)
+            {
+                auto first = text.size();
+                text.resize(first + length);
+                auto count = length > 0 ? utf8_to_ucs4(str, length, &text[first]) : 0;
+                text.resize(first + count);
+
+                command cmd(opcode::render_text, x, y, 0, 0);
+                cmd.text = { font, text_color, text_color_set, uint32_t(first), uint32_t(count) };
+                add_draw_command(cmd);
+            }
+
+            void set_clipping_rect(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                set_clip(command(opcode::set_clipping_rect, x, y, w, h));
+            }
+
+            void cancel_clipping()
+            {
+                set_clip(command(opcode::cancel_clipping));
+            }
+
+            /** Nested clipping is recorded as the resulting clipping rectangles, so
+                replay() only needs set_clipping_rect() and cancel_clipping().
+             */
+            void push_clip(coord_t x, coord_t y, length_t w, length_t h)
+            {
+                clip_stack.push_back(clip);
+
+                auto outer = clip_bounds();
+                coord_t x1 = std::max(x, outer.x1), y1 = std::max(y, outer.y1);
+                coord_t x2 = std::min(coord_t(x + coord_t(w)), outer.x2), y2 = std::min(coord_t(y + coord_t(h)), outer.y2);
+                set_clip(command(opcode::set_clipping_rect, x1, y1, length_t(std::max(x2 - x1, coord_t(0))), length_t(std::max(y2 - y1, coord_t(0)))));
+            }
+
+            void pop_clip()
+            {
+                assert(!clip_stack.empty());
+                auto restored = clip_stack.back();
+                clip_stack.pop_back();
+                set_clip(restored);
+            }
+
+            auto clip_depth() const -> std::size_t { return clip_stack.size(); }
+
+            auto clip_test(coord_t x, coord_t y, length_t w, length_t h) const -> clip_result
+            {
+                auto outer = clip_bounds();
+                coord_t x2 = x + coord_t(w), y2 = y + coord_t(h);
+                if (w == 0 || h == 0 || x2 <= outer.x1 || x >= outer.x2 || y2 <= outer.y1 || y >= outer.y2) return clip_result::outside;
+                return x >= outer.x1 && x2 <= outer.x2 && y >= outer.y1 && y2 <= outer.y2 ? clip_result::inside : clip_result::partial;
+            }
+
+            // Frames --------------------------------------------------------------
+
+            /** Starts recording a new frame. Does not release the memory used by the
+                previous one.
+             */
+            void begin_frame()
+            {
+                std::swap(commands, prev_commands);
+                std::swap(text, prev_text);
+                commands.clear(), text.clear();
+                segment_start = 0;
+
+                // Clipping carries over from the previous frame, but the backend is left unclipped by replay()
+                if (clip.op == opcode::set_clipping_rect) {
+                    commands.push_back(clip);
+                    segment_start = 1;
+                }
+                prev_clip = command(opcode::cancel_clipping);
+            }
+
+            /** Finishes recording the current frame and determines whether it differs
+                from the previous one.
+             */
+            void end_frame()
+            {
+                changed = !(commands.size() == prev_commands.size() && text == prev_text
+                    && std::equal(commands.begin(), commands.end(), prev_commands.begin(), &command::equal));
+            }
+
+            auto frame_changed() const -> bool { return changed; }
+
+            auto command_count() const -> std::size_t { return commands.size(); }
+
+            /** Executes the current frame on the backend.
+             */
+            void replay()
+            {
+                bool clipping = false;
+                bool have_text_color = false;
+                native_color current_text_color {};
+
+                for (const auto &cmd: commands) {
+                    switch (cmd.op) {
+                    case opcode::clear:
+                        backend->clear(cmd.color);
+                        break;
+                    case opcode::fill_rect:
+                        backend->fill_rect(cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+                        break;
+                    case opcode::draw_image:
+                        backend->draw_image(cmd.x, cmd.y, cmd.w, cmd.h, cmd.image.handle, cmd.image.offset_x, cmd.image.offset_y);
+                        break;
+                    case opcode::render_text:
+                        if (cmd.text.color_set && (!have_text_color || !same_color(current_text_color, cmd.text.color))) {
+                            backend->set_text_color(cmd.text.color);
+                            current_text_color = cmd.text.color, have_text_color = true;
+                        }
+                        backend->render_text(cmd.text.font, cmd.x, cmd.y, &text[cmd.text.first], cmd.text.count);
+                        break;
+                    case opcode::set_clipping_rect:
+                        backend->set_clipping_rect(cmd.x, cmd.y, cmd.w, cmd.h);
+                        clipping = true;
+                        break;
+                    case opcode::cancel_clipping:
+                        backend->cancel_clipping();
+                        clipping = false;
+                        break;
+                    }
+                }
+
+                // Leave the backend in the default state
+                if (clipping) backend->cancel_clipping();
+            }
+
+            /** Replays the current frame only if it differs from the previous one. Only
+                suitable for backends that retain their content between frames.
+             */
+            void flush()
+            {
+                if (changed) replay();
+            }
+
+        private:
+
+            enum class opcode: uint8_t { clear, fill_rect, draw_image, render_text, set_clipping_rect, cancel_clipping };
+
+            using grid = coord_traits<coord_t>;
+
+            struct pixel_bounds { int x1, y1, x2, y2; };
+
+            struct image_args {
+                image_handle    handle;
+                coord_t         offset_x, offset_y;
+            };
+
+            struct text_args {
+                font_handle     font;
+                native_color    color;
+                bool            color_set;      // false: the backend's text color is left as is
+                uint32_t        first, count;   // range in the text buffer
+            };
+
+            struct command {
+
+                opcode          op;
+                coord_t         x, y;
+                length_t        w, h;
+                union {
+                    native_color    color;
+                    image_args      image;
+                    text_args       text;
+                };
+
+                explicit command(opcode op_ = opcode::cancel_clipping, coord_t x_ = 0, coord_t y_ = 0, length_t w_ = 0, length_t h_ = 0):
+                    op(op_), x(x_), y(y_), w(w_), h(h_), color() {}
+
+                bool same_geometry(const command &other) const
+                {
+                    return x == other.x && y == other.y && w == other.w && h == other.h;
+                }
+
+                /** True if the command has the same state as the other one, i.e. if the
+                    two could be executed in a row without state change.
+                 */
+                bool same_state(const command &other) const
+                {
+                    if (op != other.op) return false;
+                    switch (op) {
+                    case opcode::fill_rect:     return same_color(color, other.color);
+                    case opcode::draw_image:    return same_bits(image.handle, other.image.handle);
+                    case opcode::render_text:   return same_bits(text.font, other.text.font) && same_color(text.color, other.text.color)
+                                                    && text.color_set == other.text.color_set;
+                    default:                    return false;
+                    }
+                }
+
+                static bool equal(const command &a, const command &b)
+                {
+                    if (a.op != b.op || !a.same_geometry(b)) return false;
+                    switch (a.op) {
+                    case opcode::clear:
+                    case opcode::fill_rect:     return same_color(a.color, b.color);
+                    case opcode::draw_image:    return same_bits(a.image.handle, b.image.handle)
+                                                    && a.image.offset_x == b.image.offset_x && a.image.offset_y == b.image.offset_y;
+                    case opcode::render_text:   return same_bits(a.text.font, b.text.font) && same_color(a.text.color, b.text.color)
+                                                    && a.text.color_set == b.text.color_set && a.text.first == b.text.first && a.text.count == b.text.count;
+                    default:                    return true;
+                    }
+                }
+
+                /** Whether the area affected by the command is known and does not overlap
+                    that of the other command, in whole pixels (fractional edges may be
+                    antialiased). Text extents are not known at this level.
+                 */
+                bool disjoint(const command &other) const
+                {
+                    if (op == opcode::render_text || other.op == opcode::render_text) return false;
+                    auto a = pixels(), b = other.pixels();
+                    return a.x1 >= b.x2 || b.x1 >= a.x2 || a.y1 >= b.y2 || b.y1 >= a.y2;
+                }
+
+                // The pixels touched, rounded outwards
+                auto pixels() const -> pixel_bounds
+                {
+                    auto rx = grid::raw(x), ry = grid::raw(y);
+                    return { grid::floor(rx), grid::floor(ry), grid::ceil(rx + grid::raw(w)), grid::ceil(ry + grid::raw(h)) };
+                }
+            };
+
+            template <typename T>
+            static bool same_bits(const T &a, const T &b) { return std::memcmp(&a, &b, sizeof(T)) == 0; }
+
+            static bool same_color(const native_color &a, const native_color &b) { return same_bits(a, b); }
+
+            void set_clip(const command &cmd)
+            {
+                if (command::equal(cmd, clip)) return;
+
+                // A clipping change that was not followed by any draw is superseded
+                if (commands.size() == segment_start && !commands.empty() && is_clip_command(commands.back())) {
+                    commands.pop_back();
+                    clip = prev_clip;
+                    if (command::equal(cmd, clip)) return;
+                }
+
+                prev_clip = clip;
+                clip = cmd;
+                commands.push_back(cmd);
+                segment_start = commands.size();
+            }
+
+            struct bounds { coord_t x1, y1, x2, y2; };
+
+            // The clipping rectangle in effect, in the coordinates of the caller (either axis direction)
+            auto clip_bounds() const -> bounds
+            {
+                bounds surface = { 0, 0, coord_t(backend->width()), coord_t(backend->height()) };
+                if (clip.op != opcode::set_clipping_rect) return surface;
+
+                return { std::max(clip.x, surface.x1), std::max(clip.y, surface.y1),
+                    std::min(coord_t(clip.x + coord_t(clip.w)), surface.x2), std::min(coord_t(clip.y + coord_t(clip.h)), surface.y2) };
+            }
+
+            static bool is_clip_command(const command &cmd)
+            {
+                return cmd.op == opcode::set_clipping_rect || cmd.op == opcode::cancel_clipping;
+            }
+
+            void add_draw_command(const command &cmd)
+            {
+                if ((cmd.w == 0 || cmd.h == 0) && cmd.op != opcode::render_text) return;
+
+                // Look back (within the current clipping segment) for a command with the same state
+                std::size_t lookback_end = std::max(segment_start, commands.size() > MAX_LOOKBACK ? commands.size() - MAX_LOOKBACK : 0);
+                std::size_t pos = commands.size();
+                while (pos > lookback_end) {
+                    const auto &prev = commands[pos - 1];
+                    if (prev.same_state(cmd)) break;
+                    if (!prev.disjoint(cmd)) { pos = commands.size(); break; }
+                    pos--;
+                }
+                if (pos == lookback_end) pos = commands.size();
+
+                if (pos > segment_start && try_merge(commands[pos - 1], cmd)) return;
+
+                commands.insert(commands.begin() + std::ptrdiff_t(pos), cmd);
+            }
+
+            /** Merges two fill_rect commands of the same color into one if together they
+                form a rectangle (and meet on a pixel boundary, as antialiasing would
+                blend a shared edge pixel twice).
+             */
+            static bool try_merge(command &prev, const command &cmd)
+            {
+                if (cmd.op != opcode::fill_rect || !prev.same_state(cmd)) return false;
+
+                if (prev.y == cmd.y && prev.h == cmd.h && prev.x + coord_t(prev.w) == cmd.x && grid::aligned(grid::raw(cmd.x))) {
+                    prev.w += cmd.w;
+                    return true;
+                }
+                if (prev.x == cmd.x && prev.w == cmd.w && prev.y + coord_t(prev.h) == cmd.y && grid::aligned(grid::raw(cmd.y))) {
+                    prev.h += cmd.h;
+                    return true;
+                }
+                return false;
+            }
+
+            Renderer               *backend;
+            std::vector<command>    commands, prev_commands;
+            std::vector<char32_t>   text, prev_text;
+            std::size_t             segment_start;      // index of the first command after the last clipping change
+            command                 clip;               // clipping command currently in effect
+            command                 prev_clip;          // clipping in effect before that
+            std::vector<command>    clip_stack;         // see push_clip()
+            native_color            text_color;
+            bool                    text_color_set;
+            bool                    changed;
+        };
+
+    } // ns gui
+
+} // ns gpc
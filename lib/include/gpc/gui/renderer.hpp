@@ -2,6 +2,9 @@
 
 #include <array>
 
+#include "color.hpp"
+#include "fixed_point.hpp"
+
 namespace gpc {
 
     namespace gui {
@@ -9,74 +12,9 @@ namespace gpc {
         enum class horizontal_direction { right, left };
         enum class vertical_direction { down, up };
 
-        // TODO: the color stuff should probably go into a separate header file
-
-        /** Normalized RGBA (red, green, blue, alpha) color.
-         */
-        struct rgba_norm {
-
-            // Predefined colors
-            static constexpr const rgba_norm black() { return { 0, 0, 0, 1 }; }
-            static constexpr const rgba_norm white() { return { 1, 1, 1, 1 }; }
-
-            // Constructors
-            constexpr rgba_norm(): rgba_norm { 0, 0, 0, 1 } {}
-            constexpr rgba_norm(float r, float g, float b, float a = 1): components { r, g, b, a } {}
-
-            // Accessors
-            constexpr float r() const { return components[0]; }
-            constexpr float g() const { return components[1]; }
-            constexpr float b() const { return components[2]; }
-            constexpr float a() const { return components[3]; }
-            float& r() { return components[0]; }
-            float& g() { return components[1];  }
-            float& b() { return components[2]; }
-            float& a() { return components[3]; }
-            // Not really an accessor, but allows usage in calls to OpenGL
-            constexpr operator const float * () const { return &components[0]; }
-
-            // Operations
-            auto operator /= (float dsor) -> rgba_norm & {
-                components[0] /= dsor, components[1] /= dsor, components[2] /= dsor, components[3] /= dsor;
-                return *this;
-            }
-
-            // Data
-            std::array<float, 4> components;
-        };
-
-        inline auto 
-        operator + (const rgba_norm &color1, const rgba_norm &color2) -> rgba_norm 
-        {
-            return { color1.r() + color2.r(), color1.g() + color2.g(), color1.b() + color2.b(), color1.a() + color2.a() };
-        }
-
-        inline auto
-        interpolate(const rgba_norm &color1, const rgba_norm &color2, float a) -> rgba_norm 
-        {
-            rgba_norm result;
-            result.r() = color1.r() + a * (color2.r() - color1.r());
-            result.g() = color1.g() + a * (color2.g() - color1.g());
-            result.b() = color1.b() + a * (color2.b() - color1.b());
-            result.a() = color1.a() + a * (color2.a() - color1.a());
-            return result;
-        }
-
-        struct rgba32 {
-            uint8_t components[4];
-        };
-
-        inline constexpr auto 
-        from_float(const rgba_norm &from) -> rgba32
-        {
-            return { { uint8_t(from.r() * 255), uint8_t(from.g() * 255), uint8_t(from.b() * 255), uint8_t(from.a() * 255) } };
-        }
-
-        /* Normalized mono (greyscale) value.
+        /** Where a rectangle lies relative to the clipping rectangle.
          */
-        using mono_norm = float;
-        
-        using mono8 = uint8_t;
+        enum class clip_result { outside, partial, inside };
 
         // TODO: use Boost concept checking to define something usable here
 
@@ -97,7 +35,7 @@ namespace gpc {
             static const vertical_direction     vertical_axis_dir;
             
             using coord_t = CoordType;
-            using length_t = std::make_unsigned<coord_t>;
+            using length_t = typename coord_traits<coord_t>::length_t;
             
             struct point {
                 coord_t x, y;
@@ -118,10 +56,73 @@ namespace gpc {
                 static constexpr from_normalized_rgba(const float *rgba_norm);
             };
 
+            /** Opaque handles of registered images and fonts. Once an image or font
+                has been unregistered, its handle is stale: drawing with it must do
+                nothing.
+             */
+            using image_handle = /* implementation-defined */;
+            using font_handle  = /* implementation-defined */;
+
             /** This method must clear the whole canvas, i.e. set it to the specified
                 background (clear) color.
              */
             void clear();
+
+            /** Copies an image into the renderer, which owns it from then on. Empty
+                images are rejected with std::invalid_argument.
+             */
+            auto register_rgba32_image(length_t width, length_t height, const rgba32 *pixels) -> image_handle;
+
+            /** Releases an image registered with register_rgba32_image(). The handle
+                must not be used afterwards (but unregistering it again is harmless).
+             */
+            void unregister_image(image_handle image);
+
+            auto register_font(const gpc::fonts::rasterized_font &font) -> font_handle;
+
+            /** Releases a font registered with register_font(), with everything the
+                renderer keeps for it (glyph atlas, cached text). Same rules as for
+                unregister_image().
+             */
+            void unregister_font(font_handle font);
+
+            void set_text_color(const native_color &color);
+
+            /** Renders a line of text, (x, y) being the starting point on the baseline.
+                Codepoints that the font does not contain are skipped.
+             */
+            void render_text(font_handle font, coord_t x, coord_t y, const char32_t *text, std::size_t count);
+
+            /** Same as render_text(), for UTF-8 encoded text (length in bytes). Ill-formed
+                sequences must not be read past the end of the text; they are rendered
+                as U+FFFD, if the font has that glyph.
+             */
+            void render_text_utf8(font_handle font, coord_t x, coord_t y, const char *text, std::size_t length);
+
+            /** Bulk drawing (optional, see bulk_draw.hpp): fills count rectangles, or
+                draws count images, with the same result as as many fill_rect() or
+                draw_image() calls in record order, fractional coordinates and stale
+                image handles included. Renderers that do not implement them are used
+                through the gpc::gui::fill_rects() / draw_images() fallbacks.
+             */
+            void fill_rects(const fill_record_t<Renderer> *records, std::size_t count);
+            void draw_images(const image_record_t<Renderer> *records, std::size_t count);
+
+            /** Nested clipping: push_clip() restricts drawing to the intersection of
+                the clipping rectangle in effect and the specified one, the matching
+                pop_clip() restores the previous one (pops must not outnumber pushes).
+                set_clipping_rect() and cancel_clipping() replace the rectangle at the
+                current level only. clip_depth() is the number of unmatched pushes.
+             */
+            void push_clip(coord_t x, coord_t y, length_t w, length_t h);
+            void pop_clip();
+            auto clip_depth() const -> std::size_t;
+
+            /** Where a rectangle lies relative to the clipping rectangle in effect
+                (which includes the bounds of the surface), in constant time, so that
+                callers can skip what would be clipped away entirely.
+             */
+            auto clip_test(coord_t x, coord_t y, length_t w, length_t h) const -> clip_result;
         };
 
         #endif
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "cpu_features.hpp"
+
+namespace gpc {
+
+    namespace gui {
+
+        static const char32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+        namespace detail {
+
+            /** Decodes the (non-ASCII) UTF-8 sequence starting at p into cp and returns
+                the position after it. Ill-formed input yields U+FFFD for each maximal
+                subpart of an ill-formed sequence (as recommended by the Unicode
+                standard, and as done by the WHATWG encoding standard), which excludes
+                overlong forms, surrogates and codepoints beyond U+10FFFF.
+             */
+            inline auto utf8_decode_sequence(const uint8_t *p, const uint8_t *end, char32_t &cp) -> const uint8_t *
+            {
+                unsigned lead = *p++;
+                unsigned need, lo = 0x80, hi = 0xBF;
+                char32_t value;
+
+                if      (lead >= 0xC2 && lead <= 0xDF) { need = 1; value = lead & 0x1F; }
+                else if (lead >= 0xE0 && lead <= 0xEF) { need = 2; value = lead & 0x0F; if (lead == 0xE0) lo = 0xA0; else if (lead == 0xED) hi = 0x9F; }
+                else if (lead >= 0xF0 && lead <= 0xF4) { need = 3; value = lead & 0x07; if (lead == 0xF0) lo = 0x90; else if (lead == 0xF4) hi = 0x8F; }
+                else { cp = REPLACEMENT_CHARACTER; return p; }
+
+                for (; need > 0; need--, p++, lo = 0x80, hi = 0xBF) {
+                    if (p == end || *p < lo || *p > hi) { cp = REPLACEMENT_CHARACTER; return p; }
+                    value = (value << 6) | (*p & 0x3F);
+                }
+
+                cp = value;
+                return p;
+            }
+
+            // ASCII fast paths: if the 16 bytes at src are all ASCII, widen them to dst and return true
+
+            inline auto utf8_ascii16_scalar(const uint8_t *src, char32_t *dst) -> bool
+            {
+                uint64_t w[2];
+                std::memcpy(w, src, 16);
+                if (((w[0] | w[1]) & 0x8080808080808080ULL) != 0) return false;
+
+                for (int i = 0; i < 16; i++) dst[i] = src[i];
+                return true;
+            }
+
+            #if defined(GPC_GUI_X86)
+
+            GPC_GUI_TARGET("sse2") inline auto utf8_ascii16_sse2(const uint8_t *src, char32_t *dst) -> bool
+            {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                if (_mm_movemask_epi8(v) != 0) return false;
+
+                auto zero = _mm_setzero_si128();
+                auto lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+                auto out = reinterpret_cast<__m128i*>(dst);
+                _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+                return true;
+            }
+
+            #endif // GPC_GUI_X86
+
+            #if defined(GPC_GUI_NEON)
+
+            inline auto utf8_ascii16_neon(const uint8_t *src, char32_t *dst) -> bool
+            {
+                auto v = vld1q_u8(src);
+                if (vmaxvq_u8(v) >= 0x80) return false;
+
+                auto lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+                auto out = reinterpret_cast<uint32_t*>(dst);
+                vst1q_u32(out +  0, vmovl_u16(vget_low_u16 (lo)));
+                vst1q_u32(out +  4, vmovl_u16(vget_high_u16(lo)));
+                vst1q_u32(out +  8, vmovl_u16(vget_low_u16 (hi)));
+                vst1q_u32(out + 12, vmovl_u16(vget_high_u16(hi)));
+                return true;
+            }
+
+            #endif // GPC_GUI_NEON
+
+            template <bool (*Ascii16)(const uint8_t *, char32_t *)>
+            inline auto utf8_to_ucs4(const uint8_t *p, const uint8_t *end, char32_t *dst) -> std::size_t
+            {
+                auto start = dst;
+
+                while (p < end) {
+                    if (*p < 0x80) {
+                        while (end - p >= 16 && Ascii16(p, dst)) p += 16, dst += 16;
+                        while (p < end && *p < 0x80) *dst++ = *p++;
+                    }
+                    else {
+                        p = utf8_decode_sequence(p, end, *dst++);
+                    }
+                }
+
+                return std::size_t(dst - start);
+            }
+
+        } // ns detail
+
+        /** Decodes UTF-8 text into UCS-4 (UTF-32) codepoints and returns the number of
+            codepoints written. dst must have room for length codepoints (the worst case).
+
+            The input is validated: every maximal ill-formed subsequence is replaced by
+            U+FFFD, so that the output never contains surrogates or values beyond
+            U+10FFFF. Runs of ASCII are converted 16 bytes at a time.
+         */
+        inline auto
+        utf8_to_ucs4(const char *src, std::size_t length, char32_t *dst) -> std::size_t
+        {
+            auto p = reinterpret_cast<const uint8_t*>(src);
+
+            #if defined(GPC_GUI_X86)
+            if (host_cpu_features().sse2) return detail::utf8_to_ucs4<detail::utf8_ascii16_sse2>(p, p + length, dst);
+            #elif defined(GPC_GUI_NEON)
+            return detail::utf8_to_ucs4<detail::utf8_ascii16_neon>(p, p + length, dst);
+            #endif
+            return detail::utf8_to_ucs4<detail::utf8_ascii16_scalar>(p, p + length, dst);
+        }
+
+        /** Same as above, decoding into a caller-provided vector, which is resized to
+            the number of codepoints. Its capacity is reused, so that repeated calls do
+            not allocate once it has grown large enough.
+         */
+        inline void
+        utf8_to_ucs4(const char *src, std::size_t length, std::vector<char32_t> &dst)
+        {
+            dst.resize(length);
+            dst.resize(length > 0 ? utf8_to_ucs4(src, length, &dst[0]) : 0);
+        }
+
+        /** Returns the number of codepoints utf8_to_ucs4() decodes the text into,
+            counting U+FFFD for each ill-formed subsequence, without storing them.
+         */
+        inline auto
+        utf8_length(const char *src, std::size_t length) -> std::size_t
+        {
+            auto p = reinterpret_cast<const uint8_t*>(src), end = p + length;
+            std::size_t count = 0;
+            char32_t cp;
+
+            while (p < end) {
+                p = *p < 0x80 ? p + 1 : detail::utf8_decode_sequence(p, end, cp);
+                count++;
+            }
+
+            return count;
+        }
+
+        /** Decodes into a thread-local buffer that remains valid until the next call
+            from the same thread. count receives the number of codepoints.
+         */
+        inline auto
+        utf8_to_ucs4(const char *src, std::size_t length, std::size_t &count) -> const char32_t *
+        {
+            static thread_local std::vector<char32_t> buffer;
+
+            utf8_to_ucs4(src, length, buffer);
+            count = buffer.size();
+            return buffer.data();
+        }
+
+    } // ns gui
+
+} // ns gpc
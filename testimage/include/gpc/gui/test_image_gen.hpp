@@ -1,14 +1,18 @@
 #pragma once
 
-#include <codecvt>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 //#include <boost/concept_check.hpp>
-#include <cereal/archives/binary.hpp>
 
-#include <gpc/fonts/rasterized_font.hpp>
-#include <gpc/fonts/cereal.hpp>
-
-#include <gpc/gui/renderer.hpp> // TODO: replace with specific header file for color handling when available
+#include <gpc/gui/color.hpp>
+#include <gpc/gui/native_color.hpp>
+#include <gpc/gui/font_library.hpp>
+#include <gpc/gui/utf8.hpp>
+#include <gpc/gui/bulk_draw.hpp>
+#include <gpc/gui/image_compare.hpp>
 
 namespace gpc {
 
@@ -24,24 +28,30 @@ namespace gpc {
 
             static auto utf8toucs4(const std::string &from) -> std::u32string
             {
-                static std::wstring_convert<std::codecvt_utf8<int32_t>, int32_t> converter;
-
-                std::basic_string<int32_t> temp = converter.from_bytes(from);
+                std::size_t count;
+                auto ucs4 = utf8_to_ucs4(from.data(), from.size(), count);
 
-                auto start = reinterpret_cast<const char32_t*>(&temp[0]);
-                auto end = start + temp.size();
-
-                return std::u32string(start, end);
+                return std::u32string(ucs4, ucs4 + count);
             }
 
 
             TestImageGenerator(): renderer(nullptr) {}
 
+            /** Disposes of the resources registered by init().
+             */
+            void cleanup()
+            {
+                if (!renderer) return;
+
+                renderer->unregister_image(test_image);
+                renderer->unregister_font(font);
+                renderer = nullptr;
+            }
+
             void init(Renderer *canvas_)
             {
                 renderer = canvas_;
 
-                register_colors();
                 register_fonts();
                 register_test_image();
             }
@@ -50,7 +60,9 @@ namespace gpc {
             {
                 std::vector<rgba_norm> img;
 
-                renderer->clear(renderer->rgba_norm_to_native({ 0.8f, 0.8f, 0.8f, 0 }));
+                constexpr auto background = native_color_of<Renderer>({ 0.8f, 0.8f, 0.8f, 0 });
+
+                renderer->clear(background);
 
                 draw_grid();
                 draw_plain_rects();
@@ -60,38 +72,63 @@ namespace gpc {
                 return img;
             }
 
+            /** The font and image registered by init(), e.g. for benchmarks that draw
+                more than the test image.
+             */
+            auto text_font() const -> typename Renderer::font_handle { return font; }
+            auto test_pattern() const -> typename Renderer::image_handle { return test_image; }
+
+            /** Compares what the renderer currently displays (via the screenshot function
+                of the PixelRenderer concept) with a reference screenshot of the test image.
+             */
+            template <typename RGB24Image>
+            auto compare_with_reference(const RGB24Image &reference,
+                const image_compare_options &options = image_compare_options()) -> image_diff
+            {
+                return compare_screenshots(renderer->_getRGB24Screenshot(), reference, WIDTH, HEIGHT, options);
+            }
+
         private:
 
+            /** The test image is laid out top-down; with an upward vertical axis, the
+                vertical positions of rectangles (of height h) and baselines are
+                mirrored, so that the image looks the same either way.
+             */
+            static constexpr auto top_down(int y, int h = 0) -> int
+            {
+                return Renderer::vertical_axis_dir == vertical_direction::down ? y : HEIGHT - y - h;
+            }
+
             static auto
             makeColorInterpolatedRectangle(size_t width, size_t height, const std::array<rgba_norm, 4> &corner_colors) -> std::vector<rgba32>
             {
                 std::vector<rgba32> image(width * height);
+                std::vector<rgba_norm> top(width), bottom(width), row(width);
+
+                // The horizontal interpolations are the same for every row
+                for (auto x = 0U; x < width; x++) {
+                    top   [x] = interpolate(corner_colors[0], corner_colors[1], float(x) / float(width));
+                    bottom[x] = interpolate(corner_colors[2], corner_colors[3], float(x) / float(width));
+                }
 
-                auto it = image.begin();
                 for (auto y = 0U; y < height; y++) {
                     for (auto x = 0U; x < width; x++) {
-                        rgba_norm top    = interpolate(corner_colors[0], corner_colors[1], float(x) / float(width));
-                        rgba_norm bottom = interpolate(corner_colors[2], corner_colors[3], float(x) / float(width));
-                        rgba_norm color  = interpolate(top, bottom, float(y) / float(height));
-                        *it = rgba32 { 
-                            static_cast<uint8_t>(255 * color.r()), 
-                            static_cast<uint8_t>(255 * color.g()), 
-                            static_cast<uint8_t>(255 * color.b()), 
-                            255 };
-                        it++;
+                        row[x] = interpolate(top[x], bottom[x], float(y) / float(height));
+                        row[x].a() = 1;
                     }
+                    from_float(&row[0], width, &image[y * width]);
                 }
 
                 return image;
             }
 
-            void register_colors()
+            // Colors are converted at compile time
+            enum color_index { red, green, blue, white, grey };
+
+            static constexpr auto palette() -> color_palette<Renderer, 5>
             {
-               red   = renderer->rgba_norm_to_native({ 1, 0, 0, 1 });
-               green = renderer->rgba_norm_to_native({ 0, 1, 0, 1 });
-               blue  = renderer->rgba_norm_to_native({ 0, 0, 1, 1 });
-               white = renderer->rgba_norm_to_native({ 1, 1, 1, 1 });
-               grey  = renderer->rgba_norm_to_native({ 0.5f, 0.5f, 0.5f, 1});
+                return make_palette<Renderer>(rgba_norm { 1, 0, 0, 1 }, rgba_norm { 0, 1, 0, 1 }, rgba_norm { 0, 0, 1, 1 },
+                    rgba_norm { 1, 1, 1, 1 }, rgba_norm { 0.5f, 0.5f, 0.5f, 1 });
             }
 
             void register_fonts()
@@ -100,15 +137,10 @@ namespace gpc {
                     #include "LiberationSans-Regular-16.rft.h"
                 };
 
-                std::string data_string(sans_reg_16, sans_reg_16 + sizeof(sans_reg_16));
-                std::stringstream sstr(data_string);
-                cereal::BinaryInputArchive ar(sstr);
-                gpc::fonts::rasterized_font rfont;
-                ar >> rfont;
-
-                font = renderer->register_font(rfont);
-
-                // TODO: dispose of fonts
+                // Rasterized fonts work with every backend (packed fonts are specific to
+                // the CPU renderer); shared with other generators (and anything else
+                // using the same font)
+                font = renderer->register_font(font_library::instance().load(sans_reg_16, sizeof(sans_reg_16)));
             }
 
             void register_test_image()
@@ -121,67 +153,79 @@ namespace gpc {
             {
                 static const int LINE_WIDTH = 1;
 
-                Renderer::native_color before = renderer->rgba_norm_to_native({0, 0, 0, 1});
-                Renderer::native_color after  = renderer->rgba_norm_to_native({1, 1, 1, 1});
+                constexpr auto before = native_color_of<Renderer>({0, 0, 0, 1});
+                constexpr auto after  = native_color_of<Renderer>({1, 1, 1, 1});
 
-                // Vertical axis
+                // The lines go in one bulk call
+                fill_record_t<Renderer> lines[2 * (HEIGHT / 50 + 1) + 2 * (WIDTH / 50 + 1)];
+                std::size_t count = 0;
                 for (int y = 0; y <= HEIGHT; y += 50) {
-                    renderer->fill_rect(0, y - LINE_WIDTH, WIDTH, LINE_WIDTH, before);
-                    renderer->fill_rect(0, y, WIDTH, LINE_WIDTH, after);
-                    auto label = utf8toucs4(std::to_string(y));
-                    renderer->render_text(font, 4, y - 4, label.c_str(), label.size());
+                    lines[count++] = { 0, top_down(y - LINE_WIDTH, LINE_WIDTH), WIDTH, LINE_WIDTH, before };
+                    lines[count++] = { 0, top_down(y, LINE_WIDTH), WIDTH, LINE_WIDTH, after };
                 }
-                // Horizontal axis
                 for (int x = 0; x <= WIDTH; x += 50) {
-                    renderer->fill_rect(x - LINE_WIDTH, 0, LINE_WIDTH, HEIGHT, before);
-                    renderer->fill_rect(x, 0, LINE_WIDTH, HEIGHT, after);
-                    auto label = utf8toucs4(std::to_string(x));
-                    renderer->render_text(font, x+4, 18, label.c_str(), label.size());
+                    lines[count++] = { x - LINE_WIDTH, 0, LINE_WIDTH, HEIGHT, before };
+                    lines[count++] = { x, 0, LINE_WIDTH, HEIGHT, after };
+                }
+                fill_rects(*renderer, lines, count);
+
+                // The labels must not depend on the text color left over from the previous frame
+                renderer->set_text_color(before);
+
+                char label[16];
+                for (int y = 0; y <= HEIGHT; y += 50) {
+                    auto length = std::snprintf(label, sizeof(label), "%d", y);
+                    renderer->render_text_utf8(font, 4, top_down(y - 4), label, std::size_t(length));
+                }
+                for (int x = 0; x <= WIDTH; x += 50) {
+                    auto length = std::snprintf(label, sizeof(label), "%d", x);
+                    renderer->render_text_utf8(font, x+4, top_down(18), label, std::size_t(length));
                 }
             }
 
             void draw_plain_rects()
             {
-                renderer->fill_rect(50, 50, 50, 50, red);
-                renderer->fill_rect(100, 50, 50, 50, green);
-                renderer->fill_rect(50, 100, 50, 50, blue);
-                renderer->fill_rect(100, 100, 50, 50, white);
+                constexpr auto colors = palette();
+
+                renderer->fill_rect(50, top_down(50, 50), 50, 50, colors[red]);
+                renderer->fill_rect(100, top_down(50, 50), 50, 50, colors[green]);
+                renderer->fill_rect(50, top_down(100, 50), 50, 50, colors[blue]);
+                renderer->fill_rect(100, top_down(100, 50), 50, 50, colors[white]);
             }
 
             void draw_images(int x, int y)
             {
                 static const int SEP = 25;
 
-                renderer->draw_image(x, y, 50, 50, test_image); x += 50;
+                renderer->draw_image(x, top_down(y, 50), 50, 50, test_image); x += 50;
                 x += SEP;
-                renderer->draw_image(x, y, 75, 75, test_image); x += 75;
+                renderer->draw_image(x, top_down(y, 75), 75, 75, test_image); x += 75;
                 x += SEP;
-                renderer->fill_rect(x, y, 50, 50, grey);
-                renderer->set_clipping_rect(x+5, y+5, 40, 40);
-                renderer->draw_image(x, y, 50, 50, test_image); x += 50;
+                renderer->fill_rect(x, top_down(y, 50), 50, 50, palette()[grey]);
+                renderer->set_clipping_rect(x+5, top_down(y+5, 40), 40, 40);
+                renderer->draw_image(x, top_down(y, 50), 50, 50, test_image); x += 50;
                 renderer->cancel_clipping();
                 x += SEP;
-                renderer->draw_image(x, y, 50, 50, test_image, 10, 10); x += 50;
+                renderer->draw_image(x, top_down(y, 50), 50, 50, test_image, 10, 10); x += 50;
                 x += SEP;
-                renderer->draw_image(x, y, 50, 50, test_image, 20, 20); x += 50;
+                renderer->draw_image(x, top_down(y, 50), 50, 50, test_image, 20, 20); x += 50;
             }
 
             void render_text(int x, int y)
             {
                 static const int SEP = 25;
 
-                renderer->set_text_color(renderer->rgba_norm_to_native({0, 0, 0, 1}));
-                renderer->render_text(font, x, y, U"Some black text.", 16); x += 200;
-                renderer->set_text_color(renderer->rgba_norm_to_native({ 0.5f, 0, 0, 1 }));
-                renderer->render_text(font, x, y, U"Now some RED text.", 18); x += 200;
-                renderer->set_text_color(renderer->rgba_norm_to_native({ 0., 0, 0, 0.5f }));
-                renderer->render_text(font, x, y, U"Half-transparent text.", 21); x += 200;
+                renderer->set_text_color(native_color_of<Renderer>({0, 0, 0, 1}));
+                renderer->render_text(font, x, top_down(y), U"Some black text.", 16); x += 200;
+                renderer->set_text_color(native_color_of<Renderer>({ 0.5f, 0, 0, 1 }));
+                renderer->render_text(font, x, top_down(y), U"Now some RED text.", 18); x += 200;
+                renderer->set_text_color(native_color_of<Renderer>({ 0, 0, 0, 0.5f }));
+                renderer->render_text(font, x, top_down(y), U"Half-transparent text.", 21); x += 200;
             }
 
             Renderer *renderer;
             typename Renderer::font_handle font;
             typename Renderer::image_handle test_image;
-            typename Renderer::native_color red, green, blue, white, grey;
         };
 
     } // ns gui
@@ -11,6 +11,8 @@
 #include <gpc/fonts/RasterizedFont.hpp>
 #include <gpc/fonts/cereal.hpp>
 
+#include <gpc/gui/memory_istream.hpp>
+
 #include "fonts.hpp"
 
 namespace gpc {
@@ -148,7 +150,7 @@ namespace gpc {
 
                 void cleanup_display(display_t display, canvas_t *canvas) override
                 {
-                    // TODO: dispose of ("unregister") image
+                    canvas->unregister_image(image_handle);
                 }
 
                 virtual void draw_content(display_t display, canvas_t *canvas) override
@@ -218,8 +220,7 @@ namespace gpc {
                         #include "LiberationSans-Regular-20.rft.h"
                     };
 
-                    std::string data_string(liberations_sans_data, liberations_sans_data + sizeof(liberations_sans_data));
-                    std::stringstream sstr(data_string);
+                    memory_istream sstr(liberations_sans_data, sizeof(liberations_sans_data));
                     cereal::BinaryInputArchive ar(sstr);
 
                     ar >> rfont;
@@ -229,7 +230,7 @@ namespace gpc {
 
                 void cleanup_display(display_t display, canvas_t *canvas) override
                 {
-                    // TODO: dispose of ("unregister") font
+                    canvas->unregister_font(font);
                 }
 
                 virtual void draw_content(display_t display, canvas_t *canvas) override
@@ -0,0 +1,119 @@
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/bulk_draw.hpp>
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/fixed_point.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 120, HEIGHT = 80;
+
+    // Small deterministic generator, so that failures can be reproduced
+    struct lcg {
+        uint32_t state;
+        auto next(uint32_t n) -> int { state = state * 1664525u + 1013904223u; return int((state >> 8) % n); }
+    };
+
+    // Positions and sizes in quarter pixels, partly outside of the surface; the
+    // renderers with integer coordinates truncate them
+    template <class Renderer>
+    auto coord(lcg &g, int min, int max) -> typename Renderer::coord_t
+    {
+        using C = typename Renderer::coord_t;
+        return C((min * 4 + g.next(uint32_t(max - min) * 4)) / 4.0);
+    }
+
+    template <class Renderer>
+    auto make_fills(std::size_t count) -> std::vector<fill_record_t<Renderer>>
+    {
+        const rgba_norm colors[] = { { 1, 0, 0, 1 }, { 0, 0.5f, 1, 0.5f }, { 0.2f, 0.9f, 0.1f, 0 }, { 0.7f, 0.7f, 0.2f, 0.01f }, { 0, 0, 0, 0.99f } };
+
+        lcg g = { 1 };
+        std::vector<fill_record_t<Renderer>> records;
+        for (std::size_t i = 0; i < count; i++) {
+            auto color = Renderer::rgba_norm_to_native(colors[i / 3 % 5]);   // runs of the same color
+            records.push_back({ coord<Renderer>(g, -20, WIDTH), coord<Renderer>(g, -20, HEIGHT), coord<Renderer>(g, 0, 40), coord<Renderer>(g, 0, 30), color });
+        }
+        return records;
+    }
+
+    template <class Renderer>
+    auto make_blits(std::size_t count, const std::vector<typename Renderer::image_handle> &images) -> std::vector<image_record_t<Renderer>>
+    {
+        using C = typename Renderer::coord_t;
+
+        lcg g = { 2 };
+        std::vector<image_record_t<Renderer>> records;
+        for (std::size_t i = 0; i < count; i++) {
+            auto image = images[(i / 2 + i % 3) % images.size()];              // runs of the same image, stale ones included
+            records.push_back({ coord<Renderer>(g, -20, WIDTH), coord<Renderer>(g, -20, HEIGHT), coord<Renderer>(g, 0, 40), coord<Renderer>(g, 0, 30),
+                image, C(g.next(9)), C(g.next(7)) });
+        }
+        return records;
+    }
+
+    // Draws the records either in bulk or one by one, once unclipped and once through
+    // nested clips
+    template <class Renderer>
+    void draw(Renderer &r, bool bulk)
+    {
+        using C = typename Renderer::coord_t;
+
+        auto resources = register_test_resources(r);
+        std::vector<rgba32> pixels(9 * 6);
+        for (std::size_t i = 0; i < pixels.size(); i++) pixels[i] = rgba32{ { uint8_t(i * 40), 200, uint8_t(i * 3), i % 4 == 0 ? uint8_t(255) : uint8_t(i * 5) } };
+        auto sheet = r.register_rgba32_image(9, 6, pixels.data());
+        auto stale = r.register_rgba32_image(9, 6, pixels.data());
+        r.unregister_image(stale);
+
+        auto fills = make_fills<Renderer>(60);
+        auto blits = make_blits<Renderer>(60, { resources.image, stale, sheet });
+
+        r.clear(r.rgb_to_native({ 0.9f, 0.9f, 0.8f }));
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) { r.push_clip(C(10.5), C(5.25), C(90), C(60)); r.push_clip(C(0), C(20.75), C(70.5), C(100)); }
+
+            if (bulk) fill_rects(r, fills.data(), fills.size());
+            else for (const auto &f: fills) r.fill_rect(f.x, f.y, f.w, f.h, f.color);
+
+            if (bulk) draw_images(r, blits.data(), blits.size());
+            else for (const auto &b: blits) r.draw_image(b.x, b.y, b.w, b.h, b.image, b.offset_x, b.offset_y);
+
+            if (pass == 1) { r.pop_clip(); r.pop_clip(); }
+        }
+    }
+
+    template <class Renderer>
+    void check_bulk_matches_per_record()
+    {
+        Renderer bulk(WIDTH, HEIGHT), single(WIDTH, HEIGHT);
+        draw(bulk, true);
+        draw(single, false);
+        BOOST_CHECK(same_pixels(bulk, single));
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( BulkDraw )
+
+BOOST_AUTO_TEST_CASE( integer_coordinates )
+{
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::down>>();
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::up>>();
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::down, int, alpha_mode::premultiplied>>();
+}
+
+BOOST_AUTO_TEST_CASE( fixed_point_coordinates )
+{
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::down, fixed_24_8>>();
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::up, fixed_24_8>>();
+    check_bulk_matches_per_record<cpu::Renderer<vertical_direction::up, fixed_24_8, alpha_mode::premultiplied>>();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/tiled_renderer.hpp>
+#include <gpc/gui/recording_renderer.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 160, HEIGHT = 90;
+
+    const rgba32 RED = { { 255, 0, 0, 255 } }, WHITE = { { 255, 255, 255, 255 } };
+
+    // Draws the same picture either with nested clips, or with the equivalent
+    // clipping rectangles set directly
+    template <class Renderer>
+    void draw_scene(Renderer &r, bool nested)
+    {
+        auto resources = register_test_resources(r);
+
+        r.clear(r.rgb_to_native({ 0.8f, 0.7f, 0.6f }));
+        r.set_text_color(r.rgb_to_native({ 0, 0, 0 }));
+        if (nested) { r.push_clip(10, 10, 100, 60); r.push_clip(50, 0, 200, 40); }
+        else r.set_clipping_rect(50, 10, 60, 30);
+        r.fill_rect(0, 0, 160, 90, r.rgba_norm_to_native({ 1, 0, 0, 0.5f }));
+        r.draw_image(30, 20, 100, 50, resources.image, 1, 2);
+        r.render_text(resources.font, 40, 35, U"ABCDEFGH", 8);       // partly clipped
+        r.render_text(resources.font, 60, 30, U"AB", 2);             // inside
+        r.render_text(resources.font, 0, 80, U"AB", 2);              // outside
+        if (nested) r.pop_clip();
+        else r.set_clipping_rect(10, 10, 100, 60);
+        r.fill_rect(0, 0, 30, 30, r.rgb_to_native({ 0, 0, 1 }));
+        if (nested) r.pop_clip();
+        else r.cancel_clipping();
+        r.fill_rect(140, 80, 30, 30, r.rgb_to_native({ 0, 1, 0 }));
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( ClipStack )
+
+BOOST_AUTO_TEST_CASE( nested_clips_intersect )
+{
+    cpu::Renderer<> r(WIDTH, HEIGHT);
+    r.clear(WHITE);
+    r.push_clip(10, 10, 50, 50);
+    r.push_clip(40, 0, 100, 30);        // leaves 40..60 x 10..30
+    BOOST_CHECK_EQUAL(r.clip_depth(), 2u);
+    r.fill_rect(0, 0, WIDTH, HEIGHT, RED);
+
+    auto at = [&](int x, int y) { return r.pixels()[y * WIDTH + x].components[1]; };
+    BOOST_CHECK_EQUAL(at(40, 10), 0);
+    BOOST_CHECK_EQUAL(at(59, 29), 0);
+    BOOST_CHECK_EQUAL(at(39, 20), 255);
+    BOOST_CHECK_EQUAL(at(60, 20), 255);
+    BOOST_CHECK_EQUAL(at(50, 30), 255);
+
+    // Popping restores the outer clip, then no clipping at all
+    r.pop_clip();
+    r.fill_rect(0, 0, WIDTH, HEIGHT, RED);
+    BOOST_CHECK_EQUAL(at(15, 55), 0);
+    BOOST_CHECK_EQUAL(at(65, 55), 255);
+    r.pop_clip();
+    BOOST_CHECK_EQUAL(r.clip_depth(), 0u);
+    r.fill_rect(0, 0, WIDTH, HEIGHT, RED);
+    BOOST_CHECK_EQUAL(at(150, 80), 0);
+}
+
+BOOST_AUTO_TEST_CASE( disjoint_clips_draw_nothing )
+{
+    cpu::Renderer<> r(WIDTH, HEIGHT);
+    r.clear(WHITE);
+    r.push_clip(0, 0, 20, 20);
+    r.push_clip(50, 50, 20, 20);
+    r.fill_rect(0, 0, WIDTH, HEIGHT, RED);
+    r.pop_clip(), r.pop_clip();
+
+    bool untouched = true;
+    for (int i = 0; i < WIDTH * HEIGHT; i++) untouched = untouched && r.pixels()[i].components[1] == 255;
+    BOOST_CHECK(untouched);
+}
+
+BOOST_AUTO_TEST_CASE( clip_test )
+{
+    cpu::Renderer<> r(WIDTH, HEIGHT);
+    BOOST_CHECK(r.clip_test(0, 0, WIDTH, HEIGHT) == clip_result::inside);
+    BOOST_CHECK(r.clip_test(-5, 0, 10, 10) == clip_result::partial);
+
+    r.push_clip(10, 10, 100, 60);
+    BOOST_CHECK(r.clip_test(20, 20, 5, 5) == clip_result::inside);
+    BOOST_CHECK(r.clip_test(10, 10, 100, 60) == clip_result::inside);
+    BOOST_CHECK(r.clip_test(0, 0, 20, 20) == clip_result::partial);
+    BOOST_CHECK(r.clip_test(110, 10, 5, 5) == clip_result::outside);
+    BOOST_CHECK(r.clip_test(200, 0, 5, 5) == clip_result::outside);
+    BOOST_CHECK(r.clip_test(20, 20, 0, 5) == clip_result::outside);     // empty
+    r.pop_clip();
+}
+
+BOOST_AUTO_TEST_CASE( same_result_as_clipping_rectangles )
+{
+    cpu::Renderer<> direct(WIDTH, HEIGHT), nested(WIDTH, HEIGHT);
+    draw_scene(direct, false);
+    draw_scene(nested, true);
+    BOOST_CHECK(same_pixels(direct, nested));
+
+    cpu::Renderer<vertical_direction::up> direct_up(WIDTH, HEIGHT), nested_up(WIDTH, HEIGHT);
+    draw_scene(direct_up, false);
+    draw_scene(nested_up, true);
+    BOOST_CHECK(same_pixels(direct_up, nested_up));
+}
+
+BOOST_AUTO_TEST_CASE( wrappers_forward_the_stack )
+{
+    using backend_t = cpu::Renderer<>;
+
+    backend_t reference(WIDTH, HEIGHT);
+    draw_scene(reference, true);
+
+    backend_t tiled_target(WIDTH, HEIGHT);
+    cpu::TiledRenderer<backend_t> tiled(&tiled_target, 2, 16);
+    draw_scene(tiled, true);
+    tiled.flush();
+    BOOST_CHECK(same_pixels(reference, tiled_target));
+
+    backend_t recorded_target(WIDTH, HEIGHT);
+    RecordingRenderer<backend_t> recorder(&recorded_target);
+    recorder.begin_frame();
+    draw_scene(recorder, true);
+    recorder.end_frame();
+    recorder.replay();
+    BOOST_CHECK(same_pixels(reference, recorded_target));
+
+    tiled.push_clip(10, 10, 100, 60);
+    recorder.push_clip(10, 10, 100, 60);
+    BOOST_CHECK(tiled.clip_test(0, 0, 20, 20) == clip_result::partial);
+    BOOST_CHECK(recorder.clip_test(20, 20, 5, 5) == clip_result::inside);
+    BOOST_CHECK_EQUAL(tiled.clip_depth(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
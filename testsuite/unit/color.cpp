@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/color.hpp>
+
+using namespace gpc::gui;
+
+namespace {
+
+    // Components of every kind: out of range, special, around each rounding decision
+    // point of unorm8_from_float(), and random
+    auto make_components() -> std::vector<float>
+    {
+        std::vector<float> values = { -1, -0.f, 0, 1, 2, 0.5f, 0.7f,
+            std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::denorm_min(), 1 - std::numeric_limits<float>::epsilon() / 2 };
+
+        for (int code = 0; code < 255; code++) {
+            auto v = float((code + 0.5) / 255);
+            for (int i = 0; i < 8; i++) {
+                values.push_back(v);
+                values.push_back(std::nextafter(v, 2.f));
+                v = std::nextafter(v, -1.f);
+            }
+        }
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> dist(-0.1f, 1.1f);
+        for (int i = 0; i < 10000; i++) values.push_back(dist(rng));
+
+        return values;
+    }
+
+    // Spreads the components over the channels, in lengths that exercise the vector
+    // loops and their scalar tails
+    auto make_colors(std::size_t count) -> std::vector<rgba_norm>
+    {
+        auto values = make_components();
+        std::vector<rgba_norm> colors(count);
+        for (std::size_t i = 0; i < count; i++) {
+            colors[i] = { values[i % values.size()], values[(i * 7 + 1) % values.size()], values[(i * 13 + 2) % values.size()], values[(i * 3 + 3) % values.size()] };
+        }
+        return colors;
+    }
+
+    bool same(const std::vector<rgba32> &a, const std::vector<rgba32> &b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(rgba32)) == 0);
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( ColorConversion )
+
+BOOST_AUTO_TEST_CASE( rounding )
+{
+    BOOST_CHECK_EQUAL(unorm8_from_float(0), 0);
+    BOOST_CHECK_EQUAL(unorm8_from_float(1), 255);
+    BOOST_CHECK_EQUAL(unorm8_from_float(-0.5f), 0);
+    BOOST_CHECK_EQUAL(unorm8_from_float(1.5f), 255);
+    BOOST_CHECK_EQUAL(unorm8_from_float(std::numeric_limits<float>::quiet_NaN()), 0);
+    BOOST_CHECK_EQUAL(unorm8_from_float(0.5f), 128);       // 127.5: halfway cases round up
+    BOOST_CHECK_EQUAL(unorm8_from_float(float(1.5 / 255)), 2);
+    BOOST_CHECK_EQUAL(unorm8_from_float(std::nextafter(float(1.5 / 255), 0.f)), 1);
+
+    for (int code = 0; code < 256; code++) BOOST_CHECK_EQUAL(unorm8_from_float(unorm8_to_float(uint8_t(code))), code);
+}
+
+BOOST_AUTO_TEST_CASE( batch_from_float_matches_per_element )
+{
+    for (std::size_t count: { 0u, 1u, 3u, 4u, 5u, 7u, 8u, 15u, 16u, 17u, 20000u }) {
+        auto colors = make_colors(count);
+
+        std::vector<rgba32> batch(count), single(count);
+        from_float(colors.data(), count, batch.data());
+        for (std::size_t i = 0; i < count; i++) single[i] = from_float(colors[i]);
+
+        BOOST_CHECK_MESSAGE(same(batch, single), "from_float() batch differs for " << count << " colors");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( batch_from_float_srgb_matches_per_element )
+{
+    for (std::size_t count: { 0u, 1u, 3u, 4u, 5u, 7u, 8u, 15u, 16u, 17u, 20000u }) {
+        auto colors = make_colors(count);
+
+        // A single color always takes the scalar path
+        std::vector<rgba32> batch(count), single(count);
+        from_float_srgb(colors.data(), count, batch.data());
+        for (std::size_t i = 0; i < count; i++) from_float_srgb(&colors[i], 1, &single[i]);
+
+        BOOST_CHECK_MESSAGE(same(batch, single), "from_float_srgb() batch differs for " << count << " colors");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( srgb_round_trip )
+{
+    std::vector<rgba32> codes(256), back(256);
+    for (int i = 0; i < 256; i++) codes[std::size_t(i)] = rgba32{ { uint8_t(i), uint8_t(255 - i), uint8_t(i * 7), uint8_t(i) } };
+
+    std::vector<rgba_norm> linear(256);
+    to_float_srgb(codes.data(), 256, linear.data());
+    from_float_srgb(linear.data(), 256, back.data());
+    BOOST_CHECK(same(codes, back));
+
+    // Linear mid-grey is much lighter than code 128
+    BOOST_CHECK_GT(linear[128].r(), 0.2f);
+    BOOST_CHECK_LT(linear[128].r(), 0.25f);
+}
+
+BOOST_AUTO_TEST_CASE( batch_to_float_matches_per_element )
+{
+    std::vector<rgba32> pixels(1027);
+    for (std::size_t i = 0; i < pixels.size(); i++) pixels[i] = rgba32{ { uint8_t(i), uint8_t(i * 3), uint8_t(i >> 2), uint8_t(255 - i) } };
+
+    std::vector<rgba_norm> batch(pixels.size());
+    to_float(pixels.data(), pixels.size(), batch.data());
+
+    bool same = true;
+    for (std::size_t i = 0; i < pixels.size(); i++) {
+        auto single = to_float(pixels[i]);
+        same = same && std::memcmp(&single, &batch[i], sizeof(rgba_norm)) == 0;
+    }
+    BOOST_CHECK(same);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
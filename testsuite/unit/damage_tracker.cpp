@@ -0,0 +1,174 @@
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/damage_tracker.hpp>
+#include <gpc/gui/cpu/renderer.hpp>
+
+using gpc::gui::cpu::damage_tracker;
+using gpc::gui::rgba32;
+
+namespace {
+
+    auto regions_of(const damage_tracker &tracker) -> std::vector<damage_tracker::rect>
+    {
+        std::vector<damage_tracker::rect> regions;
+        tracker.get_regions(regions);
+        return regions;
+    }
+
+    // A scene of rectangles and tiled images, with an optional change in the middle of it
+    template <class Renderer>
+    void draw_scene(Renderer &r, typename Renderer::image_handle image, bool changed)
+    {
+        r.clear(rgba32{ { 200, 200, 200, 255 } });
+        for (int i = 0; i < 40; i++) {
+            r.fill_rect(i * 37 % 180 - 10, i * 23 % 130 - 10, 10 + i % 30, 10 + i * 7 % 40, rgba32{ { uint8_t(i * 50), uint8_t(i * 20), 90, uint8_t(i % 2 ? 255 : 128) } });
+            if (i % 3 == 0) r.draw_image(i * 11 % 150, i * 29 % 100, 40, 30, image, i % 5, i % 3);
+            if (changed && i == 20) r.fill_rect(70, 40, 30, 45, rgba32{ { 9, 9, 9, 100 } });
+        }
+    }
+
+} // anonymous ns
+
+// For comparing and printing regions in checks (found by argument-dependent lookup)
+namespace gpc { namespace gui { namespace cpu {
+
+    bool operator == (const damage_tracker::rect &a, const damage_tracker::rect &b)
+    {
+        return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+    }
+
+    bool operator != (const damage_tracker::rect &a, const damage_tracker::rect &b) { return !(a == b); }
+
+    auto operator << (std::ostream &os, const damage_tracker::rect &r) -> std::ostream &
+    {
+        return os << "{ " << r.x << ", " << r.y << ", " << r.w << ", " << r.h << " }";
+    }
+
+} } }
+
+BOOST_AUTO_TEST_SUITE( DamageTracker )
+
+BOOST_AUTO_TEST_CASE( starts_empty )
+{
+    damage_tracker tracker;
+    tracker.resize(100, 100);
+
+    BOOST_CHECK(tracker.empty());
+    BOOST_CHECK(regions_of(tracker).empty());
+    BOOST_CHECK(!tracker.intersects(0, 0, 100, 100));
+}
+
+BOOST_AUTO_TEST_CASE( marks_whole_tiles )
+{
+    damage_tracker tracker;
+    tracker.resize(100, 100);
+    tracker.add(40, 40, 41, 41);
+
+    std::vector<damage_tracker::rect> expected = { { 32, 32, 32, 32 } };
+    auto regions = regions_of(tracker);
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+
+    BOOST_CHECK(tracker.intersects(32, 32, 33, 33));
+    BOOST_CHECK(tracker.intersects(0, 0, 33, 33));
+    BOOST_CHECK(!tracker.intersects(0, 0, 32, 32));        // ends are exclusive
+    BOOST_CHECK(!tracker.intersects(64, 32, 100, 64));
+}
+
+BOOST_AUTO_TEST_CASE( merges_runs_and_rows )
+{
+    damage_tracker tracker;
+    tracker.resize(200, 200);
+    tracker.add(10, 10, 70, 70);
+    tracker.add(65, 65, 100, 100);      // overlaps the corner tile of the first box
+
+    // Two identical rows of 3 tiles, a row of 4, and a row of 2 (on the right)
+    std::vector<damage_tracker::rect> expected = { { 0, 0, 96, 64 }, { 0, 64, 128, 32 }, { 64, 96, 64, 32 } };
+    auto regions = regions_of(tracker);
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+
+    // L shape: runs of different widths are not merged vertically
+    tracker.clear();
+    tracker.add(0, 0, 64, 32);
+    tracker.add(0, 32, 32, 64);
+    expected = { { 0, 0, 64, 32 }, { 0, 32, 32, 32 } };
+    regions = regions_of(tracker);
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( clips_to_framebuffer )
+{
+    damage_tracker tracker;
+    tracker.resize(100, 70);
+    tracker.add(90, 50, 500, 500);
+    tracker.add(-50, -50, -10, -10);    // entirely outside
+
+    std::vector<damage_tracker::rect> expected = { { 64, 32, 36, 38 } };
+    auto regions = regions_of(tracker);
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+
+    tracker.clear();
+    tracker.add_all();
+    expected = { { 0, 0, 100, 70 } };
+    regions = regions_of(tracker);
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( splits_boxes_into_marked_parts )
+{
+    damage_tracker tracker;
+    tracker.resize(200, 100);
+    tracker.add(32, 0, 64, 32);
+    tracker.add(128, 0, 160, 64);
+
+    std::vector<damage_tracker::rect> parts;
+    tracker.for_each_part(40, 10, 150, 50, [&](int x1, int y1, int x2, int y2) { parts.push_back({ x1, y1, x2 - x1, y2 - y1 }); });
+
+    std::vector<damage_tracker::rect> expected = { { 40, 10, 24, 22 }, { 128, 10, 22, 22 }, { 128, 32, 22, 18 } };
+    BOOST_CHECK_EQUAL_COLLECTIONS(parts.begin(), parts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( renderer_reports_damage )
+{
+    gpc::gui::cpu::Renderer<> r(200, 150);
+    r.reset_damage();
+    BOOST_CHECK(r.damage().empty());
+
+    r.fill_rect(40, 40, 10, 10, rgba32{ { 255, 0, 0, 255 } });
+    std::vector<damage_tracker::rect> expected = { { 32, 32, 32, 32 } };
+    auto regions = regions_of(r.damage());
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( partial_redraw_matches_full_redraw )
+{
+    using renderer_t = gpc::gui::cpu::Renderer<>;
+
+    std::vector<rgba32> pixels(6 * 5, rgba32{ { 0, 255, 0, 200 } });
+    renderer_t partial(200, 150), full(200, 150);
+    auto image_p = partial.register_rgba32_image(6, 5, pixels.data());
+    auto image_f = full.register_rgba32_image(6, 5, pixels.data());
+
+    draw_scene(partial, image_p, false);
+    draw_scene(full, image_f, true);
+
+    // Redraw only where the change is
+    partial.reset_damage();
+    partial.invalidate(70, 40, 30, 45);
+    partial.begin_partial_redraw();
+    draw_scene(partial, image_p, true);
+    partial.end_partial_redraw();
+
+    BOOST_CHECK(std::memcmp(partial.pixels(), full.pixels(), 200 * 150 * sizeof(rgba32)) == 0);
+
+    // Nothing outside of the invalidated tiles was touched
+    auto regions = regions_of(partial.damage());
+    for (const auto &region: regions) {
+        BOOST_CHECK(region.x >= 64 && region.x + region.w <= 128 && region.y >= 32 && region.y + region.h <= 96);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
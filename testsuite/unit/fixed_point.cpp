@@ -0,0 +1,134 @@
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/tiled_renderer.hpp>
+#include <gpc/gui/fixed_point.hpp>
+#include <gpc/gui/recording_renderer.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 100, HEIGHT = 100;
+
+    template <vertical_direction Dir, alpha_mode Alpha = alpha_mode::straight>
+    using fixed_renderer = cpu::Renderer<Dir, fixed_24_8, Alpha>;
+
+    // Red component of a pixel, by renderer coordinates (framebuffer rows count
+    // from the top of the picture)
+    template <vertical_direction Dir, alpha_mode Alpha>
+    auto red_at(const fixed_renderer<Dir, Alpha> &r, int x, int y) -> int
+    {
+        return r.framebuffer().row(Dir == vertical_direction::up ? HEIGHT - 1 - y : y)[x * 4];
+    }
+
+    // Rectangles with fractional edges, one pair of them abutting
+    template <class Renderer>
+    void draw_fractional(Renderer &r)
+    {
+        using C = typename Renderer::coord_t;
+        r.clear(r.rgb_to_native({ 1, 1, 1 }));
+        r.fill_rect(C(10.25), C(5.5), C(20.5), C(0.25), r.rgb_to_native({ 0, 0, 0 }));
+        r.fill_rect(C(3.75), C(20.125), C(0.5), C(30.0), r.rgba_norm_to_native({ 1, 0, 0, 0.5f }));
+        r.fill_rect(C(40.5), C(40.5), C(10.0), C(10.0), r.rgb_to_native({ 0, 0, 1 }));
+        r.fill_rect(C(50.5), C(40.5), C(10.0), C(10.0), r.rgb_to_native({ 0, 0, 1 }));
+        r.push_clip(C(60), C(60), C(20), C(20));
+        r.fill_rect(C(55.3), C(55.7), C(30.0), C(30.0), r.rgba_norm_to_native({ 0, 1, 0, 0.7f }));
+        r.pop_clip();
+    }
+
+    // Whole-pixel coordinates only, with every kind of primitive
+    template <class Renderer>
+    void draw_aligned(Renderer &r)
+    {
+        auto resources = register_test_resources(r);
+
+        r.clear(r.rgb_to_native({ 0.8f, 0.7f, 0.6f }));
+        r.push_clip(10, 10, 80, 60);
+        r.fill_rect(0, 0, 60, 90, r.rgba_norm_to_native({ 1, 0, 0, 0.5f }));
+        r.draw_image(30, 20, 50, 50, resources.image, 1, 2);
+        r.set_text_color(r.rgb_to_native({ 0, 0, 0 }));
+        r.render_text(resources.font, 12, 35, U"FIXED", 5);
+        r.pop_clip();
+        r.fill_rect(70, 80, 30, 30, r.rgb_to_native({ 0, 1, 0 }));
+    }
+
+    template <vertical_direction Dir, alpha_mode Alpha>
+    void check_coverage()
+    {
+        fixed_renderer<Dir, Alpha> r(WIDTH, HEIGHT);
+        draw_fractional(r);
+
+        // Corner pixel covered 0.75 x 0.25, edge pixels 1 x 0.25, of black over white
+        BOOST_CHECK_EQUAL(red_at(r, 10, 5), 255 - 48);
+        BOOST_CHECK_EQUAL(red_at(r, 20, 5), 255 - 64);
+        BOOST_CHECK_EQUAL(red_at(r, 30, 5), 255 - 48);
+        BOOST_CHECK_EQUAL(red_at(r, 20, 4), 255);
+        BOOST_CHECK_EQUAL(red_at(r, 20, 6), 255);
+        BOOST_CHECK_EQUAL(red_at(r, 9, 5), 255);
+        BOOST_CHECK_EQUAL(red_at(r, 31, 5), 255);
+
+        // Fully covered pixels get the plain color
+        BOOST_CHECK_EQUAL(red_at(r, 45, 45), 0);
+
+        // Abutting half-covered edges are each blended once (conflation, as in other rasterizers)
+        BOOST_CHECK_EQUAL(red_at(r, 50, 45), 63);
+
+        // Clipping is by whole pixels: the partially covered edge pixels of the
+        // rectangle lie outside the clip, so the visible part is uniform
+        BOOST_CHECK_EQUAL(red_at(r, 60, 60), red_at(r, 70, 70));
+        BOOST_CHECK_EQUAL(red_at(r, 59, 70), 255);
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( FixedPointCoordinates )
+
+BOOST_AUTO_TEST_CASE( edge_coverage )
+{
+    check_coverage<vertical_direction::down, alpha_mode::straight>();
+    check_coverage<vertical_direction::up, alpha_mode::straight>();
+    check_coverage<vertical_direction::down, alpha_mode::premultiplied>();
+    check_coverage<vertical_direction::up, alpha_mode::premultiplied>();
+}
+
+BOOST_AUTO_TEST_CASE( aligned_edges_match_integer_coordinates )
+{
+    cpu::Renderer<vertical_direction::down> integral(WIDTH, HEIGHT);
+    fixed_renderer<vertical_direction::down> fixed(WIDTH, HEIGHT);
+    draw_aligned(integral);
+    draw_aligned(fixed);
+    BOOST_CHECK(same_pixels(integral, fixed));
+
+    cpu::Renderer<vertical_direction::up> integral_up(WIDTH, HEIGHT);
+    fixed_renderer<vertical_direction::up> fixed_up(WIDTH, HEIGHT);
+    draw_aligned(integral_up);
+    draw_aligned(fixed_up);
+    BOOST_CHECK(same_pixels(integral_up, fixed_up));
+}
+
+BOOST_AUTO_TEST_CASE( wrappers_keep_fractional_edges )
+{
+    using backend_t = fixed_renderer<vertical_direction::down>;
+
+    backend_t reference(WIDTH, HEIGHT);
+    draw_fractional(reference);
+
+    backend_t tiled_target(WIDTH, HEIGHT);
+    cpu::TiledRenderer<backend_t> tiled(&tiled_target, 2, 16);
+    draw_fractional(tiled);
+    tiled.flush();
+    BOOST_CHECK(same_pixels(reference, tiled_target));
+
+    backend_t recorded_target(WIDTH, HEIGHT);
+    RecordingRenderer<backend_t> recorder(&recorded_target);
+    recorder.begin_frame();
+    draw_fractional(recorder);
+    recorder.end_frame();
+    recorder.replay();
+    BOOST_CHECK(same_pixels(reference, recorded_target));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
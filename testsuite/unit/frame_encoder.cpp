@@ -0,0 +1,141 @@
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/frame_encoder.hpp>
+
+using namespace gpc::gui;
+
+namespace {
+
+    auto round_trip(const std::vector<uint32_t> &pixels) -> bool
+    {
+        std::vector<uint8_t> encoded;
+        pixel_rle::encode(pixels.data(), pixels.size(), encoded);
+
+        // Exact buffer, so that overreads show up under memory checkers
+        std::vector<uint32_t> decoded(pixels.size());
+        auto end = pixel_rle::decode(encoded.data(), encoded.data() + encoded.size(), decoded.data(), decoded.size());
+        return end == encoded.data() + encoded.size() && decoded == pixels;
+    }
+
+    uint32_t rd32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24; }
+    uint16_t rd16(const uint8_t *p) { return uint16_t(p[0] | p[1] << 8); }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( PixelRle )
+
+BOOST_AUTO_TEST_CASE( round_trips )
+{
+    BOOST_CHECK(round_trip({}));
+    BOOST_CHECK(round_trip({ 1 }));
+    BOOST_CHECK(round_trip({ 1, 1 }));
+    BOOST_CHECK(round_trip({ 1, 2, 2, 3 }));
+
+    // Runs and literal stretches around the packet limits (128 literals, 129 repeats)
+    for (std::size_t n: { 127u, 128u, 129u, 130u, 257u, 258u, 1000u }) {
+        BOOST_CHECK(round_trip(std::vector<uint32_t>(n, 0xFF00FF00u)));
+
+        std::vector<uint32_t> literals(n);
+        for (std::size_t i = 0; i < n; i++) literals[i] = uint32_t(i);
+        BOOST_CHECK(round_trip(literals));
+    }
+
+    std::mt19937 rng(3);
+    for (int t = 0; t < 200; t++) {
+        std::vector<uint32_t> pixels(rng() % 600);
+        for (auto &p: pixels) p = rng() % 3;       // short runs everywhere
+        BOOST_CHECK(round_trip(pixels));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( compresses_runs )
+{
+    std::vector<uint8_t> encoded;
+    pixel_rle::encode(std::vector<uint32_t>(129, 7).data(), 129, encoded);
+    BOOST_CHECK_EQUAL(encoded.size(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_malformed_data )
+{
+    std::vector<uint32_t> pixels(10, 5);
+    std::vector<uint8_t> encoded;
+    pixel_rle::encode(pixels.data(), pixels.size(), encoded);
+
+    std::vector<uint32_t> decoded(10);
+    // Truncated
+    BOOST_CHECK(!pixel_rle::decode(encoded.data(), encoded.data() + encoded.size() - 1, decoded.data(), 10));
+    // More pixels encoded than requested
+    BOOST_CHECK(!pixel_rle::decode(encoded.data(), encoded.data() + encoded.size(), decoded.data(), 9));
+    // Literal packet announcing more data than there is
+    const uint8_t literal[] = { 3, 1, 2, 3, 4 };
+    BOOST_CHECK(!pixel_rle::decode(literal, literal + sizeof(literal), decoded.data(), 4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( FrameEncoder )
+
+BOOST_AUTO_TEST_CASE( streams_changed_tiles )
+{
+    std::vector<uint8_t> stream;
+    cpu::Renderer<> r(100, 70);
+    {
+        frame_encoder encoder([&](const uint8_t *data, std::size_t size) { stream.insert(stream.end(), data, data + size); }, 32);
+        r.clear(rgba32{ { 10, 20, 30, 255 } });
+        encoder.submit(r.framebuffer());
+        encoder.finish();
+        r.fill_rect(40, 40, 5, 5, rgba32{ { 255, 0, 0, 255 } });     // within tile (1, 1)
+        encoder.submit(r.framebuffer());
+        encoder.finish();
+
+        auto stats = encoder.stats();
+        BOOST_CHECK_EQUAL(stats.encoded, 2u);
+        BOOST_CHECK_EQUAL(stats.tiles_total, 24u);
+        BOOST_CHECK_EQUAL(stats.tiles_changed, 13u);
+    }
+
+    BOOST_REQUIRE(stream.size() > 8);
+    BOOST_CHECK(std::memcmp(stream.data(), "GPCF", 4) == 0);
+    BOOST_CHECK_EQUAL(rd16(&stream[6]), 32);
+
+    // The second frame: a single tile, decoding to the pixels of the framebuffer
+    const uint8_t *frame = &stream[8];
+    frame += 20 + rd32(frame + 16);
+    BOOST_REQUIRE(std::memcmp(frame, "FRME", 4) == 0);
+    BOOST_CHECK_EQUAL(rd16(frame + 8), 100);
+    BOOST_CHECK_EQUAL(rd16(frame + 10), 70);
+    BOOST_REQUIRE_EQUAL(rd32(frame + 12), 1u);
+
+    auto tile = frame + 20;
+    BOOST_CHECK_EQUAL(rd16(tile), 1);
+    BOOST_CHECK_EQUAL(rd16(tile + 2), 1);
+    std::vector<uint32_t> pixels(32 * 32);
+    auto data = tile + 8, end = data + rd32(tile + 4);
+    for (int y = 0; y < 32 && data; y++) data = pixel_rle::decode(data, end, &pixels[std::size_t(y) * 32], 32);
+    BOOST_REQUIRE(data == end);
+
+    bool same = true;
+    for (int y = 0; y < 32; y++) same = same && std::memcmp(&pixels[std::size_t(y) * 32], r.pixels() + (32 + y) * 100 + 32, 32 * 4) == 0;
+    BOOST_CHECK(same);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_sizes_beyond_the_format )
+{
+    auto discard = [](const uint8_t *, std::size_t) {};
+    BOOST_CHECK_THROW(frame_encoder(discard, 0), std::invalid_argument);
+    BOOST_CHECK_THROW(frame_encoder(discard, 65536), std::invalid_argument);
+
+    frame_encoder encoder(discard);
+    std::vector<uint32_t> pixels(70000);
+    framebuffer_view view = { reinterpret_cast<const uint8_t*>(pixels.data()), 70000, 1, 70000 * 4, pixel_format::rgba32, vertical_direction::down };
+    BOOST_CHECK_THROW(encoder.submit(view), std::invalid_argument);
+    BOOST_CHECK_EQUAL(encoder.stats().submitted, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/framebuffer_view.hpp>
+
+using namespace gpc::gui;
+
+namespace {
+
+    const pixel_format FORMATS[] = { pixel_format::rgba32, pixel_format::bgra32, pixel_format::rgb24, pixel_format::bgr24 };
+
+    const uint8_t GUARD = 0xA5;
+    const int GUARD_BYTES = 16;         // after each destination row
+
+    // Color of a pixel of the test images (alpha 255 where the source format has no alpha)
+    auto color_at(int x, int y, bool has_alpha) -> rgba32
+    {
+        return rgba32{ { uint8_t(x * 20 + y), uint8_t(x + y * 30), uint8_t(x * y + 7), uint8_t(has_alpha ? 128 + x - y : 255) } };
+    }
+
+    // A pixel in the specified format, written independently of the library's tables
+    void put(pixel_format format, const rgba32 &c, uint8_t *p)
+    {
+        auto r = c.components[0], g = c.components[1], b = c.components[2], a = c.components[3];
+        switch (format) {
+        case pixel_format::rgba32: p[0] = r, p[1] = g, p[2] = b, p[3] = a; break;
+        case pixel_format::bgra32: p[0] = b, p[1] = g, p[2] = r, p[3] = a; break;
+        case pixel_format::rgb24:  p[0] = r, p[1] = g, p[2] = b; break;
+        case pixel_format::bgr24:  p[0] = b, p[1] = g, p[2] = r; break;
+        }
+    }
+
+    bool has_alpha(pixel_format format) { return bytes_per_pixel(format) == 4; }
+
+    /* An image in the specified format, with padded rows stored top-down or bottom-up.
+     */
+    struct test_image {
+        std::vector<uint8_t> bytes;
+        framebuffer_view view;
+
+        test_image(pixel_format format, int width, int height, bool bottom_up)
+        {
+            auto stride = std::ptrdiff_t(width * bytes_per_pixel(format) + 5);
+            bytes.assign(std::size_t(stride * height), 0x3C);
+            for (int y = 0; y < height; y++) {
+                auto row = &bytes[std::size_t((bottom_up ? height - 1 - y : y) * stride)];
+                for (int x = 0; x < width; x++) put(format, color_at(x, y, has_alpha(format)), row + x * bytes_per_pixel(format));
+            }
+            auto top = bottom_up ? &bytes[std::size_t((height - 1) * stride)] : bytes.data();
+            view = { top, width, height, bottom_up ? -stride : stride, format, bottom_up ? vertical_direction::up : vertical_direction::down };
+        }
+    };
+
+    // Reads the image into rows followed by guard bytes, and checks both
+    void check_read(pixel_format from, pixel_format to, int width, int height, bool bottom_up)
+    {
+        test_image image(from, width, height, bottom_up);
+
+        auto row_bytes = width * bytes_per_pixel(to), dst_stride = row_bytes + GUARD_BYTES;
+        std::vector<uint8_t> dst(std::size_t(dst_stride * height), GUARD);
+        read_pixels(image.view, to, dst.data(), dst_stride);
+
+        std::vector<uint8_t> expected(dst.size(), GUARD);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) put(to, color_at(x, y, has_alpha(from)), &expected[std::size_t(y * dst_stride + x * bytes_per_pixel(to))]);
+        }
+
+        BOOST_CHECK_MESSAGE(dst == expected, "read_pixels() from format " << int(from) << " to " << int(to) << ", width " << width
+            << (bottom_up ? ", bottom-up" : ""));
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( FramebufferView )
+
+BOOST_AUTO_TEST_CASE( every_format_pair )
+{
+    for (auto from: FORMATS) {
+        for (auto to: FORMATS) {
+            for (int width = 1; width <= 9; width++) {
+                check_read(from, to, width, 3, false);
+                check_read(from, to, width, 3, true);
+            }
+            check_read(from, to, 37, 2, true);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( vector_swizzles_match_scalar )
+{
+    // Straight calls of the row conversions, with guard bytes right after the row
+    for (auto to: FORMATS) {
+        auto sw = detail::make_swizzle(pixel_format::bgra32, to);
+        for (int count = 0; count <= 17; count++) {
+            test_image image(pixel_format::bgra32, count + 1, 1, false);
+            std::vector<uint8_t> expected(std::size_t(count * sw.dst_bpp + GUARD_BYTES), GUARD), dst = expected;
+
+            detail::swizzle_row_scalar(sw, image.view.data, expected.data(), count);
+            detail::swizzle_row(sw, image.view.data, dst.data(), count);
+            BOOST_CHECK_MESSAGE(dst == expected, "swizzle to format " << int(to) << " differs for " << count << " pixels");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( renderer_readback )
+{
+    // Same picture in both axis directions; read_pixels() gives the top row first
+    cpu::Renderer<> down(7, 4);
+    cpu::Renderer<vertical_direction::up> up(7, 4);
+    down.clear(rgba32{ { 0, 0, 0, 255 } });
+    up.clear(rgba32{ { 0, 0, 0, 255 } });
+    down.fill_rect(1, 0, 3, 1, rgba32{ { 255, 0, 0, 255 } });
+    up.fill_rect(1, 3, 3, 1, rgba32{ { 255, 0, 0, 255 } });
+
+    BOOST_CHECK(up.framebuffer().stride < 0);
+
+    std::vector<uint8_t> a(7 * 4 * 3), b(7 * 4 * 3);
+    down.read_pixels(pixel_format::bgr24, a.data());
+    up.read_pixels(pixel_format::bgr24, b.data());
+    BOOST_CHECK(a == b);
+    BOOST_CHECK_EQUAL(a[3 * 1 + 2], 255);       // red, in the top row
+    BOOST_CHECK_EQUAL(a[3 * 1 + 0], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
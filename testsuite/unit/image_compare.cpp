@@ -0,0 +1,166 @@
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/image_compare.hpp>
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 100, HEIGHT = 70;
+
+    auto make_image() -> std::vector<rgba32>
+    {
+        std::vector<rgba32> pixels(WIDTH * HEIGHT);
+        for (std::size_t i = 0; i < pixels.size(); i++) pixels[i] = rgba32{ { uint8_t(i * 7), uint8_t(i / 3), uint8_t(i * 13 + 5), 255 } };
+        return pixels;
+    }
+
+    auto changed(std::vector<rgba32> pixels, int x, int y, int channel, int delta) -> std::vector<rgba32>
+    {
+        auto &c = pixels[std::size_t(y * WIDTH + x)].components[std::size_t(channel)];
+        c = uint8_t(c + delta);
+        return pixels;
+    }
+
+    auto full_report() -> image_compare_options
+    {
+        image_compare_options options;
+        options.early_out = false;
+        options.regions = true;
+        options.diff_image = true;
+        return options;
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( ImageCompare )
+
+BOOST_AUTO_TEST_CASE( identical_images )
+{
+    auto a = make_image();
+    auto diff = compare_images(a.data(), a.data(), WIDTH, HEIGHT, full_report());
+
+    BOOST_CHECK(diff.identical());
+    BOOST_CHECK_EQUAL(diff.first_x, -1);
+    BOOST_CHECK_EQUAL(diff.max_difference, 0u);
+    BOOST_CHECK(diff.regions.empty());
+}
+
+BOOST_AUTO_TEST_CASE( tolerance )
+{
+    auto a = make_image();
+    auto b = changed(changed(a, 10, 20, 0, 2), 50, 30, 3, -3);
+
+    image_compare_options options;
+    options.early_out = false;
+
+    options.tolerance = 1;
+    auto diff = compare_images(a.data(), b.data(), WIDTH, HEIGHT, options);
+    BOOST_CHECK_EQUAL(diff.mismatched_pixels, 2u);
+    BOOST_CHECK_EQUAL(diff.max_difference, 3u);
+
+    options.tolerance = 2;
+    diff = compare_images(a.data(), b.data(), WIDTH, HEIGHT, options);
+    BOOST_CHECK_EQUAL(diff.mismatched_pixels, 1u);
+    BOOST_CHECK_EQUAL(diff.first_x, 50);
+    BOOST_CHECK_EQUAL(diff.first_y, 30);
+
+    options.tolerance = 3;
+    BOOST_CHECK(compare_images(a.data(), b.data(), WIDTH, HEIGHT, options).identical());
+}
+
+BOOST_AUTO_TEST_CASE( early_out_reports_first_mismatch )
+{
+    auto a = make_image();
+    auto b = changed(changed(a, 70, 5, 1, 9), 3, 60, 2, 1);
+
+    auto diff = compare_images(a.data(), b.data(), WIDTH, HEIGHT);
+    BOOST_CHECK_EQUAL(diff.mismatched_pixels, 1u);
+    BOOST_CHECK_EQUAL(diff.first_x, 70);
+    BOOST_CHECK_EQUAL(diff.first_y, 5);
+    BOOST_CHECK_EQUAL(diff.max_difference, 9u);
+}
+
+BOOST_AUTO_TEST_CASE( regions_and_diff_image )
+{
+    auto a = make_image();
+    auto b = changed(changed(changed(a, 5, 5, 0, 1), 6, 40, 0, 1), 99, 69, 0, 1);
+
+    auto diff = compare_images(a.data(), b.data(), WIDTH, HEIGHT, full_report());
+    BOOST_CHECK_EQUAL(diff.mismatched_pixels, 3u);
+
+    // 32x32 areas around the mismatches, clipped to the image
+    BOOST_REQUIRE_EQUAL(diff.regions.size(), 2u);
+    BOOST_CHECK_EQUAL(diff.regions[0].x, 0);
+    BOOST_CHECK_EQUAL(diff.regions[0].y, 0);
+    BOOST_CHECK_EQUAL(diff.regions[0].w, 32);
+    BOOST_CHECK_EQUAL(diff.regions[0].h, 64);
+    BOOST_CHECK_EQUAL(diff.regions[1].x, 96);
+    BOOST_CHECK_EQUAL(diff.regions[1].y, 64);
+    BOOST_CHECK_EQUAL(diff.regions[1].w, 4);
+    BOOST_CHECK_EQUAL(diff.regions[1].h, 6);
+
+    // Mismatches are red, everything else a light grey
+    BOOST_REQUIRE_EQUAL(diff.diff_image.size(), std::size_t(WIDTH * HEIGHT));
+    std::size_t red = 0;
+    for (const auto &p: diff.diff_image) {
+        if (p.components[0] == 255 && p.components[1] == 0) red++;
+        else BOOST_CHECK(p.components[0] == p.components[1] && p.components[0] >= 192);
+    }
+    BOOST_CHECK_EQUAL(red, 3u);
+}
+
+BOOST_AUTO_TEST_CASE( strided_rgb_images )
+{
+    // 3 bytes per pixel, rows padded to different strides
+    std::vector<uint8_t> a(HEIGHT * 320), b(HEIGHT * 304);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH * 3; x++) a[std::size_t(y * 320 + x)] = b[std::size_t(y * 304 + x)] = uint8_t(x * y);
+    }
+    a[std::size_t(10 * 320 + WIDTH * 3)] = 77;     // in the padding: ignored
+    b[std::size_t(12 * 304 + 4 * 3 + 2)] ^= 0x40;
+
+    image_compare_options options;
+    options.early_out = false;
+    image_diff diff;
+    compare_images(a.data(), 320, b.data(), 304, WIDTH, HEIGHT, 3, options, diff);
+    BOOST_CHECK_EQUAL(diff.mismatched_pixels, 1u);
+    BOOST_CHECK_EQUAL(diff.first_x, 4);
+    BOOST_CHECK_EQUAL(diff.first_y, 12);
+    BOOST_CHECK_EQUAL(diff.max_difference, 64u);
+}
+
+BOOST_AUTO_TEST_CASE( framebuffers )
+{
+    cpu::Renderer<> down(40, 30);
+    cpu::Renderer<vertical_direction::up> up(40, 30);
+    down.clear(rgba32{ { 10, 20, 30, 255 } });
+    up.clear(rgba32{ { 10, 20, 30, 255 } });
+    down.fill_rect(5, 5, 10, 3, rgba32{ { 255, 0, 0, 255 } });
+    up.fill_rect(5, 30 - 5 - 3, 10, 3, rgba32{ { 255, 0, 0, 255 } });
+
+    // Same picture, with opposite row orders in memory
+    BOOST_CHECK(compare_images(down.framebuffer(), up.framebuffer()).identical());
+
+    cpu::Renderer<> other(40, 31);
+    BOOST_CHECK_THROW(compare_images(down.framebuffer(), other.framebuffer()), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( empty_images )
+{
+    cpu::Renderer<> a(0, 0), b(0, 0);
+    auto diff = compare_images(a.framebuffer(), b.framebuffer(), full_report());
+    BOOST_CHECK(diff.identical());
+    BOOST_CHECK(diff.diff_image.empty());
+    BOOST_CHECK(diff.regions.empty());
+
+    std::vector<rgba32> pixels(WIDTH);
+    BOOST_CHECK(compare_images(pixels.data(), pixels.data(), WIDTH, 0, full_report()).identical());
+    BOOST_CHECK(compare_images(pixels.data(), pixels.data(), 0, HEIGHT, full_report()).identical());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
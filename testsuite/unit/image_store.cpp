@@ -0,0 +1,149 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/image_store.hpp>
+#include <gpc/gui/cpu/renderer.hpp>
+
+using namespace gpc::gui;
+using cpu::image_store;
+
+namespace {
+
+    auto make_pixels(std::size_t count, uint8_t alpha = 255) -> std::vector<rgba32>
+    {
+        std::vector<rgba32> pixels(count);
+        for (std::size_t i = 0; i < count; i++) pixels[i] = rgba32{ { uint8_t(i), uint8_t(i >> 8), 3, alpha } };
+        return pixels;
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( ImageStore )
+
+BOOST_AUTO_TEST_CASE( stores_copies )
+{
+    image_store store;
+    auto pixels = make_pixels(10 * 7);
+    auto h = store.add(10, 7, pixels.data());
+    pixels[0].components[0] = 99;       // the store has its own copy
+
+    auto image = store.find(h);
+    BOOST_REQUIRE(image);
+    BOOST_CHECK_EQUAL(image->width, 10);
+    BOOST_CHECK_EQUAL(image->height, 7);
+    BOOST_CHECK_EQUAL(image->pixels[0].components[0], 0);
+    BOOST_CHECK_EQUAL(image->pixels[69].components[0], 69);
+    BOOST_CHECK(image->opaque);
+
+    auto translucent = make_pixels(4, 128);
+    BOOST_CHECK(!store.find(store.add(2, 2, translucent.data()))->opaque);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_empty_images )
+{
+    image_store store;
+    auto pixels = make_pixels(1);
+    BOOST_CHECK_THROW(store.add(0, 5, pixels.data()), std::invalid_argument);
+    BOOST_CHECK_THROW(store.add(5, 0, pixels.data()), std::invalid_argument);
+    BOOST_CHECK_THROW(store.add(-1, 1, pixels.data()), std::invalid_argument);
+    BOOST_CHECK_EQUAL(store.stats().images, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( reference_counts )
+{
+    image_store store;
+    auto pixels = make_pixels(16);
+    auto h = store.add(4, 4, pixels.data());
+    BOOST_CHECK_EQUAL(store.ref_count(h), 1u);
+
+    BOOST_CHECK(store.retain(h));
+    BOOST_CHECK_EQUAL(store.ref_count(h), 2u);
+
+    BOOST_CHECK(store.release(h));
+    BOOST_CHECK(store.valid(h));
+    BOOST_CHECK(store.release(h));
+    BOOST_CHECK(!store.valid(h));
+    BOOST_CHECK_EQUAL(store.ref_count(h), 0u);
+
+    // Stale handles are rejected everywhere
+    BOOST_CHECK(!store.release(h));
+    BOOST_CHECK(!store.retain(h));
+    BOOST_CHECK(!store.find(h));
+    BOOST_CHECK_EQUAL(store.stats().images, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( stale_handles_after_slot_reuse )
+{
+    image_store store;
+    auto pixels = make_pixels(16);
+    auto old_handle = store.add(4, 4, pixels.data());
+    store.release(old_handle);
+
+    auto new_handle = store.add(2, 8, pixels.data());
+    BOOST_CHECK(new_handle != old_handle);
+    BOOST_CHECK(new_handle != 0u);
+    BOOST_CHECK(!store.find(old_handle));
+    BOOST_REQUIRE(store.find(new_handle));
+    BOOST_CHECK_EQUAL(store.find(new_handle)->width, 2);
+
+    BOOST_CHECK(!store.find(0));
+}
+
+BOOST_AUTO_TEST_CASE( reuses_and_trims_memory )
+{
+    image_store store;
+    auto pixels = make_pixels(300 * 300);
+    std::vector<image_store::handle> handles;
+
+    std::srand(1);
+    for (int i = 0; i < 20000; i++) {
+        if (handles.size() < 300 && std::rand() % 2) {
+            int w = 1 + std::rand() % 150, h = 1 + std::rand() % 150;
+            if (std::rand() % 50 == 0) w = h = 300;     // too big for the slabs
+            handles.push_back(store.add(w, h, pixels.data()));
+            BOOST_REQUIRE_EQUAL(std::memcmp(store.find(handles.back())->pixels, pixels.data(), std::size_t(w) * std::size_t(h) * 4), 0);
+        }
+        else if (!handles.empty()) {
+            auto k = std::size_t(std::rand()) % handles.size();
+            store.release(handles[k]);
+            handles[k] = handles.back();
+            handles.pop_back();
+        }
+    }
+    BOOST_CHECK_EQUAL(store.stats().images, handles.size());
+
+    for (auto h: handles) store.release(h);
+    store.trim();
+
+    auto stats = store.stats();
+    BOOST_CHECK_EQUAL(stats.images, 0u);
+    BOOST_CHECK_EQUAL(stats.pixel_bytes, 0u);
+    BOOST_CHECK_EQUAL(stats.slabs, 0u);
+    BOOST_CHECK_EQUAL(stats.slab_bytes, 0u);
+    BOOST_CHECK_EQUAL(stats.large_bytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( renderer_ignores_stale_images )
+{
+    cpu::Renderer<> r(16, 16);
+    auto pixels = make_pixels(16);
+    auto h = r.register_rgba32_image(4, 4, pixels.data());
+
+    r.retain_image(h);
+    r.unregister_image(h);
+    r.clear(rgba32{ { 0, 0, 0, 0 } });
+    r.draw_image(0, 0, 4, 4, h);
+    BOOST_CHECK_EQUAL(r.pixels()[1].components[0], 1);     // still registered
+
+    r.unregister_image(h);
+    r.unregister_image(h);      // harmless
+    r.clear(rgba32{ { 0, 0, 0, 0 } });
+    r.draw_image(0, 0, 4, 4, h);
+    BOOST_CHECK_EQUAL(r.pixels()[1].components[3], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
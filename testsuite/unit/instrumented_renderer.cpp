@@ -0,0 +1,159 @@
+#include <type_traits>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/instrumented_renderer.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 100, HEIGHT = 50;
+
+    using backend_t = cpu::Renderer<>;
+
+    /* A frame of which the counters are worked out by hand (in the comments: pixels
+       drawn / clipped away).
+     */
+    template <class Renderer>
+    void draw_frame(Renderer &r, const test_resources<Renderer> &resources)
+    {
+        auto color = r.rgba_norm_to_native({ 0.2f, 0.4f, 0.6f, 0.7f });
+
+        r.clear(r.rgb_to_native({ 1, 1, 1 }));                         // 5000 / 0
+        r.fill_rect(10, 10, 20, 10, color);                             // 200 / 0
+        r.set_clipping_rect(0, 0, 50, 50);
+        r.fill_rect(40, 0, 20, 10, color);                              // 100 / 100
+        r.cancel_clipping();
+        r.fill_rect(90, 45, 20, 10, color);                             // 50 / 150 (beyond the surface)
+        r.push_clip(0, 0, 30, 30);
+        r.push_clip(20, 20, 30, 30);
+        r.draw_image(0, 0, 40, 40, resources.image);                    // 100 / 1500
+        r.pop_clip();
+        r.pop_clip();
+        r.set_text_color(r.rgb_to_native({ 0, 0, 0 }));
+        r.render_text_utf8(resources.font, 5, 40, "AB\x80\x80", 4);     // 4 glyphs
+        r.render_text(resources.font, 5, 20, U"XYZ", 3);                // 3 glyphs
+
+        const fill_record_t<Renderer> rects[] = { { 0, 0, 10, 10, color }, { 95, 0, 10, 10, color } };
+        fill_rects(r, rects, 2);                                        // 150 / 50
+        const image_record_t<Renderer> images[] = { { -5, -5, 10, 10, resources.image, 0, 0 } };
+        draw_images(r, images, 1);                                      // 25 / 75
+    }
+
+    // The counters of draw_frame(), other than time
+    void check_frame(const render_stats &s)
+    {
+        BOOST_CHECK_EQUAL(s.frames, 1u);
+        BOOST_CHECK_EQUAL(s[primitive_category::clear      ].calls, 1u);
+        BOOST_CHECK_EQUAL(s[primitive_category::fill_rect  ].calls, 5u);
+        BOOST_CHECK_EQUAL(s[primitive_category::draw_image ].calls, 2u);
+        BOOST_CHECK_EQUAL(s[primitive_category::render_text].calls, 2u);
+        BOOST_CHECK_EQUAL(s[primitive_category::upload     ].calls, 2u);
+        BOOST_CHECK_EQUAL(s[primitive_category::flush      ].calls, 0u);
+        BOOST_CHECK_EQUAL(s.calls(), 12u);
+        BOOST_CHECK_EQUAL(s.state_changes, 7u);
+        BOOST_CHECK_EQUAL(s.pixels_drawn, 5625u);
+        BOOST_CHECK_EQUAL(s.pixels_clipped, 1875u);
+        BOOST_CHECK_EQUAL(s.glyphs, 7u);
+        BOOST_CHECK_EQUAL(s.bytes_uploaded, 7u * 5u * sizeof(rgba32));
+    }
+
+    template <bool Enabled>
+    struct fixture {
+        backend_t                                   direct, backend;
+        InstrumentedRenderer<backend_t, Enabled>    instrumented;
+
+        fixture(): direct(WIDTH, HEIGHT), backend(WIDTH, HEIGHT), instrumented(&backend)
+        {
+            draw_frame(direct, register_test_resources(direct));
+        }
+    };
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( InstrumentedRendering )
+
+BOOST_AUTO_TEST_CASE( counts_a_known_frame )
+{
+    fixture<true> f;
+    auto &r = f.instrumented;
+    auto &instr = r.instrumentation();
+
+    // Resources registered before the frame are attributed to it
+    auto resources = register_test_resources(r);
+    instr.begin_frame();
+    draw_frame(r, resources);
+    instr.end_frame();
+
+    check_frame(instr.last_frame());
+    check_frame(instr.totals());
+    BOOST_CHECK(same_pixels(f.backend, f.direct));
+
+    // An empty frame: nothing counted, totals unchanged
+    instr.begin_frame();
+    instr.end_frame();
+    BOOST_CHECK_EQUAL(instr.last_frame().calls(), 0u);
+    BOOST_CHECK_EQUAL(instr.last_frame().pixels_drawn, 0u);
+    BOOST_CHECK_EQUAL(instr.totals().frames, 2u);
+    BOOST_CHECK_EQUAL(instr.totals().pixels_drawn, 5625u);
+    BOOST_CHECK_EQUAL(instr.totals().glyphs, 7u);
+
+    instr.reset_totals();
+    BOOST_CHECK_EQUAL(instr.totals().frames, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( counts_glyphs_as_decoded )
+{
+    fixture<true> f;
+    auto &r = f.instrumented;
+    auto font = r.register_font(make_test_font());
+
+    const char *texts[] = { "", "ABC", "\x80\x80", "A\xC3\xA9Z", "\xE2\x82", "\xF0\x9F\x98\x80\xF0\x9F\x98", "\xED\xA0\x80", "\xC0\xAF" };
+    for (auto text: texts) {
+        auto length = std::char_traits<char>::length(text);
+        r.instrumentation().begin_frame();
+        r.render_text_utf8(font, 0, 20, text, length);
+        r.instrumentation().end_frame();
+
+        std::vector<char32_t> codepoints;
+        utf8_to_ucs4(text, length, codepoints);
+        BOOST_CHECK_EQUAL(r.instrumentation().last_frame().glyphs, codepoints.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( disabled_adaptor_only_forwards )
+{
+    using adaptor_t = InstrumentedRenderer<backend_t, false>;
+
+    static_assert(!adaptor_t::enabled, "disabled");
+    static_assert(std::is_same<adaptor_t::instrumentation_t, null_instrumentation>::value, "nothing recorded");
+    static_assert(std::is_empty<null_instrumentation>::value, "no state");
+
+    fixture<false> f;
+    auto &r = f.instrumented;
+    auto &instr = r.instrumentation();
+
+    auto resources = register_test_resources(r);
+    instr.begin_frame();
+    draw_frame(r, resources);
+    instr.end_frame();
+
+    BOOST_CHECK(same_pixels(f.backend, f.direct));
+    BOOST_CHECK_EQUAL(instr.last_frame().calls(), 0u);
+    BOOST_CHECK_EQUAL(instr.last_frame().pixels_drawn, 0u);
+    BOOST_CHECK_EQUAL(instr.totals().frames, 0u);
+
+    // Queries reach the backend
+    r.push_clip(10, 10, 20, 20);
+    BOOST_CHECK_EQUAL(r.clip_depth(), f.backend.clip_depth());
+    BOOST_CHECK(r.clip_test(0, 0, 5, 5) == f.backend.clip_test(0, 0, 5, 5));
+    BOOST_CHECK(r.clip_test(15, 15, 5, 5) == f.backend.clip_test(15, 15, 5, 5));
+    r.pop_clip();
+    BOOST_CHECK_EQUAL(r.clip_depth(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,7 @@
+#define BOOST_TEST_MODULE libGPCGUIRenderer
+#include <boost/test/unit_test.hpp>
+
+/* Unit tests of the renderer library: the building blocks of the CPU backend and
+   the helpers around it. Each source file of this directory holds the test suite
+   of one component.
+ */
@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/packed_font.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    // Buffers for packed fonts, which must be aligned
+    struct alignas(packed_font::ALIGNMENT) block { uint8_t bytes[packed_font::ALIGNMENT]; };
+
+    struct aligned_data {
+        std::vector<block> blocks;
+        std::size_t size;
+
+        explicit aligned_data(const std::vector<uint8_t> &bytes): blocks((bytes.size() + sizeof(block) - 1) / sizeof(block)), size(bytes.size())
+        {
+            if (size > 0) std::memcpy(data(), bytes.data(), size);
+        }
+
+        auto data() -> uint8_t * { return blocks.empty() ? nullptr : &blocks[0].bytes[0]; }
+        auto header() -> packed_font::header & { return *reinterpret_cast<packed_font::header*>(data()); }
+        auto glyph(std::size_t i) -> packed_font::glyph & { return reinterpret_cast<packed_font::glyph*>(data() + header().glyphs_offset)[i]; }
+    };
+
+    // The test font, plus a glyph with empty borders (to be trimmed) and an empty one
+    auto make_font() -> gpc::fonts::rasterized_font
+    {
+        auto font = make_test_font();
+        auto &variant = font.variants[0];
+
+        gpc::fonts::rasterized_font::glyph_record glyph = variant.glyphs[0];
+        glyph.cbox.bounds.x_min = -1;
+        glyph.cbox.bounds.x_max = 5;
+        glyph.cbox.bounds.y_min = -2;
+        glyph.cbox.bounds.y_max = 4;
+        glyph.cbox.adv_x = 7;
+        glyph.pixel_base = variant.pixels.size();
+        font.index.push_back(U'[');
+        variant.glyphs.push_back(glyph);
+        for (int y = 0; y < 6; y++) {
+            for (int x = 0; x < 6; x++) variant.pixels.push_back(x >= 2 && x < 5 && y >= 1 && y < 3 ? uint8_t(60 * x + y) : 0);
+        }
+
+        glyph.cbox.bounds.x_max = glyph.cbox.bounds.x_min;
+        glyph.cbox.bounds.y_max = glyph.cbox.bounds.y_min;
+        glyph.cbox.adv_x = 4;
+        glyph.pixel_base = variant.pixels.size();
+        font.index.push_back(U']');
+        variant.glyphs.push_back(glyph);
+
+        return font;
+    }
+
+    auto packed_bytes() -> std::vector<uint8_t>
+    {
+        std::vector<uint8_t> bytes;
+        packed_font::write(make_font(), bytes);
+        return bytes;
+    }
+
+    // Message of the exception thrown when loading the data, or an empty string
+    auto load_error(aligned_data &data, std::size_t size) -> std::string
+    {
+        try {
+            packed_font font(data.data(), size);
+            return std::string();
+        }
+        catch (const std::runtime_error &e) {
+            return e.what();
+        }
+    }
+
+    auto load_error(aligned_data &data) -> std::string { return load_error(data, data.size); }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( PackedFont )
+
+BOOST_AUTO_TEST_CASE( writes_valid_fonts )
+{
+    aligned_data data(packed_bytes());
+    packed_font font(data.data(), data.size);
+
+    auto rfont = make_font();
+    BOOST_REQUIRE_EQUAL(font.glyph_count(), rfont.index.size());
+    for (std::size_t i = 0; i < font.glyph_count(); i++) BOOST_CHECK(font.codepoints()[i] == rfont.index[i]);
+
+    // Trimmed to the non-empty pixels
+    const auto &bracket = font.glyphs()[26];
+    BOOST_CHECK_EQUAL(bracket.x_min, 1);
+    BOOST_CHECK_EQUAL(bracket.y_min, 1);
+    BOOST_CHECK_EQUAL(bracket.width, 3);
+    BOOST_CHECK_EQUAL(bracket.height, 2);
+    BOOST_CHECK_EQUAL(bracket.adv_x, 7);
+    BOOST_CHECK_EQUAL(font.pixels()[bracket.offset], 60 * 2 + 1);
+
+    const auto &empty = font.glyphs()[27];
+    BOOST_CHECK_EQUAL(empty.width * empty.height, 0);
+    BOOST_CHECK_EQUAL(empty.adv_x, 4);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_bad_headers )
+{
+    auto bytes = packed_bytes();
+
+    {
+        aligned_data data(bytes);
+        BOOST_CHECK_EQUAL(load_error(data, 0), "packed_font: data too short");
+        BOOST_CHECK_EQUAL(load_error(data, sizeof(packed_font::header) - 1), "packed_font: data too short");
+        BOOST_CHECK_EQUAL(load_error(data, data.size - 1), "packed_font: inconsistent header");    // truncated file
+    }
+    {
+        aligned_data data(bytes);
+        data.header().magic[3] = 'X';
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: not a packed font");
+    }
+    {
+        aligned_data data(bytes);
+        data.header().byte_order = 0x04030201;
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: wrong byte order");
+    }
+    {
+        aligned_data data(bytes);
+        data.header().version = packed_font::VERSION + 1;
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: unsupported version");
+    }
+    {
+        aligned_data data(bytes);
+        data.header().glyph_size = sizeof(packed_font::glyph) + 4;
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: inconsistent header");
+    }
+
+    // Unaligned data
+    std::vector<block> blocks(bytes.size() / sizeof(block) + 2);
+    auto unaligned = &blocks[0].bytes[1];
+    std::memcpy(unaligned, bytes.data(), bytes.size());
+    BOOST_CHECK_THROW(packed_font(unaligned, bytes.size()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_sections_out_of_range )
+{
+    auto bytes = packed_bytes();
+    auto check = [&](void (*corrupt)(packed_font::header &)) {
+        aligned_data data(bytes);
+        corrupt(data.header());
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: sections out of bounds");
+    };
+
+    check([](packed_font::header &h) { h.index_offset = h.file_size; });
+    check([](packed_font::header &h) { h.index_offset = 0xFFFFFFF0u; });
+    check([](packed_font::header &h) { h.glyphs_offset += 4; });                 // misaligned
+    check([](packed_font::header &h) { h.pixels_offset = 0; });                  // within the header
+    check([](packed_font::header &h) { h.pixels_size = h.file_size; });
+    check([](packed_font::header &h) { h.pixels_size = 0xFFFFFFFFu; });
+    check([](packed_font::header &h) { h.glyph_count = 0x40000000u; });        // 32-bit overflow of the table sizes
+}
+
+BOOST_AUTO_TEST_CASE( rejects_glyphs_out_of_range )
+{
+    auto bytes = packed_bytes();
+    auto check = [&](void (*corrupt)(packed_font::glyph &, const packed_font::header &)) {
+        aligned_data data(bytes);
+        corrupt(data.glyph(5), data.header());
+        BOOST_CHECK_EQUAL(load_error(data), "packed_font: glyph out of bounds");
+    };
+
+    check([](packed_font::glyph &g, const packed_font::header &h) { g.offset = h.pixels_size; });
+    check([](packed_font::glyph &g, const packed_font::header &h) { g.offset = h.pixels_size - uint32_t(g.width * g.height) + 1; });
+    check([](packed_font::glyph &g, const packed_font::header &) { g.offset = 0xFFFFFFFFu; });
+    check([](packed_font::glyph &g, const packed_font::header &) { g.width = -1; });
+    check([](packed_font::glyph &g, const packed_font::header &) { g.height = 0x7FFFFFFF; });
+    check([](packed_font::glyph &g, const packed_font::header &) { g.packed = 0; });
+}
+
+BOOST_AUTO_TEST_CASE( renders_like_the_rasterized_font )
+{
+    auto rfont = make_font();
+
+    // Through a file, as converted by GPCFontPacker
+    std::string path = "packed_font_test.gpf";
+    {
+        auto bytes = packed_bytes();
+        auto file = std::fopen(path.c_str(), "wb");
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE_EQUAL(std::fwrite(bytes.data(), 1, bytes.size(), file), bytes.size());
+        BOOST_REQUIRE_EQUAL(std::fclose(file), 0);
+    }
+    auto packed = packed_font::load_file(path);
+    std::remove(path.c_str());
+
+    const std::u32string text = U"PACKED [FONT] ]WXYZ[";
+    auto draw = [&](auto &r, auto font) {
+        r.clear(rgba32{ { 255, 255, 255, 255 } });
+        r.set_text_color(r.rgba_norm_to_native({ 0.1f, 0.2f, 0.5f, 0.9f }));
+        r.render_text(font, 3, 20, text.data(), text.size());
+        r.set_clipping_rect(10, 25, 60, 8);
+        r.render_text(font, 5, 35, text.data(), text.size());
+        r.cancel_clipping();
+    };
+
+    cpu::Renderer<> from_rft(160, 45), from_gpf(160, 45);
+    draw(from_rft, from_rft.register_font(rfont));
+    draw(from_gpf, from_gpf.register_font(packed));
+    BOOST_CHECK(same_pixels(from_rft, from_gpf));
+
+    cpu::Renderer<vertical_direction::up> from_rft_up(160, 45), from_gpf_up(160, 45);
+    draw(from_rft_up, from_rft_up.register_font(rfont));
+    draw(from_gpf_up, from_gpf_up.register_font(packed));
+    BOOST_CHECK(same_pixels(from_rft_up, from_gpf_up));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,221 @@
+#include <cstring>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/scaled_image_cache.hpp>
+
+using namespace gpc::gui;
+using cpu::image_filter;
+using cpu::scaled_image_cache;
+
+namespace {
+
+    const image_filter FILTERS[] = { image_filter::bilinear, image_filter::box };
+
+    // Varied pixels, premultiplied (no color component exceeds alpha)
+    auto make_pixels(int width, int height, bool opaque) -> std::vector<rgba32>
+    {
+        std::vector<rgba32> pixels(std::size_t(width) * std::size_t(height));
+        for (std::size_t i = 0; i < pixels.size(); i++) {
+            auto a = opaque ? 255u : unsigned(i * 17 % 256);
+            pixels[i] = rgba32{ { uint8_t(i * 7 % (a + 1)), uint8_t(i * 3 % (a + 1)), uint8_t(i % (a + 1)), uint8_t(a) } };
+        }
+        return pixels;
+    }
+
+    auto view_of(const std::vector<rgba32> &pixels, int width, int height, bool opaque) -> cpu::image_store::image
+    {
+        return { width, height, pixels.data(), opaque };
+    }
+
+    // Same pixels, compared row by row
+    bool same_rows(const rgba32 *a, std::size_t stride_a, const rgba32 *b, std::size_t stride_b, int width, int height)
+    {
+        for (int y = 0; y < height; y++) {
+            if (std::memcmp(a + std::size_t(y) * stride_a, b + std::size_t(y) * stride_b, std::size_t(width) * sizeof(rgba32)) != 0) return false;
+        }
+        return true;
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( ScaledImageCache )
+
+BOOST_AUTO_TEST_CASE( weights_add_up_to_one )
+{
+    struct { int src, dst; } sizes[] = { { 1, 1 }, { 1, 50 }, { 7, 3 }, { 3, 7 }, { 100, 99 }, { 99, 100 }, { 640, 3 }, { 20000, 7 }, { 5, 4000 } };
+
+    cpu::detail::taps_table table;
+    for (auto filter: FILTERS) {
+        for (const auto &size: sizes) {
+            cpu::detail::make_taps(size.src, size.dst, 0, size.dst, filter, table);
+            BOOST_REQUIRE_EQUAL(table.pixels.size(), std::size_t(size.dst));
+
+            bool ok = true;
+            for (const auto &t: table.pixels) {
+                unsigned sum = 0;
+                for (int k = 0; k < t.count; k++) sum += table.weights[t.weights + std::size_t(k)];
+                ok = ok && sum == unsigned(cpu::detail::RESAMPLE_WEIGHT_ONE) && t.first >= 0 && t.count > 0 && t.first + t.count <= size.src;
+            }
+            BOOST_CHECK_MESSAGE(ok, "bad taps from " << size.src << " to " << size.dst << " pixels, filter " << int(filter));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( taps_of_a_part )
+{
+    // The taps of pixels first to last are those of the whole axis
+    cpu::detail::taps_table whole, part;
+    for (auto filter: FILTERS) {
+        cpu::detail::make_taps(37, 101, 0, 101, filter, whole);
+        cpu::detail::make_taps(37, 101, 40, 60, filter, part);
+        BOOST_REQUIRE_EQUAL(part.pixels.size(), 20u);
+        for (std::size_t i = 0; i < 20; i++) {
+            const auto &a = whole.pixels[40 + i], &b = part.pixels[i];
+            BOOST_CHECK_EQUAL(a.first, b.first);
+            BOOST_REQUIRE_EQUAL(a.count, b.count);
+            for (int k = 0; k < a.count; k++) BOOST_CHECK_EQUAL(whole.weights[a.weights + std::size_t(k)], part.weights[b.weights + std::size_t(k)]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( uniform_images_stay_uniform )
+{
+    const rgba32 colors[] = { { { 10, 200, 30, 255 } }, { { 255, 255, 255, 255 } }, { { 40, 20, 90, 128 } }, { { 0, 0, 0, 0 } } };
+
+    scaled_image_cache cache;
+    cpu::image_store::handle handle = 0;
+    for (auto color: colors) {
+        handle++;
+        std::vector<rgba32> pixels(13 * 9, color);
+        bool opaque = color.components[3] == 255;
+        auto src = view_of(pixels, 13, 9, opaque);
+
+        for (auto filter: FILTERS) {
+            for (auto size: { 1, 5, 13, 40, 301 }) {
+                // As premultiplied pixels (no color component exceeds alpha)
+                const auto &variant = cache.get(handle, src, size, size * 2 / 3 + 1, filter, true);
+                bool uniform = true;
+                for (int i = 0; i < variant.width * variant.height; i++) uniform = uniform && std::memcmp(&variant.pixels[i], &color, sizeof(rgba32)) == 0;
+                BOOST_CHECK_MESSAGE(uniform, "not uniform at " << size << " pixels, filter " << int(filter));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( region_matches_cached_variant )
+{
+    for (bool opaque: { true, false }) {
+        auto pixels = make_pixels(23, 17, opaque);
+        auto src = view_of(pixels, 23, 17, opaque);
+
+        for (auto filter: FILTERS) {
+            for (auto size: { std::make_pair(7, 5), std::make_pair(61, 45), std::make_pair(100, 30) }) {
+                scaled_image_cache cache;
+                const auto &variant = cache.get(1, src, size.first, size.second, filter, false);
+
+                int x1 = size.first / 3, y1 = size.second / 4, x2 = size.first - 1, y2 = size.second * 2 / 3 + 1;
+                const auto &region = cache.resample_region(src, size.first, size.second, x1, y1, x2, y2, filter, false);
+                BOOST_REQUIRE_EQUAL(region.width, x2 - x1);
+                BOOST_REQUIRE_EQUAL(region.height, y2 - y1);
+                BOOST_CHECK_MESSAGE(same_rows(variant.pixels + y1 * size.first + x1, std::size_t(size.first), region.pixels, std::size_t(region.width), region.width, region.height),
+                    "region differs at " << size.first << "x" << size.second << ", filter " << int(filter));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( renderer_region_matches_cached_variant )
+{
+    auto pixels = make_pixels(23, 17, false);
+
+    // Same drawing with a cache that holds the variant, and with one too small for it
+    auto check = [&](auto &cached, auto &uncached) {
+        uncached.set_scaled_image_cache_capacity(1000);
+        for (auto r: { &cached, &uncached }) {
+            auto image = r->register_rgba32_image(23, 17, pixels.data());
+            r->clear(rgba32{ { 255, 255, 255, 255 } });
+            r->set_clipping_rect(10, 15, 50, 30);
+            r->draw_image_scaled(3, 5, 90, 70, image, image_filter::box);
+            r->cancel_clipping();
+        }
+        BOOST_CHECK_EQUAL(cached.scaled_image_cache_stats().variants, 1u);
+        BOOST_CHECK_EQUAL(uncached.scaled_image_cache_stats().variants, 0u);
+        BOOST_CHECK(std::memcmp(cached.pixels(), uncached.pixels(), 100 * 80 * sizeof(rgba32)) == 0);
+    };
+
+    cpu::Renderer<> down_cached(100, 80), down_uncached(100, 80);
+    check(down_cached, down_uncached);
+
+    cpu::Renderer<vertical_direction::up> up_cached(100, 80), up_uncached(100, 80);
+    check(up_cached, up_uncached);
+}
+
+BOOST_AUTO_TEST_CASE( hits_and_lru_eviction )
+{
+    auto pixels = make_pixels(8, 8, true);
+    auto src = view_of(pixels, 8, 8, true);
+
+    // Room for two 32x32 variants, not three
+    scaled_image_cache probe(1 << 30);
+    probe.get(1, src, 32, 32, image_filter::box, false);
+    auto one = probe.stats().bytes;
+    scaled_image_cache cache(one * 2 + one / 2);
+
+    cache.get(1, src, 32, 32, image_filter::box, false);
+    cache.get(2, src, 32, 32, image_filter::box, false);
+    cache.get(1, src, 32, 32, image_filter::box, false);       // hit: 1 becomes the most recently used
+    BOOST_CHECK_EQUAL(cache.stats().hits, 1u);
+
+    cache.get(3, src, 32, 32, image_filter::box, false);       // evicts 2
+    auto stats = cache.stats();
+    BOOST_CHECK_EQUAL(stats.evictions, 1u);
+    BOOST_CHECK_EQUAL(stats.variants, 2u);
+    BOOST_CHECK(stats.bytes <= stats.capacity);
+
+    cache.get(1, src, 32, 32, image_filter::box, false);
+    BOOST_CHECK_EQUAL(cache.stats().hits, 2u);
+    cache.get(2, src, 32, 32, image_filter::box, false);
+    BOOST_CHECK_EQUAL(cache.stats().misses, 4u);
+
+    // Filter and size are part of the key
+    cache.get(2, src, 32, 32, image_filter::bilinear, false);
+    cache.get(2, src, 31, 32, image_filter::box, false);
+    BOOST_CHECK_EQUAL(cache.stats().misses, 6u);
+
+    BOOST_CHECK(!cache.fits(1000, 1000));
+    cache.set_capacity(one);
+    BOOST_CHECK_EQUAL(cache.stats().variants, 1u);
+}
+
+BOOST_AUTO_TEST_CASE( invalidation )
+{
+    auto pixels = make_pixels(8, 8, true);
+    auto src = view_of(pixels, 8, 8, true);
+
+    scaled_image_cache cache;
+    cache.get(1, src, 16, 16, image_filter::box, false);
+    cache.get(1, src, 20, 16, image_filter::bilinear, false);
+    cache.get(2, src, 16, 16, image_filter::box, false);
+    cache.invalidate_image(1);
+    BOOST_CHECK_EQUAL(cache.stats().variants, 1u);
+    cache.get(2, src, 16, 16, image_filter::box, false);
+    BOOST_CHECK_EQUAL(cache.stats().hits, 1u);
+
+    // The renderer drops the variants of an image when it is freed, not before
+    cpu::Renderer<> r(64, 64);
+    auto image = r.register_rgba32_image(8, 8, pixels.data());
+    r.retain_image(image);
+    r.draw_image_scaled(0, 0, 30, 20, image);
+    r.draw_image_scaled(0, 0, 20, 30, image);
+    BOOST_CHECK_EQUAL(r.scaled_image_cache_stats().variants, 2u);
+    r.unregister_image(image);
+    BOOST_CHECK_EQUAL(r.scaled_image_cache_stats().variants, 2u);
+    r.unregister_image(image);
+    BOOST_CHECK_EQUAL(r.scaled_image_cache_stats().variants, 0u);
+    BOOST_CHECK_EQUAL(r.scaled_image_cache_stats().bytes, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/span_kernels.hpp>
+
+using namespace gpc::gui;
+using cpu::span_kernels;
+
+namespace {
+
+    const std::size_t GUARD = 4;       // pixels around each span, which must not change
+
+    const simd_level LEVELS[] = { simd_level::sse2, simd_level::avx2, simd_level::neon };
+
+    // Constant colors, including fully transparent and fully opaque ones
+    const rgba32 COLORS[] = { { { 10, 200, 30, 0 } }, { { 10, 200, 30, 255 } }, { { 255, 128, 0, 1 } }, { { 40, 90, 250, 128 } }, { { 255, 255, 255, 254 } } };
+
+    auto random_pixels(std::size_t count, std::mt19937 &rng, bool premultiplied) -> std::vector<rgba32>
+    {
+        std::vector<rgba32> pixels(count);
+        for (auto &p: pixels) {
+            // Alpha often at its extremes, where the kernels take shortcuts
+            unsigned a = rng() % 4 == 0 ? 0 : rng() % 3 == 0 ? 255 : rng() % 256;
+            for (int i = 0; i < 3; i++) p.components[i] = uint8_t(premultiplied ? rng() % (a + 1) : rng() % 256);
+            p.components[3] = uint8_t(a);
+        }
+        return pixels;
+    }
+
+    // The kernels take premultiplied colors as plain rgba32
+    auto premultiplied(rgba32 color) -> rgba32
+    {
+        auto p = premultiply(color);
+        return { { p.components[0], p.components[1], p.components[2], p.components[3] } };
+    }
+
+    template <class Fn>
+    void check_level(const span_kernels &simd, const char *kernel, Fn run)
+    {
+        std::mt19937 rng(11);
+        const auto &scalar = *cpu::span_kernels_for(simd_level::scalar);
+
+        for (std::size_t count = 0; count <= 17; count++) {
+            // Every alignment of the span within 16 bytes
+            for (std::size_t offset = 0; offset < 4; offset++) {
+                auto dst = random_pixels(count + offset + 2 * GUARD, rng, true), expected = dst;
+                auto src = random_pixels(count, rng, true);
+
+                run(scalar, &expected[offset + GUARD], src.data(), count);
+                run(simd, &dst[offset + GUARD], src.data(), count);
+
+                BOOST_CHECK_MESSAGE(std::memcmp(dst.data(), expected.data(), dst.size() * sizeof(rgba32)) == 0,
+                    simd.name << " " << kernel << " differs from scalar for " << count << " pixels at offset " << offset);
+            }
+        }
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( SpanKernels )
+
+BOOST_AUTO_TEST_CASE( scalar_always_available )
+{
+    BOOST_REQUIRE(cpu::span_kernels_for(simd_level::scalar));
+    BOOST_CHECK(cpu::span_kernels_for(cpu::best_span_kernels().level) == &cpu::best_span_kernels());
+}
+
+BOOST_AUTO_TEST_CASE( vector_kernels_match_scalar )
+{
+    for (auto level: LEVELS) {
+        auto kernels = cpu::span_kernels_for(level);
+        if (!kernels) continue;
+        BOOST_TEST_MESSAGE("checking " << kernels->name);
+
+        for (auto color: COLORS) {
+            check_level(*kernels, "fill", [&](const span_kernels &k, rgba32 *dst, const rgba32 *, std::size_t n) { k.fill(dst, n, color); });
+            check_level(*kernels, "blend_color", [&](const span_kernels &k, rgba32 *dst, const rgba32 *, std::size_t n) { k.blend_color(dst, n, color); });
+
+            auto premul_color = premultiplied(color);
+            check_level(*kernels, "blend_color_premul", [&](const span_kernels &k, rgba32 *dst, const rgba32 *, std::size_t n) { k.blend_color_premul(dst, n, premul_color); });
+        }
+        check_level(*kernels, "blend_premul", [](const span_kernels &k, rgba32 *dst, const rgba32 *src, std::size_t n) { k.blend_premul(dst, src, n); });
+    }
+}
+
+BOOST_AUTO_TEST_CASE( constant_premultiplied_color_matches_span )
+{
+    std::mt19937 rng(5);
+    for (auto level: { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::neon }) {
+        auto kernels = cpu::span_kernels_for(level);
+        if (!kernels) continue;
+
+        for (auto color: COLORS) {
+            auto premul_color = premultiplied(color);
+            auto a = random_pixels(37, rng, true), b = a;
+            std::vector<rgba32> span(a.size(), premul_color);
+            kernels->blend_color_premul(a.data(), a.size(), premul_color);
+            kernels->blend_premul(b.data(), span.data(), b.size());
+            BOOST_CHECK_MESSAGE(std::memcmp(a.data(), b.data(), a.size() * sizeof(rgba32)) == 0, kernels->name);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( extreme_alphas )
+{
+    auto kernels = &cpu::best_span_kernels();
+    std::vector<rgba32> dst(9, rgba32{ { 1, 2, 3, 4 } });
+
+    kernels->blend_color(dst.data(), dst.size(), rgba32{ { 200, 100, 50, 0 } });
+    for (const auto &p: dst) BOOST_CHECK(p.components[0] == 1 && p.components[3] == 4);
+
+    kernels->blend_color(dst.data(), dst.size(), rgba32{ { 200, 100, 50, 255 } });
+    for (const auto &p: dst) BOOST_CHECK(p.components[0] == 200 && p.components[2] == 50 && p.components[3] == 255);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
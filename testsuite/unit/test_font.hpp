@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gpc/fonts/rasterized_font.hpp>
+#include <gpc/gui/color.hpp>
+
+/* A small synthetic font for the unit tests, so that they need no font files: one
+   glyph per uppercase letter, of varying size and placement, with coverage values
+   spanning the whole range.
+ */
+inline auto make_test_font() -> gpc::fonts::rasterized_font
+{
+    gpc::fonts::rasterized_font font;
+    font.variants.resize(1);
+    auto &variant = font.variants[0];
+
+    for (char32_t cp = U'A'; cp <= U'Z'; cp++) {
+        int n = int(cp - U'A'), w = 3 + n % 5, h = 5 + n % 7;
+
+        gpc::fonts::rasterized_font::glyph_record glyph;
+        glyph.cbox.bounds.x_min = n % 3 - 1;
+        glyph.cbox.bounds.x_max = glyph.cbox.bounds.x_min + w;
+        glyph.cbox.bounds.y_min = -(n % 4);
+        glyph.cbox.bounds.y_max = glyph.cbox.bounds.y_min + h;
+        glyph.cbox.adv_x = w + 1;
+        glyph.cbox.adv_y = 0;
+        glyph.pixel_base = variant.pixels.size();
+
+        font.index.push_back(cp);
+        variant.glyphs.push_back(glyph);
+        for (int i = 0; i < w * h; i++) variant.pixels.push_back(uint8_t((i * 37 + n * 11) % 256));
+    }
+
+    return font;
+}
+
+/* The font and image that the scenes of the unit tests draw with: the test font, and
+   a 7x5 image of translucent colors.
+ */
+template <class Renderer>
+struct test_resources {
+    typename Renderer::font_handle  font;
+    typename Renderer::image_handle image;
+};
+
+template <class Renderer>
+auto register_test_resources(Renderer &r) -> test_resources<Renderer>
+{
+    std::vector<gpc::gui::rgba32> pixels(7 * 5);
+    for (std::size_t i = 0; i < pixels.size(); i++) pixels[i] = gpc::gui::rgba32{ { uint8_t(i * 30), uint8_t(i * 7), 0, uint8_t(100 + i * 4) } };
+
+    return { r.register_font(make_test_font()), r.register_rgba32_image(7, 5, pixels.data()) };
+}
+
+/* True if two CPU renderers hold the same picture, bit for bit.
+ */
+template <class RendererA, class RendererB>
+bool same_pixels(const RendererA &a, const RendererB &b)
+{
+    auto fa = a.framebuffer(), fb = b.framebuffer();
+    return fa.width == fb.width && fa.height == fb.height &&
+        std::memcmp(a.pixels(), b.pixels(), std::size_t(fa.width) * std::size_t(fa.height) * sizeof(gpc::gui::rgba32)) == 0;
+}
@@ -0,0 +1,91 @@
+#include <cstring>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/cpu/renderer.hpp>
+#include <gpc/gui/cpu/tiled_renderer.hpp>
+
+#include "test_font.hpp"
+
+using namespace gpc::gui;
+
+namespace {
+
+    const int WIDTH = 230, HEIGHT = 170;
+
+    // Every kind of primitive, overlapping tile boundaries, with and without clipping
+    template <class Renderer>
+    void draw_scene(Renderer &r)
+    {
+        auto resources = register_test_resources(r);
+
+        r.clear(r.rgb_to_native({ 0.8f, 0.7f, 0.6f }));
+        for (int i = 0; i < 60; i++) {
+            int x = i * 37 % WIDTH - 20, y = i * 53 % HEIGHT - 20;
+            if (i % 10 == 5) r.set_clipping_rect(x, y, 90, 60);
+            if (i % 10 == 9) r.cancel_clipping();
+            r.fill_rect(x, y, 5 + i % 70, 3 + i * 7 % 50, r.rgba_norm_to_native({ float(i % 3) / 2, float(i % 5) / 4, 0.5f, i % 2 ? 1 : 0.5f }));
+            if (i % 4 == 0) r.draw_image(x + 7, y + 3, 45, 33, resources.image, i % 7, i % 5);
+            if (i % 6 == 1) {
+                r.set_text_color(r.rgba_norm_to_native({ 0, 0, float(i % 4) / 3, 0.8f }));
+                r.render_text(resources.font, x, y + 20, U"TILED RENDERER", 14);
+            }
+        }
+        r.cancel_clipping();
+        r.fill_rect(10, 10, 0, 50, r.rgb_to_native({ 1, 0, 0 }));      // empty
+    }
+
+    template <class Backend>
+    void check_identical(unsigned threads, int tile_size)
+    {
+        Backend reference(WIDTH, HEIGHT), target(WIDTH, HEIGHT);
+        draw_scene(reference);
+
+        cpu::TiledRenderer<Backend> tiled(&target, threads, tile_size);
+        draw_scene(tiled);
+        tiled.flush();
+
+        BOOST_CHECK_MESSAGE(same_pixels(reference, target),
+            "tiled output differs with " << threads << " thread(s), tiles of " << tile_size);
+    }
+
+} // anonymous ns
+
+BOOST_AUTO_TEST_SUITE( TiledRendering )
+
+BOOST_AUTO_TEST_CASE( identical_to_backend )
+{
+    for (unsigned threads: { 1u, 3u }) {
+        for (int tile_size: { 16, 64, 1000 }) {
+            check_identical<cpu::Renderer<>>(threads, tile_size);
+            check_identical<cpu::Renderer<vertical_direction::up>>(threads, tile_size);
+            check_identical<cpu::Renderer<vertical_direction::down, int, alpha_mode::premultiplied>>(threads, tile_size);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( flush_without_commands_changes_nothing )
+{
+    cpu::Renderer<> target(64, 64);
+    target.clear(rgba32{ { 1, 2, 3, 4 } });
+    std::vector<rgba32> before(target.pixels(), target.pixels() + 64 * 64);
+
+    cpu::TiledRenderer<cpu::Renderer<>> tiled(&target, 2);
+    tiled.flush();
+
+    BOOST_CHECK(std::memcmp(before.data(), target.pixels(), before.size() * sizeof(rgba32)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE( empty_framebuffer )
+{
+    cpu::Renderer<> target(0, 0);
+    cpu::TiledRenderer<cpu::Renderer<>> tiled(&target, 2);
+    tiled.clear(rgba32{ { 1, 2, 3, 4 } });
+    tiled.fill_rect(0, 0, 10, 10, rgba32{ { 255, 0, 0, 255 } });
+    tiled.flush();
+
+    BOOST_CHECK_EQUAL(target.width(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
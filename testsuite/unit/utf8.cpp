@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <gpc/gui/utf8.hpp>
+
+using gpc::gui::utf8_to_ucs4;
+using gpc::gui::utf8_length;
+
+namespace {
+
+    // Decodes from a buffer of exactly the size of the text, so that reading past its
+    // end is caught by memory checkers. Also checks that utf8_length() counts as many
+    // codepoints as were decoded.
+    auto decode(const std::string &text) -> std::u32string
+    {
+        std::vector<char> exact(text.begin(), text.end());
+        std::vector<char32_t> codepoints;
+        utf8_to_ucs4(exact.data(), exact.size(), codepoints);
+        BOOST_CHECK_EQUAL(utf8_length(exact.data(), exact.size()), codepoints.size());
+        return std::u32string(codepoints.begin(), codepoints.end());
+    }
+
+    auto hex(const std::u32string &s) -> std::string
+    {
+        std::string out;
+        for (auto cp: s) {
+            char buf[12];
+            std::snprintf(buf, sizeof(buf), "%s%04X", out.empty() ? "" : " ", unsigned(cp));
+            out += buf;
+        }
+        return out;
+    }
+
+} // anonymous ns
+
+#define CHECK_DECODES(text, expected) BOOST_CHECK_EQUAL(hex(decode(text)), hex(expected))
+
+BOOST_AUTO_TEST_SUITE( Utf8Decoding )
+
+BOOST_AUTO_TEST_CASE( well_formed )
+{
+    CHECK_DECODES("", U"");
+    CHECK_DECODES("Hello", U"Hello");
+    CHECK_DECODES("\xC3\xA9t\xC3\xA9", U"été");
+    CHECK_DECODES("\xE2\x82\xAC 5", U"€ 5");
+    CHECK_DECODES("\xF0\x9F\x98\x80", U"\U0001F600");
+    CHECK_DECODES("\xEF\xBF\xBF\xF4\x8F\xBF\xBF", U"￿\U0010FFFF");
+}
+
+BOOST_AUTO_TEST_CASE( invalid_bytes )
+{
+    CHECK_DECODES("\x80", U"�");
+    CHECK_DECODES("a\xBF" "b", U"a�b");
+    CHECK_DECODES("\xFF\xFE", U"��");
+    CHECK_DECODES("\xF5\x80\x80\x80", U"����");
+}
+
+BOOST_AUTO_TEST_CASE( overlong_surrogate_and_out_of_range )
+{
+    // Not even a prefix of a valid sequence: one U+FFFD per byte
+    CHECK_DECODES("\xC0\xAF", U"��");
+    CHECK_DECODES("\xE0\x80\xAF", U"���");
+    CHECK_DECODES("\xED\xA0\x80", U"���");
+    CHECK_DECODES("\xF4\x90\x80\x80", U"����");
+}
+
+BOOST_AUTO_TEST_CASE( truncated_sequences )
+{
+    // A maximal subpart of a valid sequence gives a single U+FFFD
+    CHECK_DECODES("\xE2\x82", U"�");
+    CHECK_DECODES("\xF0\x9F\x98", U"�");
+    CHECK_DECODES("\xE2\x82" "A", U"�" "A");
+    CHECK_DECODES("\xF0\x9F\xC3\xA9", U"�é");
+
+    // Example from the Unicode standard (table 3-8)
+    CHECK_DECODES("\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64", U"a���b�c��d");
+}
+
+BOOST_AUTO_TEST_CASE( errors_around_ascii_blocks )
+{
+    // The ASCII fast path works on blocks of 16 bytes: put errors at and across block ends
+    for (std::size_t prefix = 0; prefix < 40; prefix++) {
+        std::string ascii(prefix, 'x');
+        std::u32string expected(prefix, U'x');
+
+        CHECK_DECODES(ascii + "\xE2\x82", expected + U"�");
+        CHECK_DECODES(ascii + "\xC3\xA9" + ascii, expected + U"é" + expected);
+        CHECK_DECODES(ascii + "\x80" + ascii, expected + U"�" + expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( overloads_agree )
+{
+    std::string text = "mixed \xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80 and \xED\xA0\x80 bad \xE2\x82";
+    auto expected = decode(text);
+
+    std::vector<char32_t> buffer(text.size());
+    auto count = utf8_to_ucs4(text.data(), text.size(), buffer.data());
+    BOOST_CHECK_EQUAL(hex(std::u32string(buffer.data(), count)), hex(expected));
+
+    std::size_t count2;
+    auto codepoints = utf8_to_ucs4(text.data(), text.size(), count2);
+    BOOST_CHECK_EQUAL(hex(std::u32string(codepoints, count2)), hex(expected));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gpc/gui/font_library.hpp>
+#include <gpc/gui/packed_font.hpp>
+
+/* Converts a rasterized font (.rft, as produced by GPCFontRasterizer) into a packed
+   font (.gpf, see packed_font.hpp), which renderers can use in place.
+
+   Usage: GPCFontPacker input=<font.rft> output=<font.gpf>
+ */
+
+static auto
+argument(int argc, char *argv[], const std::string &name) -> std::string
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, name.size() + 1, name + "=") == 0) return arg.substr(name.size() + 1);
+    }
+    return std::string();
+}
+
+int main(int argc, char *argv[])
+{
+    try {
+
+        auto input = argument(argc, argv, "input"), output = argument(argc, argv, "output");
+        if (input.empty() || output.empty()) {
+            std::cerr << "Usage: " << argv[0] << " input=<font.rft> output=<font.gpf>" << std::endl;
+            return 2;
+        }
+
+        auto rfont = gpc::gui::font_library::instance().load_file(input);
+
+        std::vector<uint8_t> data;
+        gpc::gui::packed_font::write(*rfont, data);
+
+        // Check the result before writing it
+        gpc::gui::packed_font check(data.data(), data.size());
+
+        auto file = std::fopen(output.c_str(), "wb");
+        if (!file || std::fwrite(data.data(), 1, data.size(), file) != data.size() || std::fclose(file) != 0) {
+            std::cerr << "Cannot write \"" << output << "\"" << std::endl;
+            return 1;
+        }
+
+        std::cout << output << ": " << check.glyph_count() << " glyphs, " << data.size() << " bytes" << std::endl;
+        return 0;
+    }
+    catch(const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    catch(...) {}
+
+    return 1;
+}